@@ -0,0 +1,68 @@
+#ifndef __BUFFER_UPLOAD_H__
+#define __BUFFER_UPLOAD_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+// write `size` bytes of the buffer bound to `target` at `offset`, directly through a mapping of
+// the buffer (through a staging block only if it can not be mapped)
+template <typename WriteFn>
+void writeBuffer(
+    GLenum target, std::size_t offset, std::size_t size, GLbitfield access, WriteFn write
+) {
+  if (size == 0) return;
+
+  void* mapped = glMapBufferRange(target, offset, size, GL_MAP_WRITE_BIT | access);
+  if (mapped) {
+    write(static_cast<unsigned char*>(mapped));
+
+    // the contents are undefined if unmapping fails (e.g. screen mode change), so they are
+    // written again below
+    if (glUnmapBuffer(target) == GL_TRUE) return;
+  }
+
+  std::vector<unsigned char> staging(size);
+  write(staging.data());
+  glBufferSubData(target, offset, size, staging.data());
+}
+
+// copy of a cpu block into a freshly allocated (orphaned) gpu buffer, spread over several calls
+// (e.g. frames) so that large uploads do not stall the render loop. the gpu does not read the
+// buffer before the upload is done, so the writes do not need to be synchronized
+class BufferUpload {
+ private:
+  GLenum target{};
+  unsigned int buffer{};
+  const unsigned char* data{};
+  std::size_t size{}, uploaded{};
+
+ public:
+  BufferUpload(GLenum _target, unsigned int _buffer, const void* _data, std::size_t _size)
+      : target{_target},
+        buffer{_buffer},
+        data{static_cast<const unsigned char*>(_data)},
+        size{_size} {}
+
+  bool isDone() const { return uploaded == size; }
+
+  // upload at most `budget` bytes, and take them from it
+  void step(std::size_t& budget) {
+    std::size_t chunk = std::min(budget, size - uploaded);
+    if (chunk == 0) return;
+
+    glBindBuffer(target, buffer);
+    writeBuffer(
+        target, uploaded, chunk, GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT,
+        [&](unsigned char* out) { std::copy_n(data + uploaded, chunk, out); }
+    );
+    glBindBuffer(target, 0);
+
+    uploaded += chunk;
+    budget -= chunk;
+  }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __BUFFERED_WRITER_H__
+#define __BUFFERED_WRITER_H__
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+constexpr std::size_t WRITER_BUFFER_BYTES = 4 << 20;
+
+// binary file (or stream) written through a large buffer: values are appended to it, and it is
+// written to the file whenever it is full. throws runtime_error if the file can't be opened or
+// written
+class BufferedWriter {
+ private:
+  std::ofstream file;  // unused when writing to a stream
+  std::ostream& out;
+  std::vector<char> buffer;
+  std::size_t used{0};
+  std::size_t flushed{0};
+  std::string path;
+
+ public:
+  explicit BufferedWriter(const std::string& _path, std::size_t bufferBytes = WRITER_BUFFER_BYTES)
+      : file(_path, std::ios::binary), out{file}, buffer(bufferBytes), path{_path} {
+    if (!file) throw std::runtime_error("Failed to open " + path + " for writing");
+  }
+
+  explicit BufferedWriter(std::ostream& stream, std::size_t bufferBytes = WRITER_BUFFER_BYTES)
+      : out{stream}, buffer(bufferBytes), path{"stream"} {}
+
+  template <typename T>
+  void write(const T& value) {
+    if (used + sizeof(T) > buffer.size()) flush();
+
+    std::memcpy(buffer.data() + used, &value, sizeof(T));
+    used += sizeof(T);
+  }
+
+  void write(const void* data, std::size_t size) {
+    if (used + size > buffer.size()) flush();
+
+    if (size > buffer.size()) {
+      out.write(static_cast<const char*>(data), size);
+      flushed += size;
+    } else {
+      std::memcpy(buffer.data() + used, data, size);
+      used += size;
+    }
+  }
+
+  // bytes written so far
+  std::size_t getPosition() const { return flushed + used; }
+
+  void pad(std::size_t alignment, char value) {
+    while (getPosition() % alignment != 0) write(value);
+  }
+
+  void flush() {
+    out.write(buffer.data(), used);
+    flushed += used;
+    used = 0;
+  }
+
+  void close() {
+    flush();
+    if (file.is_open()) file.close();
+    if (!out) throw std::runtime_error("Failed to write " + path);
+  }
+};
+
+#endif
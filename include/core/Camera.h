@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "geometry/Bounds.h"
+
 constexpr float SENSITIVITY = 0.02f;
 constexpr float ZOOM_SENSITIVITY = 1.0f;
 constexpr float MOVE_SPEED = 2.0f;
@@ -41,6 +43,7 @@ class Camera {
   }
 
   glm::vec3 getPosition() const { return pos; }
+  float getFov() const { return fov; }
 
   glm::mat4 getViewMatrix() { return glm::lookAt(pos, pos + front, up); }
 
@@ -48,6 +51,8 @@ class Camera {
     return glm::perspective(glm::radians(fov), aspectRatio, near, far);
   }
 
+  Frustum getFrustum() { return Frustum{getProjectionMatrix() * getViewMatrix()}; }
+
   void move(Direction direction, float deltaTime) {
     float velocity = MOVE_SPEED * deltaTime;
     switch (direction) {
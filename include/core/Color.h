@@ -0,0 +1,29 @@
+#ifndef __COLOR_H__
+#define __COLOR_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// rgba8 color: r, g, b, a in memory order (little endian), as stored by the strand datasets and
+// the mesh exports
+inline std::uint32_t packColor(const glm::vec4& color) {
+  std::uint32_t packed = 0;
+  for (int c = 0; c < 4; ++c) {
+    auto channel = static_cast<std::uint32_t>(std::round(std::clamp(color[c], 0.0f, 1.0f) * 255));
+    packed |= channel << (8 * c);
+  }
+
+  return packed;
+}
+
+inline glm::vec4 unpackColor(std::uint32_t color) {
+  glm::vec4 unpacked;
+  for (int c = 0; c < 4; ++c) unpacked[c] = ((color >> (8 * c)) & 0xff) / 255.0f;
+
+  return unpacked;
+}
+
+#endif
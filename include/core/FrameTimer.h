@@ -0,0 +1,64 @@
+#ifndef __FRAME_TIMER_H__
+#define __FRAME_TIMER_H__
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// gpu timer queries are read this many frames after they are issued, so that reading them never
+// stalls the pipeline
+constexpr int FRAME_TIMER_LATENCY = 3;
+
+// cpu time of the phases of every frame, and gpu time of its render passes (timer queries).
+// phases and passes are identified by their index in the names given at construction
+class FrameTimer {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::string> phaseNames, passNames;
+
+  // milliseconds per frame, of every frame since the last clear
+  std::vector<float> frameSamples;
+  std::vector<std::vector<float>> phaseSamples, passSamples;
+
+  Clock::time_point frameStart, phaseStart;
+  int currentPhase{-1};
+  std::vector<float> currentPhaseTimes;
+
+  // [slot * nPasses + pass], one slot per frame in flight
+  std::vector<unsigned int> queries;
+  std::vector<bool> queryIssued;
+  int slot{0};
+  int currentPass{-1};
+
+ public:
+  FrameTimer(std::vector<std::string> phases, std::vector<std::string> passes);
+
+  FrameTimer(const FrameTimer&) = delete;
+  FrameTimer& operator=(const FrameTimer&) = delete;
+
+  // gl objects (needs a current context)
+  void initialize();
+  void deleteQueries();
+
+  void beginFrame();
+  void endFrame();
+
+  // ends the previous phase of the frame, if any
+  void beginPhase(int phase);
+
+  // gpu passes can't be nested
+  void beginPass(int pass);
+  void endPass();
+
+  int getFrameCount() const { return frameSamples.size(); }
+  void clear();
+
+  // mean times since the last clear
+  void printSummary(std::ostream& out) const;
+  // percentiles of the frame, phase and pass times since the last clear
+  void writePercentiles(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef __GENERATION_PROTOCOL_H__
+#define __GENERATION_PROTOCOL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// tree generation service protocol, over a unix stream socket (little endian). every message is a
+// uint32 payload size followed by the payload:
+//   request: GenerationRequest, then a plant graph file (text or binary, see PlantGraphIO.h)
+//   response: GenerationResponse, then the mesh (glb) and the strand dataset of the tree (see
+//   StrandDataset.h) as requested, or the error message
+//
+// the responses come in any order. a request supersedes the earlier requests of its connection
+// with the same channel: they are answered RESPONSE_CANCELLED if they are not done yet
+constexpr char GENERATION_REQUEST_MAGIC[4] = {'I', 'G', 'Q', '1'};
+constexpr char GENERATION_RESPONSE_MAGIC[4] = {'I', 'G', 'A', '1'};
+constexpr std::uint32_t MAX_MESSAGE_BYTES = 1u << 30;
+
+// request flags
+constexpr std::uint32_t REQUEST_MESH = 1;
+constexpr std::uint32_t REQUEST_STRANDS = 2;
+constexpr std::uint32_t REQUEST_QUANTIZE = 4;  // quantized mesh (see MeshExportOptions)
+constexpr std::uint32_t REQUEST_EXPAND = 8;    // individual strands (see Tree::expandSuperStrands)
+
+enum ResponseStatus : std::uint32_t { RESPONSE_OK, RESPONSE_CANCELLED, RESPONSE_FAILED };
+
+struct GenerationRequest {
+  char magic[4];
+  std::uint32_t id;  // echoed in the response
+  std::uint32_t channel;
+  std::uint32_t flags;
+  std::uint32_t seed;
+  std::uint32_t maxNodeStrands;  // strand bundling (see Tree::setStrandBundling), 0: none
+};
+
+struct GenerationResponse {
+  char magic[4];
+  std::uint32_t id;
+  std::uint32_t status;
+  std::uint32_t cached;  // the tree was already generated recently
+  float seconds;         // generation time
+  std::uint32_t reserved;
+  std::uint64_t meshBytes, strandBytes;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GENERATION_SOCKETS
+
+// part of a message, written after the others
+struct MessagePart {
+  const void* data;
+  std::size_t size;
+};
+
+// sockets, in blocking mode. errors throw runtime_error
+int listenUnixSocket(const std::string& path);  // a stale socket file is replaced
+// delete the socket file at `path`, if there is one (anything else at `path` is an error)
+void removeUnixSocket(const std::string& path);
+int connectUnixSocket(const std::string& path);
+
+// false once the peer closed the connection (between messages)
+bool readMessage(int fd, std::vector<char>& payload);
+void writeMessage(int fd, std::initializer_list<MessagePart> parts);
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 64 bit fnv-1a, over 8 byte words (then the remaining bytes): fast enough to checksum large
+// files, not meant to resist collisions made on purpose
+constexpr std::uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+constexpr std::uint64_t HASH_PRIME = 0x100000001b3ull;
+
+inline std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t hash = HASH_SEED) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+  std::size_t i = 0;
+  for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * HASH_PRIME;
+  }
+  for (; i < size; ++i) hash = (hash ^ bytes[i]) * HASH_PRIME;
+
+  // the multiplication only carries upwards: fold the high bits back
+  return hash ^ (hash >> 32);
+}
+
+template <typename T>
+std::uint64_t hashValue(const T& value, std::uint64_t hash = HASH_SEED) {
+  return hashBytes(&value, sizeof(T), hash);
+}
+
+#endif
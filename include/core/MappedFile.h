@@ -0,0 +1,83 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP
+#endif
+
+// read-only view of a whole file: mapped in memory when possible, read otherwise. files that are
+// not read `sequential`ly are paged in on access only (no read-ahead). throws runtime_error if the
+// file can't be opened
+class MappedFile {
+ private:
+  const char* data{nullptr};
+  std::size_t size{0};
+#if defined(MAPPED_FILE_MMAP)
+  void* mapping{nullptr};
+#else
+  std::vector<char> buffer;
+#endif
+
+ public:
+  explicit MappedFile(const std::string& path, bool sequential = true) {
+#if defined(MAPPED_FILE_MMAP)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open " + path);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      throw std::runtime_error("Failed to stat " + path);
+    }
+    size = info.st_size;
+
+    if (size > 0) {
+      mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map " + path);
+      }
+
+      madvise(mapping, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+      data = static_cast<const char*>(mapping);
+    }
+
+    close(fd);  // the mapping stays valid
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Failed to open " + path);
+
+    buffer.resize(file.tellg());
+    file.seekg(0);
+    file.read(buffer.data(), buffer.size());
+
+    data = buffer.data();
+    size = buffer.size();
+#endif
+  }
+
+  ~MappedFile() {
+#if defined(MAPPED_FILE_MMAP)
+    if (mapping) munmap(mapping, size);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* begin() const { return data; }
+  const char* end() const { return data + size; }
+  std::size_t getSize() const { return size; }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+inline unsigned int getNumThreads() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// set on threads that already run alongside one another on every core (e.g. a pool of tree
+// generations): their forRange calls stay on the calling thread
+inline thread_local bool serialThread = false;
+
+// run fn(i) for every i in [begin, end), distributing chunks of `grain` indices dynamically
+// between the hardware threads (the calling thread also takes part)
+template <typename Fn>
+void forRange(int begin, int end, Fn&& fn, int grain = 1) {
+  int count = end - begin;
+  if (count <= 0) return;
+
+  unsigned int numThreads = std::min<unsigned int>(getNumThreads(), (count + grain - 1) / grain);
+  if (numThreads <= 1 || serialThread) {
+    for (int i = begin; i < end; ++i) fn(i);
+    return;
+  }
+
+  std::atomic<int> next{begin};
+  auto worker = [&]() {
+    for (int start = next.fetch_add(grain); start < end; start = next.fetch_add(grain)) {
+      int stop = std::min(start + grain, end);
+      for (int i = start; i < stop; ++i) fn(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+  for (unsigned int t = 1; t < numThreads; ++t) threads.emplace_back(worker);
+
+  worker();
+
+  for (auto& thread : threads) thread.join();
+}
+
+};  // namespace parallel
+
+#endif
@@ -1,77 +1,180 @@
 #ifndef __PLANT_GRAPH__H
 #define __PLANT_GRAPH__H
 
+#include <algorithm>
 #include <cassert>
-#include <memory>
-#include <unordered_map>
+#include <cstddef>
+#include <functional>
+#include <numeric>
 #include <vector>
 
 #include <glm/glm.hpp>
 
 struct Node {
- private:
-  inline static int ID_COUNTER = 0;
-
  public:
   int id;
   int parentId;
 
   glm::vec3 pos;
-  // float diameter;
+  float radius{};  // 0 if unknown
   // float length;
   // float shootFluxSignal;
   // ...
 
-  explicit Node(int parent, glm::vec3 _pos) : id{ID_COUNTER++}, parentId{parent}, pos{_pos} {}
-
-  static int getNodeCount() { return ID_COUNTER; }
+  explicit Node(int _id, int parent, glm::vec3 _pos, float _radius = 0.0f)
+      : id{_id}, parentId{parent}, pos{_pos}, radius{_radius} {}
 
   inline bool isRoot() const { return parentId == -1; }
 };
 
+// children of a node, contiguous in the graph (invalidated when a node is added). their order
+// can be changed in place
+template <typename T>
+struct NodeChildren {
+  T* first;
+  T* last;
+
+  T* begin() const { return first; }
+  T* end() const { return last; }
+  std::size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+  T& operator[](std::size_t i) const { return first[i]; }
+};
+
 struct PlantGraph {
  public:
-  std::unordered_map<int, std::unique_ptr<Node>> nodes;  // stored node data
-  std::unordered_map<int, std::vector<int>> adj;         // graphs adjacency list
+  std::vector<Node> nodes;  // stored node data, indexed by id
 
+ private:
+  // children of every node, in compressed rows: the children of node i are
+  // children[childOffsets[i], childOffsets[i + 1])
+  std::vector<int> childOffsets{0};
+  std::vector<int> children;
+
+  // nodes added or moved since the last call to clearDirtyNodes(): flagged, and listed once. a
+  // graph built at once is all dirty without flagging every node
+  std::vector<char> dirtyFlags;
+  std::vector<int> dirtyList;
+  bool allDirty{false};
+
+ public:
   PlantGraph(const glm::vec3& root) { addNode(root); }
 
+  // bulk construction: node i must have id i, the root is node 0 and every parent comes before
+  // its children. all the nodes are dirty
+  explicit PlantGraph(std::vector<Node>&& _nodes) : nodes{std::move(_nodes)}, allDirty{true} {
+    assert(!nodes.empty() && nodes[0].isRoot());
+
+    const int n = nodes.size();
+    childOffsets.assign(n + 1, 0);
+    for (const Node& node : nodes) {
+      assert(node.id == &node - nodes.data() && node.parentId < node.id);
+      if (!node.isRoot()) childOffsets[node.parentId + 1]++;
+    }
+    for (int id = 0; id < n; ++id) childOffsets[id + 1] += childOffsets[id];
+
+    // (children in id order)
+    children.resize(childOffsets[n]);
+    std::vector<int> next(childOffsets.begin(), childOffsets.end() - 1);
+    for (const Node& node : nodes) {
+      if (!node.isRoot()) children[next[node.parentId]++] = node.id;
+    }
+
+    dirtyFlags.assign(n, 0);
+  }
+
+  // node ids are dense in each graph: [0, getNodeCount())
+  int getNodeCount() const { return nodes.size(); }
+
+  // (shifts the children of the nodes after the parent: large graphs are built at once instead)
   int addNode(const glm::vec3& pos, int parentId = -1) {
     // initialize node
-    auto node = std::make_unique<Node>(parentId, pos);
-    int id = node->id;
-
-    nodes[id] = std::move(node);
-    adj[id] = std::vector<int>();
+    int id = getNodeCount();
+    nodes.emplace_back(id, parentId, pos);
+    childOffsets.push_back(childOffsets.back());
+    dirtyFlags.push_back(0);
 
     // if it has a parent, link to the parent
-    if (parentId != -1 && adj.find(parentId) != adj.end()) adj[parentId].push_back(id);
+    if (parentId != -1 && parentId < id) addEdge(parentId, id);
+
+    markDirty(id);
 
     return id;
   }
 
+  void setNodePosition(int id, const glm::vec3& pos) {
+    nodes.at(id).pos = pos;
+    markDirty(id);
+  }
+
+  void markDirty(int id) {
+    if (allDirty || dirtyFlags[id]) return;
+
+    dirtyFlags[id] = 1;
+    dirtyList.push_back(id);
+  }
+
+  bool isDirty(int id) const { return allDirty || dirtyFlags[id]; }
+  bool hasDirtyNodes() const { return allDirty || !dirtyList.empty(); }
+
+  // in id order
+  std::vector<int> getDirtyNodes() const {
+    std::vector<int> dirty = dirtyList;
+    if (allDirty) {
+      dirty.resize(getNodeCount());
+      std::iota(dirty.begin(), dirty.end(), 0);
+    }
+    std::sort(dirty.begin(), dirty.end());
+
+    return dirty;
+  }
+
+  void clearDirtyNodes() {
+    for (int id : dirtyList) dirtyFlags[id] = 0;
+    dirtyList.clear();
+    allDirty = false;
+  }
+
   // add edge between two existing nodes
   void addEdge(int id1, int id2) {
-    assert(adj.find(id1) != adj.end() && adj.find(id2) != adj.end());
+    assert(id1 < getNodeCount() && id2 < getNodeCount());
 
-    adj[id1].push_back(id2);
+    children.insert(children.begin() + childOffsets[id1 + 1], id2);
+    for (int id = id1 + 1; id < childOffsets.size(); ++id) childOffsets[id]++;
   }
 
-  const Node& getNode(int id) const { return *nodes.at(id); }
-
-  void traverseDFS(int start, std::function<void(const Node&)> fn) const {
-    std::vector<bool> visited(adj.size(), false);
+  NodeChildren<int> getChildren(int id) {
+    assert(id >= 0 && id < getNodeCount());
+    return {children.data() + childOffsets[id], children.data() + childOffsets[id + 1]};
+  }
 
-    dfs(start, fn, visited);
+  NodeChildren<const int> getChildren(int id) const {
+    assert(id >= 0 && id < getNodeCount());
+    return {children.data() + childOffsets[id], children.data() + childOffsets[id + 1]};
   }
 
- private:
-  void dfs(int id, std::function<void(const Node&)> fn, std::vector<bool>& visited) const {
-    visited[id] = true;
-    fn(getNode(id));
+  int getChildCount() const { return children.size(); }  // of all the nodes
 
-    for (int neighbor : adj.at(id)) {
-      if (!visited[neighbor]) dfs(neighbor, fn, visited);
+  const Node& getNode(int id) const { return nodes.at(id); }
+
+  // preorder, with an explicit stack: scanned skeletons have very long chains of nodes
+  void traverseDFS(int start, std::function<void(const Node&)> fn) const {
+    std::vector<bool> visited(getNodeCount(), false);
+    std::vector<int> stack{start};
+
+    while (!stack.empty()) {
+      int id = stack.back();
+      stack.pop_back();
+
+      if (visited[id]) continue;
+      visited[id] = true;
+      fn(getNode(id));
+
+      // reversed, so that the children are visited in order
+      const auto neighbors = getChildren(id);
+      for (int i = static_cast<int>(neighbors.size()) - 1; i >= 0; --i) {
+        if (!visited[neighbors[i]]) stack.push_back(neighbors[i]);
+      }
     }
   }
 };
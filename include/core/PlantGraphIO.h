@@ -0,0 +1,31 @@
+#ifndef __PLANT_GRAPH_IO_H__
+#define __PLANT_GRAPH_IO_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "core/PlantGraph.h"
+
+// plant graph files, in one of two formats (told apart by their first bytes):
+//
+// text: one node per line, "id parent x y z [radius]", with parent -1 for the root. ids are any
+// non-negative integers and the nodes may come in any order. '#' starts a comment, up to the end
+// of the line (lines with nothing else are ignored). anything else after the radius is an error
+//
+// binary (little endian): PLANT_GRAPH_MAGIC, uint32 node count, uint32 flags, uint32 reserved,
+// then int32 parents[n], float positions[3n] and, with PLANT_GRAPH_HAS_RADIUS, float radii[n].
+// node i has id i
+//
+// the nodes are renumbered in breadth first order from the root. errors throw runtime_error
+constexpr char PLANT_GRAPH_MAGIC[4] = {'P', 'G', 'B', '1'};
+constexpr std::uint32_t PLANT_GRAPH_HAS_RADIUS = 1;
+
+PlantGraph loadPlantGraph(const std::string& path);
+
+// same, from the contents of a file in memory (`name` is only used in the error messages)
+PlantGraph parsePlantGraph(const char* data, std::size_t size, const std::string& name);
+
+void savePlantGraphBinary(const PlantGraph& pg, const std::string& path);
+
+#endif
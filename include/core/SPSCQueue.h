@@ -0,0 +1,47 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// lock-free bounded queue between exactly one producer thread and one consumer thread
+template <typename T, std::size_t Capacity>
+class SPSCQueue {
+ private:
+  // one slot is kept free to tell a full queue from an empty one
+  std::array<T, Capacity + 1> slots{};
+
+  // separate cache lines, so that both threads do not keep invalidating each other's
+  alignas(64) std::atomic<std::size_t> head{0};  // next slot to pop (written by the consumer)
+  alignas(64) std::atomic<std::size_t> tail{0};  // next slot to push (written by the producer)
+
+ public:
+  // producer only. returns false if the queue is full
+  bool push(T&& item) {
+    const std::size_t t = tail.load(std::memory_order_relaxed);
+    const std::size_t next = (t + 1) % slots.size();
+    if (next == head.load(std::memory_order_acquire)) return false;
+
+    slots[t] = std::move(item);
+    tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only. returns false if the queue is empty
+  bool pop(T& item) {
+    const std::size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+
+    item = std::move(slots[h]);
+    head.store((h + 1) % slots.size(), std::memory_order_release);
+    return true;
+  }
+
+  bool isEmpty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+};
+
+#endif
@@ -1,15 +1,27 @@
 #ifndef __SHADER_H__
 #define __SHADER_H__
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+// binding point of the per-frame camera uniform block (see UniformBuffer.h)
+constexpr GLuint CAMERA_BLOCK_BINDING = 0;
+
 class Shader {
+ private:
+  // uniform locations, resolved once after linking. sorted by name: looked up without building a
+  // std::string from the name
+  std::vector<std::pair<std::string, GLint>> uniformLocations;
+
  public:
   unsigned int ID{};
 
@@ -73,61 +85,108 @@ class Shader {
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    cacheUniformLocations();
+
+    // programs that declare the camera block all read it from the same buffer
+    GLuint cameraBlock = glGetUniformBlockIndex(ID, "Camera");
+    if (cameraBlock != GL_INVALID_INDEX) {
+      glUniformBlockBinding(ID, cameraBlock, CAMERA_BLOCK_BINDING);
+    }
+  }
+
+  // location of an active uniform (-1 if there is none, which glUniform* calls ignore)
+  GLint getUniformLocation(std::string_view name) const {
+    auto it = std::lower_bound(
+        uniformLocations.begin(), uniformLocations.end(), name,
+        [](const auto &entry, std::string_view key) { return entry.first < key; }
+    );
+    return it != uniformLocations.end() && it->first == name ? it->second : -1;
   }
 
   // activate the shader
   void use() const { glUseProgram(ID); }
 
   // utility uniform functions
-  void setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+  void setBool(std::string_view name, bool value) const {
+    glUniform1i(getUniformLocation(name), (int)value);
   }
 
-  void setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  void setInt(std::string_view name, int value) const {
+    glUniform1i(getUniformLocation(name), value);
   }
 
-  void setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+  void setFloat(std::string_view name, float value) const {
+    glUniform1f(getUniformLocation(name), value);
   }
 
-  void setVec2(const std::string &name, const glm::vec2 &value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  void setVec2(std::string_view name, const glm::vec2 &value) const {
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
   }
 
-  void setVec2(const std::string &name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+  void setVec2(std::string_view name, float x, float y) const {
+    glUniform2f(getUniformLocation(name), x, y);
   }
 
-  void setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  void setVec3(std::string_view name, const glm::vec3 &value) const {
+    glUniform3fv(getUniformLocation(name), 1, &value[0]);
   }
 
-  void setVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+  void setVec3(std::string_view name, float x, float y, float z) const {
+    glUniform3f(getUniformLocation(name), x, y, z);
   }
 
-  void setVec4(const std::string &name, const glm::vec4 &value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  void setVec4(std::string_view name, const glm::vec4 &value) const {
+    glUniform4fv(getUniformLocation(name), 1, &value[0]);
   }
 
-  void setVec4(const std::string &name, float x, float y, float z, float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+  void setVec4(std::string_view name, float x, float y, float z, float w) const {
+    glUniform4f(getUniformLocation(name), x, y, z, w);
   }
 
-  void setMat2(const std::string &name, const glm::mat2 &mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  void setMat2(std::string_view name, const glm::mat2 &mat) const {
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
   }
 
-  void setMat3(const std::string &name, const glm::mat3 &mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  void setMat3(std::string_view name, const glm::mat3 &mat) const {
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
   }
 
-  void setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  void setMat4(std::string_view name, const glm::mat4 &mat) const {
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
   }
 
  private:
+  void cacheUniformLocations() {
+    uniformLocations.clear();
+
+    GLint nUniforms = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &nUniforms);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::string name(maxLength, '\0');
+    for (GLint i = 0; i < nUniforms; ++i) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+
+      // uniforms in blocks have no location
+      std::string uniformName = name.substr(0, length);
+      GLint location = glGetUniformLocation(ID, uniformName.c_str());
+      if (location == -1) continue;
+
+      // arrays are reported as "name[0]", but are also set through "name"
+      if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+        uniformLocations.emplace_back(uniformName.substr(0, uniformName.size() - 3), location);
+      }
+
+      uniformLocations.emplace_back(std::move(uniformName), location);
+    }
+
+    std::sort(uniformLocations.begin(), uniformLocations.end());
+  }
+
   // utility function for checking shader compilation/linking errors.
   void checkCompileErrors(GLuint shader, std::string type) {
     GLint success;
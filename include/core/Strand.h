@@ -1,13 +1,14 @@
 #ifndef __STRAND_H__
 #define __STRAND_H__
 
+#include <cmath>
 #include <memory>
 #include <ostream>
+#include <random>
 #include <vector>
 
 #include <glm/glm.hpp>
 
-#include "geometry/Mesh.h"
 #include "geometry/Spline.h"
 #include "Shader.h"
 
@@ -16,15 +17,24 @@ constexpr float STRAND_RADIUS = 0.0075f;
 
 struct StrandParticle {
   int strandId{};
+  int nodeId{-1};  // node the particle lies on (for interpolated ones: its branch start node)
   bool interpolated{};
+  int weight{1};  // leaf strands it stands for (super-strands, see Tree::setStrandBundling)
   glm::vec3 pos;
   glm::vec3 localPos;
 
   StrandParticle(
       int _strandId, const glm::vec3& worldp, const glm::vec3& localp = {},
-      bool _interpolated = false
+      bool _interpolated = false, int _nodeId = -1
   )
-      : strandId{_strandId}, pos{worldp}, localPos{localp}, interpolated{_interpolated} {}
+      : strandId{_strandId},
+        nodeId{_nodeId},
+        interpolated{_interpolated},
+        pos{worldp},
+        localPos{localp} {}
+
+  // a super-strand covers the area of the strands it stands for
+  float getRadius() const { return STRAND_RADIUS * std::sqrt(static_cast<float>(weight)); }
 
   friend std::ostream& operator<<(std::ostream& out, const StrandParticle& particle) {
     out << "World: (" << particle.pos.x << ", " << particle.pos.y << ", " << particle.pos.z
@@ -34,47 +44,76 @@ struct StrandParticle {
   }
 };
 
+// vertex of the batched strand geometry (generalized cylinders of all the strands)
+struct StrandVertex {
+  glm::vec3 pos;
+  unsigned char color[4];  // rgba8, normalized in the shader
+};
+
+// one segment (pair of consecutive particles) of a strand tube expanded in the vertex shader
+struct StrandTubeInstance {
+  int particle;  // first particle of the segment in the shared particle buffer
+  unsigned char color[4];
+};
+
 class Strand {
  private:
-  inline static int ID_COUNTER = 0;
   std::vector<std::shared_ptr<StrandParticle>> particles;
 
   // rendering
   Spline spline;
-  std::unique_ptr<Mesh> generalizedCylinder;
   glm::vec4 color;
 
  public:
   const int id;
 
-  explicit Strand() : id{ID_COUNTER++} {
-    // use random color for each strand
-    // base color is RGB: (111, 186, 131), with a random perturbation
-    // for each channel, higher probability of increasing red & green channel
+  // ids are the index of the strand in its tree
+  Strand(int _id, const glm::vec4& _color) : color{_color}, id{_id} {}
 
-    color = {
-        std::min(111.0f / 255.0f + (std::rand() % 40 - 10) / 255.0f, 1.0f),
-        std::min(186.0f / 255.0f + (std::rand() % 40 - 10) / 255.0f, 1.0f),
-        std::min(131.0f / 255.0f + (std::rand() % 20 - 10) / 255.0f, 1.0f), 1.0f
-    };
-  }
+  // base color is RGB: (111, 186, 131), with a random perturbation
+  // for each channel, higher probability of increasing red & green channel
+  static glm::vec4 randomColor(std::mt19937& rng);
 
-  static int getStrandCount() { return ID_COUNTER; }
+  const glm::vec4& getColor() const { return color; }
 
-  std::shared_ptr<StrandParticle> addParticle(const glm::vec3& pos, const glm::vec3& localPos = {});
+  std::shared_ptr<StrandParticle> addParticle(
+      const glm::vec3& pos, const glm::vec3& localPos = {}, int nodeId = -1
+  );
+
+  // adds a particle before the current first one (used when a leaf gets a new child)
+  std::shared_ptr<StrandParticle> prependParticle(
+      const glm::vec3& pos, const glm::vec3& localPos = {}, int nodeId = -1
+  );
 
   const std::vector<std::shared_ptr<StrandParticle>>& getParticles() const { return particles; }
 
-  void interpolateParticles();
+  // replace all the particles (node particles and interpolated ones, in order along the strand)
+  void setParticles(std::vector<std::shared_ptr<StrandParticle>> _particles) {
+    particles = std::move(_particles);
+  }
+
+  // removes the particles after `particle` (the strand was bundled into a super-strand there)
+  void endAt(const std::shared_ptr<StrandParticle>& particle);
+
+  void removeInterpolatedParticles();
 
   // render methods
   void initializeSplineBuffers();
   void renderSpline(const Shader& sh) const;
 
-  void initializeGeneralizedCylinder();
-  void renderStrand(const Shader& sh) const;
+  // rotation minimizing (parallel transport) frame of every particle: the rings of the strand tube
+  // are spanned by the normal and binormal, orthogonal to the strand tangent
+  void computeFrames(glm::vec3* normals, glm::vec3* binormals) const;
+
+  // generalized cylinder around the strand particles, written in the shared strand buffers
+  int getNumCylinderVertices() const { return particles.size() * NUM_CIRCLE_VERTICES; }
+  int getNumCylinderIndices() const {
+    return particles.size() > 1 ? (particles.size() - 1) * NUM_CIRCLE_VERTICES * 6 : 0;
+  }
+  void writeGeneralizedCylinder(
+      StrandVertex* vertices, unsigned int* indices, unsigned int baseVertex
+  ) const;
 
-  void renderStrandParticles() const;
 
   friend std::ostream& operator<<(std::ostream& out, const Strand& strand) {
     out << "Strand ID: " << strand.id << ". Particles positions: " << std::endl;
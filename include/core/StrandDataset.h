@@ -0,0 +1,205 @@
+#ifndef __STRAND_DATASET_H__
+#define __STRAND_DATASET_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/BufferedWriter.h"
+#include "core/MappedFile.h"
+#include "core/PlantGraph.h"
+
+// columnar strand dataset of a whole forest, read in place from a memory mapping: opening it only
+// checks the header and the table of trees, and the columns of a tree are paged in when they are
+// accessed. little endian, in this order:
+//
+//   StrandDatasetHeader
+//   StrandDatasetTreeRecord trees[treeCount]
+//   uint64 strandOffsets[strandCount + 1]              first point of every strand (global)
+//   uint64 nodeParticleOffsets[nodeCount + 1]          first node particle of every node (global)
+//   int32 nodeParents[nodeCount]                       tree-local ids, -1 for the roots
+//   vec3 nodePositions[nodeCount]
+//   int32 nodeChildren[nodeCount - treeCount]          children of every node, in node order
+//   uint32 strandColors[strandCount]                   rgba8
+//   vec3 points[pointCount]                            strand curves, strand after strand
+//   uint32 nodeParticlePoints[nodeParticleCount]       tree-local point of every node particle
+//   int32 nodeParticleStrands[nodeParticleCount]       tree-local strand
+//   vec3 nodeParticleLocalPositions[nodeParticleCount] in the node frontplane
+//   int32 nodeParticleWeights[nodeParticleCount]       leaf strands (not in version 1 datasets)
+//   char names[namesLength]
+//
+// the points of a strand are its particles (interpolated ones included), the node particles are
+// the ones lying on a node, in the node's layout order. version 1 datasets (without the weights)
+// are read with unit weights
+constexpr char STRAND_DATASET_MAGIC[4] = {'S', 'D', 'S', '1'};
+constexpr std::uint32_t STRAND_DATASET_VERSION = 2;
+
+struct StrandDatasetHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t treeCount;
+  std::uint32_t reserved;
+  std::uint64_t nodeCount, strandCount, pointCount, nodeParticleCount, namesLength;
+};
+
+// ranges of a tree in the global columns
+struct StrandDatasetTreeRecord {
+  std::uint64_t firstNode, firstChild, firstStrand, firstPoint, firstNodeParticle, nameOffset;
+  std::uint64_t pointCount, nodeParticleCount;
+  std::uint32_t nodeCount, strandCount, nameLength, reserved;
+};
+
+enum StrandDatasetColumn {
+  COLUMN_TREES,
+  COLUMN_STRAND_OFFSETS,
+  COLUMN_NODE_PARTICLE_OFFSETS,
+  COLUMN_NODE_PARENTS,
+  COLUMN_NODE_POSITIONS,
+  COLUMN_NODE_CHILDREN,
+  COLUMN_STRAND_COLORS,
+  COLUMN_POINTS,
+  COLUMN_NODE_PARTICLE_POINTS,
+  COLUMN_NODE_PARTICLE_STRANDS,
+  COLUMN_NODE_PARTICLE_LOCAL_POSITIONS,
+  COLUMN_NODE_PARTICLE_WEIGHTS,
+  COLUMN_NAMES,
+  NUM_STRAND_DATASET_COLUMNS
+};
+
+// contiguous elements read in place
+template <typename T>
+struct ArrayView {
+  const T* data{nullptr};
+  std::size_t count{0};
+
+  const T* begin() const { return data; }
+  const T* end() const { return data + count; }
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const T& operator[](std::size_t i) const { return data[i]; }
+};
+
+// one tree, with tree-local node, strand and point indices
+struct StrandDatasetTreeData {
+  std::string name{};
+
+  std::vector<std::int32_t> nodeParents{};
+  std::vector<glm::vec3> nodePositions{};
+  std::vector<std::int32_t> nodeChildren{};
+
+  std::vector<std::uint32_t> strandLengths{};
+  std::vector<std::uint32_t> strandColors{};
+  std::vector<glm::vec3> points{};
+
+  std::vector<std::uint32_t> nodeParticleCounts{};
+  std::vector<std::uint32_t> nodeParticlePoints{};
+  std::vector<std::int32_t> nodeParticleStrands{};
+  std::vector<glm::vec3> nodeParticleLocalPositions{};
+  std::vector<std::int32_t> nodeParticleWeights{};
+};
+
+// the particles lying on a node
+struct StrandDatasetNodeParticles {
+  ArrayView<std::uint32_t> points;  // tree-local point indices
+  ArrayView<std::int32_t> strands;
+  ArrayView<glm::vec3> localPositions;
+  ArrayView<std::int32_t> weights;  // empty in version 1 datasets (unit weights)
+};
+
+class StrandDataset;
+
+// view of a tree of a dataset (valid as long as the dataset). corrupted offsets throw
+// runtime_error when they are accessed
+class StrandDatasetTree {
+ private:
+  const StrandDataset& dataset;
+  const StrandDatasetTreeRecord record;
+
+ public:
+  StrandDatasetTree(const StrandDataset& _dataset, const StrandDatasetTreeRecord& _record)
+      : dataset{_dataset}, record{_record} {}
+
+  std::string getName() const;
+  int getNodeCount() const { return record.nodeCount; }
+  int getStrandCount() const { return record.strandCount; }
+  std::size_t getPointCount() const;
+
+  // plant graph
+  int getNodeParent(int nodeId) const;
+  glm::vec3 getNodePosition(int nodeId) const;
+  ArrayView<std::int32_t> getNodeChildren() const;  // children of every node, in node order
+  PlantGraph createGraph() const;                    // children in id order
+
+  // strands
+  ArrayView<glm::vec3> getPoints() const;  // every strand, one after the other
+  ArrayView<glm::vec3> getStrandPoints(int strandId) const;
+  std::size_t getStrandFirstPoint(int strandId) const;
+  glm::vec4 getStrandColor(int strandId) const;
+
+  StrandDatasetNodeParticles getNodeParticles(int nodeId) const;
+};
+
+// read-only dataset, mapped in memory. throws runtime_error if the file can't be opened or its
+// header and tree table are invalid
+class StrandDataset {
+ private:
+  MappedFile file;
+  StrandDatasetHeader header{};
+  std::array<const char*, NUM_STRAND_DATASET_COLUMNS> columns{};
+
+  friend class StrandDatasetTree;
+
+  template <typename T>
+  ArrayView<T> getColumn(StrandDatasetColumn column, std::uint64_t first, std::uint64_t count)
+      const {
+    return {reinterpret_cast<const T*>(columns[column]) + first, count};
+  }
+
+ public:
+  explicit StrandDataset(const std::string& path);
+
+  int getTreeCount() const { return header.treeCount; }
+  StrandDatasetTree getTree(int index) const;
+  int findTree(const std::string& name) const;  // -1 if there is none
+
+  const StrandDatasetHeader& getHeader() const { return header; }
+};
+
+// writes a dataset tree by tree: every column is streamed to its own temporary file, and they are
+// joined by finish(). the temporary files are removed if the writer is destroyed before.
+// errors throw runtime_error
+class StrandDatasetWriter {
+ private:
+  std::string path;
+  StrandDatasetHeader header{};
+  std::array<std::unique_ptr<BufferedWriter>, NUM_STRAND_DATASET_COLUMNS> columns;
+  bool finished{false};
+
+  std::string getColumnPath(int column) const;
+
+ public:
+  explicit StrandDatasetWriter(const std::string& _path);
+  ~StrandDatasetWriter();
+
+  StrandDatasetWriter(const StrandDatasetWriter&) = delete;
+  StrandDatasetWriter& operator=(const StrandDatasetWriter&) = delete;
+
+  void addTree(const StrandDatasetTreeData& tree);
+  void finish();
+
+  int getTreeCount() const { return header.treeCount; }
+};
+
+// a dataset of a single tree, written to a stream at once
+void writeStrandDataset(const StrandDatasetTreeData& tree, std::ostream& out);
+
+// whether the file starts with STRAND_DATASET_MAGIC
+bool isStrandDataset(const std::string& path);
+
+#endif
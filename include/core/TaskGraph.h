@@ -0,0 +1,47 @@
+#ifndef __TASK_GRAPH_H__
+#define __TASK_GRAPH_H__
+
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+// tasks with dependencies (a dag), run by a work-stealing pool: every thread pops the tasks made
+// ready by its own last ones first (lifo, the data is still in its cache), and steals the oldest
+// ones of the other threads when it runs out. on a parallel::serialThread, or with a single
+// hardware thread, the tasks run in order on the calling thread
+class TaskGraph {
+  struct Task {
+    std::function<void()> fn;
+    std::vector<int> successors{};
+    int dependencies{0};
+  };
+
+  std::vector<Task> tasks;
+
+ public:
+  // thrown by a cancelled run
+  struct Cancelled : std::runtime_error {
+    Cancelled() : std::runtime_error("TaskGraph: cancelled") {}
+  };
+
+  // returns the id of the task
+  int add(std::function<void()> fn);
+
+  // `task` starts only once `dependency` is done (the same dependency can be given twice)
+  void depend(int task, int dependency);
+
+  int getTaskCount() const { return tasks.size(); }
+
+  // run every task once, and wait for all of them. the threads of the pool are serial threads
+  // (see Parallel.h). if tasks throw, no other task is started and the first exception is
+  // rethrown. the graph can be run again. a graph with a cycle throws runtime_error before
+  // running anything. `cancelled` (if given) is checked before every task, on the thread about to
+  // run it: once it returns true, no other task is started and Cancelled is thrown
+  void run(const std::function<bool()>& cancelled = {});
+
+ private:
+  void checkAcyclic() const;
+  void runSerial(const std::function<bool()>& cancelled);
+};
+
+#endif
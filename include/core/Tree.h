@@ -1,75 +1,357 @@
 #ifndef __TREE_H__
 #define __TREE_H__
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "core/BufferUpload.h"
 #include "core/PlantGraph.h"
 #include "core/Shader.h"
 #include "core/Strand.h"
+#include "core/StrandDataset.h"
+#include "geometry/BVH.h"
 #include "geometry/Mesh.h"
 
 constexpr int NUM_STRANDS_PER_LEAF = 10;
+constexpr int LOD_THIN_BRANCH_STRANDS = 2 * NUM_STRANDS_PER_LEAF;  // coarser rings below this
 constexpr float NODE_STRAND_AREA_RADIUS = 0.1f;
+constexpr int WARM_START_PBD_ITERATIONS = 30;  // pbd of an updated node, from its previous packing
+constexpr int MIN_ADAPTIVE_SEGMENT_SAMPLES = 3;  // two cross sections, joined by a band of the mesh
 constexpr glm::mat3 DEFAULT_COORDINATES{
     {1.0f, 0.0f,  0.0f},
     {0.0f, 0.0f, -1.0f},
     {0.0f, 1.0f,  0.0f}
 };
 
+// how a level of detail is built from the strands (level 0 is always the full mesh)
+struct LODLevel {
+  int crossSectionStride;  // keep one every `stride` cross sections (0: only the node rings)
+  int thinRingStride;      // keep one every `stride` ring vertices on thin branches
+};
+
+constexpr int NUM_MESH_LOD_LEVELS = 3;  // besides the full mesh
+constexpr LODLevel MESH_LOD_LEVELS[NUM_MESH_LOD_LEVELS]{
+    {2, 1},
+    {4, 2},
+    {0, 4}
+};
+
+// screen-space level of detail of the strand tubes, chosen per branch segment from the width (in
+// pixels) of its closest strands on screen
+struct StrandLODLevel {
+  float minStrandPixels;  // used when the strands are at least this wide
+  int interiorStride;     // draw one every `stride` interior strands (0: boundary strands only)
+  int ringVertices;
+};
+
+constexpr int NUM_STRAND_LOD_LEVELS = 4;
+constexpr StrandLODLevel STRAND_LOD_LEVELS[NUM_STRAND_LOD_LEVELS]{
+    {3.0f,  1, NUM_CIRCLE_VERTICES    },
+    {1.5f,  2, NUM_CIRCLE_VERTICES / 2},
+    {0.75f, 4, NUM_CIRCLE_VERTICES / 4},
+    {0.0f,  0, NUM_CIRCLE_VERTICES / 4}
+};
+
 struct CrossSection {
   std::vector<glm::vec3> particlePositions{};
   std::vector<glm::vec3> particleNormals{};
   std::vector<int> particleStrandIds{};
-  std::vector<int> particleIndices{};
+  std::vector<const StrandParticle*> particles{};  // interpolated, of the branch segment
   std::vector<int> boundaryVertices{};
 
   int getNumParticles() const { return particlePositions.size(); }
 };
 
+// frustum culling results of the last Tree::cullBranches
+struct CullingStats {
+  int testedBoxes{};
+  int visibleBranches{}, totalBranches{};    // nodes whose branch segments (and mesh) are drawn
+  int visibleInstances{}, totalInstances{};  // strand tube segments
+  std::array<int, NUM_STRAND_LOD_LEVELS> branchesPerLOD{};
+  float closestDistance{};  // from the view position to the closest visible branch segment
+};
+
 class Tree {
+  // vertex/triangle counts of the mesh part generated by a node (first pass of generateMeshData)
+  struct NodeMeshLayout {
+    int vertexCount{};
+    int triangleCount{};
+
+    // per cross section: strand id -> index in its boundary loop
+    std::vector<std::unordered_map<int, int>> boundaryLookup{};
+  };
+
   PlantGraph& pg;
 
   std::map<int, glm::mat3> frontplanes;
   std::vector<Strand> strands;
   std::map<int, std::vector<std::shared_ptr<StrandParticle>>> nodeParticles;
+  std::map<int, std::vector<glm::vec3>> mergedLayouts;  // node particles local positions (pre-PBD)
 
+  // interpolated particles of the branch segment from a node (key) to its parent. its samples are
+  // shared by all its strands (so that they form cross sections): every strand going on to the
+  // parent has samples - 1 particles. they are allocated at once, and the strands hold aliases of
+  // the whole block
+  struct SegmentParticles {
+    int samples{NUM_INTERPOLATED_POINTS};
+    std::vector<std::pair<int, int>> strandOffsets{};  // (strand id, first particle), by strand id
+    std::shared_ptr<std::vector<StrandParticle>> particles{};
+
+    // first particle of the strand, -1 if it doesn't go on to the parent
+    int findStrand(int strandId) const;
+  };
+  std::map<int, SegmentParticles> segmentParticles;
+
+  // branch segments computed so far (see computeBranchSegments)
   std::map<int, std::vector<CrossSection>> interpolatedCrossSections;
 
   // maps a pair (node id, cross section index) to its corresponding triangle indices
   std::map<std::pair<int, int>, std::vector<glm::uvec3>> crossSectionsTriangulations;
+  bool eagerCrossSections{false};
+
+  // batched strand rendering: the generalized cylinders of all the strands share one buffer
+  unsigned int strandVao{}, strandVbo{}, strandEbo{};
+  std::vector<int> strandIndexOffsets;  // first index of each strand (total at the end)
+  std::vector<bool> strandVisibility;
+  std::vector<int> visibleStrandCounts;  // index ranges of the visible strands
+  std::vector<const void*> visibleStrandOffsets;
+
+  // shader-side strand tubes: only the particles (position, normal and binormal of their frame)
+  // are uploaded, and a ring template is instanced once per strand segment
+  unsigned int tubeVao{}, tubeInstanceVbo{}, particleBuffer{}, particleTexture{};
+  std::vector<glm::vec4> tubeParticleData;  // cpu side, until uploaded
+  std::vector<StrandTubeInstance> tubeInstanceData;
+  std::vector<BufferUpload> tubeUploads;  // pending uploads
+  // (first instance, count) of the visible tube instances, per strand level of detail
+  std::array<std::vector<std::pair<int, int>>, NUM_STRAND_LOD_LEVELS> visibleInstanceRanges;
+
+  // the tube instances are grouped by the node their branch segment starts at, then by strand:
+  // boundary strands first, then the interior ones in an order whose prefixes are spread over the
+  // cross section (so that a level of detail draws a prefix of the runs)
+  struct TubeRun {
+    int strandId, first, count;
+  };
+  std::vector<std::vector<TubeRun>> nodeTubeRuns;
+  std::vector<int> nodeBoundaryRuns;  // amount of boundary strand runs of every node
+  std::vector<int> nodeStrandLODs;     // selected level of every node (empty: full detail)
+
+  // frustum culling: hierarchy over the bounds of the branch segments starting at every node
+  BVH branchBVH;
+  std::vector<bool> nodeVisibility;  // empty if nothing was culled yet
+  std::vector<int> visibleNodes;
+  std::vector<int> previousVisibleNodes;  // of the culling before (kept to reuse its memory)
+  std::vector<AABB> nodeBounds;
+  CullingStats cullingStats;
+
+  // point cloud of all the strand particles, updated only for the strands whose particles moved
+  unsigned int particleVao{}, particleVbo{};
+  std::vector<int> strandParticleOffsets;  // first particle of each strand (total at the end)
+  std::set<int> particleDirtyStrands;
+
+  // adaptive strand resampling: chord tolerance (0 = always NUM_INTERPOLATED_POINTS samples)
+  float adaptiveSamplingTolerance{0.0f};
+
+  // random numbers of the strands (leaf layouts and colors) are derived from it
+  unsigned int seed{0};
+
+  // strand bundling: most strands a node can have before they are bundled (0 = never)
+  int maxNodeStrands{0};
+
+  // superseded computations stop between their tasks (see setCancellation)
+  std::function<bool()> cancellation;
+
+  // a strand of a child entering the merged layout of a node
+  struct MergedStrand {
+    std::shared_ptr<StrandParticle> childParticle;
+    glm::vec3 localPos;
+    int weight;
+  };
+
+  // by strand id: the super-strand a strand ended in (-1 if none), and the offset of the strand
+  // from the bundle centroid in the merged layout (see expandSuperStrands)
+  struct BundledStrand {
+    int superStrand{-1};
+    glm::vec3 offset{0.0f};
+  };
+  std::vector<BundledStrand> bundledStrands;
 
  public:
   Tree(PlantGraph& _pg) : pg{_pg} {}
 
-  // strand position computation
+  // strand position computation, as one task graph: every node is merged once its children are
+  // and packed right after, every branch segment is interpolated once the nodes around it are
+  // packed, and the strands of a leaf get their interpolated particles once all the segments on
+  // their way are
   void computeStrandsPosition();
 
-  // mesh generation
-  void computeCrossSections();
-  Mesh generateMesh() const;
+  // same, through the strand layout cache in `cacheDir`: the strands and node particles after pbd
+  // are stored under a hash of the plant graph, the seed and the generation constants. a valid
+  // entry is loaded instead of running pbd (stale or corrupted ones are recomputed and replaced).
+  // returns whether the layout was loaded from the cache
+  bool computeStrandsPosition(const std::string& cacheDir);
+
+  void setSeed(unsigned int _seed) { seed = _seed; }
+
+  // hierarchical super-strands: where the strands merged in a node outnumber `maxNodeStrands`,
+  // the strands of every child are bundled into spatially coherent groups. the heaviest strand of
+  // a group goes on as a super-strand with the weight (and tube area) of the group, and the others
+  // end at the child. this bounds the cost of pbd, cross sections and meshes towards the trunk
+  // independently of the leaf count, while the thin branches keep their individual strands.
+  // 0 disables bundling (applied on the next computeStrandsPosition)
+  void setStrandBundling(int _maxNodeStrands) { maxNodeStrands = _maxNodeStrands; }
+
+  // full detail in the subtrees of the given nodes: the strands bundled in them go on to the
+  // subtree root, following their super-strands at their offset in the bundle (without pbd), and
+  // every strand there is an individual one again. the strands are interpolated again and the
+  // branch segments dropped, so it is meant before the mesh generation. strands loaded from a
+  // cache or a dataset don't know their bundles and stay as they are. the next update bundles
+  // the strands of the nodes it merges again
+  void expandSuperStrands(const std::vector<int>& nodeIds);
+
+  // strand dataset (see StrandDataset.h): the strands with their interpolated particles, and the
+  // node particles
+  StrandDatasetTreeData generateStrandData() const;
+
+  // instead of computeStrandsPosition: the strands and node particles of a dataset tree, with their
+  // stored interpolated particles (nothing is packed or interpolated again, and the sampling of
+  // the dataset is kept). the plant graph must be the tree's (StrandDatasetTree::createGraph),
+  // else runtime_error is thrown. the layouts before pbd are not stored, so the tree can't be
+  // updated afterwards
+  void loadStrands(const StrandDatasetTree& layout);
+
+  // recompute only what is affected by the nodes added/moved in the plant graph since the last
+  // computation (the pbd of the ancestors starts from their previous packing). returns the nodes
+  // whose mesh ranges must be regenerated
+  std::set<int> update();
+
+  // sample each branch segment only as much as needed to stay within `chordTolerance` of the
+  // strands curves, and at least MIN_ADAPTIVE_SEGMENT_SAMPLES times so that every segment keeps
+  // its surface in the mesh (applied on the next computeStrandsPosition). 0 disables it
+  void setAdaptiveSampling(float chordTolerance) { adaptiveSamplingTolerance = chordTolerance; }
+
+  // `cancelled` is checked before every task of the strand computations and of the branch segment
+  // computations (see TaskGraph::run): once it returns true they throw TaskGraph::Cancelled, and
+  // the tree is left incomplete (it must be computed again)
+  void setCancellation(std::function<bool()> cancelled) { cancellation = std::move(cancelled); }
+
+  // mesh generation: the cross sections of a branch segment and their triangulations are only
+  // computed when first needed (mesh generation, or computeBranchSegments) and kept until an
+  // update changes the segment. a tree whose mesh is never generated never computes them, unless
+  // they are computed eagerly: then computeStrandsPosition computes all of them in its task graph,
+  // overlapping the pbd of the nodes above.
+  // the methods below store the branch segments they compute: they must not run concurrently with
+  // each other or with the strand computations on the same tree. they only read the strands, so
+  // the render methods may run meanwhile on another thread
+  void setEagerCrossSections(bool eager) { eagerCrossSections = eager; }
+  // branch segments from the given nodes to their children, if not computed yet (one task each)
+  void computeBranchSegments(const std::vector<int>& nodeIds);
+  Mesh generateMesh(VertexFormat format = VertexFormat::FULL);
+  MeshData generateMeshData(bool withStrandIds = false);
+
+  // full mesh followed by the coarser MESH_LOD_LEVELS: boundary rings only (no cross section
+  // interiors), fewer cross sections and coarser rings on thin branches
+  std::vector<MeshLOD> generateMeshLODs();
+
+  // regenerate the mesh ranges of the given nodes in place. if their sizes changed, the whole
+  // mesh data is regenerated instead and false is returned
+  bool updateMeshData(MeshData& data, const std::set<int>& nodes);
 
   // render methods
   void initializeStrandBuffers();
-  void renderStrands(const Shader& sh) const;
+  void renderStrands() const;
+  void initializeStrandTubes();  // prepareStrandTubes + createStrandTubeBuffers + whole upload
+  void prepareStrandTubes();     // cpu only: can run on any thread
+  void createStrandTubeBuffers();
+  // upload at most `budget` bytes of the tubes, and take them from it. returns whether they are
+  // completely uploaded (nothing is drawn before)
+  bool uploadStrandTubes(std::size_t& budget);
+  void deleteBuffers();
+  void renderStrandTubes(const Shader& sh) const;
+  void setStrandVisible(int strandId, bool visible);
+  // frustum culling of the branch segments (strand tubes and mesh ranges of their start node)
+  void buildBoundingHierarchy();
+  // with a `pixelsPerUnit` (size in pixels of one world unit at distance 1 from `viewPos`), the
+  // strand level of detail of the visible branch segments is also selected
+  void cullBranches(
+      const Frustum& frustum, const glm::vec3& viewPos = {}, float pixelsPerUnit = 0.0f
+  );
+  const std::vector<int>& getVisibleNodes() const { return visibleNodes; }  // ordered by id
+  const CullingStats& getCullingStats() const { return cullingStats; }
+
+  void initializeStrandParticles();
+  void updateStrandParticles();  // uploads the strands changed since the last call (see update)
   void renderStrandParticles() const;
   // void renderCoordinateSystems(const Shader& sh) const;
 
+  // color of every strand, by id
+  std::vector<glm::vec4> getStrandColors() const;
+  const std::vector<Strand>& getStrands() const { return strands; }  // indexed by id
+
   void printNodeParticles(int nodeId) const;
 
  private:
-  void computeStrandsInNode(int nodeId);
+  void createLeafStrands(int nodeId);
+  void mergeChildrenStrands(int nodeId);
+  std::vector<MergedStrand> bundleStrands(
+      const std::vector<MergedStrand>& merged, const std::vector<int>& childOffsets
+  );
   void computeCoordinateSystems();
+  void computeCoordinateSystem(int nodeId);
+
+  // strand layout cache
+  std::uint64_t computeLayoutKey() const;
+  bool loadStrandLayout(const std::string& path, std::uint64_t key);
+  void saveStrandLayout(const std::string& path, std::uint64_t key) const;
+
+  // pbd simulation. given where the strands of the node were packed before (by strand id), an
+  // update starts from there if most of them were, with WARM_START_PBD_ITERATIONS plus the usual
+  // iterations of the new strands only (which start from their merged position)
+  void applyPBD(int nodeId, const std::unordered_map<int, glm::vec3>& previous = {});
 
-  // pbd simulation
-  void applyPBD();
+  // task graph of computeStrandsPosition, without the merges and pbd if the node particles were
+  // loaded instead
+  void runStrandTasks(bool packLayouts);
 
-  // mesh preprocessing
-  void triangulateCrossSections();
-  void interpolateBranchSegment(int branchStartNode);
+  // strand interpolation
+  SegmentParticles interpolateSegment(int childId) const;
+  int getSegmentSamples(int childId) const;
+  void spliceSegmentParticles(int strandId);  // node particles, then the segments in between
+
+  // mesh preprocessing: a branch segment is computed by a task, and stored once its graph ran
+  struct BranchSegment {
+    std::vector<CrossSection> crossSections{};
+    std::vector<std::vector<glm::uvec3>> triangulations{};  // node particles, then cross sections
+  };
+  BranchSegment computeBranchSegment(int branchStartNode) const;
+  void storeBranchSegment(int branchStartNode, BranchSegment&& segment);
+  std::vector<CrossSection> interpolateBranchSegment(int branchStartNode) const;
+  // triangulations of the node particles, then of every cross section (whose boundary is set)
+  std::vector<std::vector<glm::uvec3>> triangulateCrossSections(
+      int nodeId, std::vector<CrossSection>& crossSections
+  ) const;
+
+  // rendering
+  void orderStrandTubeRuns();
+  void updateVisibleStrandRanges();
+
+  // level of detail generation
+  struct Ring;
+  std::vector<Ring> computeBranchSegmentRings(int branchStartNode, int childIdx) const;
+
+  // mesh generation
+  NodeMeshLayout computeNodeMeshLayout(int nodeId) const;
+  void fillNodeMesh(
+      int nodeId, const NodeMeshLayout& layout, const MeshRange& range, MeshData& data
+  ) const;
 };
 
 #endif
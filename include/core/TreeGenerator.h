@@ -0,0 +1,93 @@
+#ifndef __TREE_GENERATOR_H__
+#define __TREE_GENERATOR_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/PlantGraph.h"
+#include "core/SPSCQueue.h"
+#include "core/Tree.h"
+#include "geometry/Mesh.h"
+
+// a tree computed in the background, ready to be uploaded by the render thread
+struct GeneratedTree {
+  std::unique_ptr<PlantGraph> graph;  // snapshot the tree refers to
+  std::unique_ptr<Tree> tree;         // strands and cpu side strand tubes
+  std::vector<MeshLOD> meshLODs;      // full mesh, then the coarser ones (none if not wanted)
+  bool hasMesh{};
+  float seconds{};  // generation time
+  bool cached{};    // strand layout loaded from the cache
+};
+
+struct TreeGeneratorOptions {
+  unsigned int seed{0};
+  int maxNodeStrands{0};   // strand bundling (see Tree::setStrandBundling)
+  float chordTolerance{};  // adaptive sampling of the strands (see Tree::setAdaptiveSampling)
+  std::string cacheDir{};  // strand layout cache (none if empty)
+};
+
+// generates trees on a worker thread: the render thread requests plant graphs and polls the
+// finished trees, both without blocking. only the latest pending request is generated. the worker
+// also generates the mesh of trees generated without it
+class TreeGenerator {
+ private:
+  const TreeGeneratorOptions options;
+
+  SPSCQueue<std::unique_ptr<PlantGraph>, 8> requests;     // render thread -> worker
+  SPSCQueue<std::unique_ptr<GeneratedTree>, 2> results;  // worker -> render thread
+
+  // trees whose mesh is generated afterwards, while the render thread draws them
+  SPSCQueue<std::shared_ptr<GeneratedTree>, 2> meshRequests;
+  SPSCQueue<std::shared_ptr<GeneratedTree>, 2> meshResults;
+
+  std::atomic<int> pendingRequests{0};
+  std::atomic<int> pendingMeshes{0};
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> meshWanted{true};
+
+  // the idle worker sleeps until a request arrives (never held by the render thread)
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+
+  std::thread worker;
+
+ public:
+  explicit TreeGenerator(TreeGeneratorOptions _options = {})
+      : options{std::move(_options)}, worker{&TreeGenerator::run, this} {}
+  ~TreeGenerator();
+
+  TreeGenerator(const TreeGenerator&) = delete;
+  TreeGenerator& operator=(const TreeGenerator&) = delete;
+
+  // generate the tree of a copy of `graph`. returns false if too many requests are pending
+  bool request(const PlantGraph& graph);
+
+  // take a finished tree, if there is one
+  bool poll(std::unique_ptr<GeneratedTree>& result) { return results.pop(result); }
+
+  // generate the mesh data of a tree generated without it. until it is polled back, the render
+  // thread may only draw the tree (see Tree::computeBranchSegments) and must not touch its mesh
+  // data. returns false if too many meshes are pending
+  bool requestMesh(std::shared_ptr<GeneratedTree> generated);
+
+  // take a tree whose mesh data was generated, if there is one
+  bool pollMesh(std::shared_ptr<GeneratedTree>& result) { return meshResults.pop(result); }
+
+  bool isBusy() const { return pendingRequests.load() > 0 || pendingMeshes.load() > 0; }
+
+  // whether the next trees are generated with their mesh (else only their strands: the cross
+  // sections are computed if the mesh is generated later, see Tree::setEagerCrossSections)
+  void setMeshWanted(bool wanted) { meshWanted = wanted; }
+
+ private:
+  void run();
+  std::unique_ptr<GeneratedTree> generate(std::unique_ptr<PlantGraph> graph) const;
+  void generateMesh(GeneratedTree& generated) const;
+};
+
+#endif
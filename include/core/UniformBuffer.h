@@ -0,0 +1,51 @@
+#ifndef __UNIFORM_BUFFER_H__
+#define __UNIFORM_BUFFER_H__
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "core/Shader.h"
+
+// per-frame camera data, laid out as the std140 "Camera" block of the shaders:
+//
+// layout (std140) uniform Camera {
+//   mat4 projection;
+//   mat4 view;
+//   vec4 viewPos;
+//   vec4 lightDir;
+// };
+struct CameraBlock {
+  glm::mat4 projection;
+  glm::mat4 view;
+  glm::vec4 viewPos;
+  glm::vec4 lightDir;
+};
+
+// uniform buffer of the camera block, shared by every program (uploaded once per frame)
+class CameraUniformBuffer {
+ private:
+  unsigned int ubo{};
+
+ public:
+  void initialize() {
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, ubo);
+  }
+
+  void update(
+      const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos,
+      const glm::vec3& lightDir
+  ) const {
+    CameraBlock block{projection, view, glm::vec4(viewPos, 1.0f), glm::vec4(lightDir, 0.0f)};
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include <vector>
+
+#include "geometry/Bounds.h"
+
+constexpr int BVH_MAX_LEAF_ITEMS = 4;
+
+// bounding volume hierarchy over a set of boxes, identified by their index
+class BVH {
+ private:
+  struct Node {
+    AABB bounds{};
+    int left{-1}, right{-1};  // children (-1 for leaves)
+    int first{}, count{};     // items of the subtree in `items`
+  };
+
+  std::vector<Node> nodes;
+  std::vector<int> items;
+  std::vector<AABB> itemBounds;  // bounds of items[i]
+
+ public:
+  // empty boxes are left out of the hierarchy
+  void build(const std::vector<AABB>& bounds);
+
+  bool isEmpty() const { return nodes.empty(); }
+
+  // append to `visible` the items whose box is not outside the frustum. returns the number of
+  // boxes tested (the items under a box fully inside the frustum are not tested)
+  int cull(const Frustum& frustum, std::vector<int>& visible) const;
+
+ private:
+  int buildNode(const std::vector<AABB>& bounds, int first, int count);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef __BOUNDS_H__
+#define __BOUNDS_H__
+
+#include <array>
+#include <limits>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+// axis aligned bounding box (empty until something is added)
+struct AABB {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+  bool isEmpty() const { return min.x > max.x; }
+  glm::vec3 getCenter() const { return 0.5f * (min + max); }
+
+  void expand(const glm::vec3& p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+
+  void expand(const AABB& box) {
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+  }
+
+  void pad(float margin) {
+    min -= glm::vec3(margin);
+    max += glm::vec3(margin);
+  }
+};
+
+// view frustum as 6 inward facing planes (a, b, c, d): a x + b y + c z + d >= 0 inside
+struct Frustum {
+  enum class Containment { OUTSIDE, INTERSECTS, INSIDE };
+
+  std::array<glm::vec4, 6> planes{};
+
+  // planes extracted from the clip space matrix (Gribb & Hartmann)
+  explicit Frustum(const glm::mat4& viewProjection) {
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i) {
+      row[i] = {
+          viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]
+      };
+    }
+
+    for (int i = 0; i < 3; ++i) {
+      planes[2 * i] = row[3] + row[i];
+      planes[2 * i + 1] = row[3] - row[i];
+    }
+
+    for (auto& plane : planes) plane /= glm::length(glm::vec3(plane));
+  }
+
+  Containment classify(const AABB& box) const {
+    Containment result = Containment::INSIDE;
+
+    for (const auto& plane : planes) {
+      const glm::vec3 normal(plane);
+
+      // box corners furthest along and against the plane normal
+      glm::vec3 positive = box.min, negative = box.max;
+      for (int k = 0; k < 3; ++k) {
+        if (normal[k] >= 0.0f) std::swap(positive[k], negative[k]);
+      }
+
+      if (glm::dot(normal, positive) + plane.w < 0.0f) return Containment::OUTSIDE;
+      if (glm::dot(normal, negative) + plane.w < 0.0f) result = Containment::INTERSECTS;
+    }
+
+    return result;
+  }
+};
+
+#endif
@@ -1,16 +1,87 @@
 #ifndef __MESH_H__
 #define __MESH_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+// contiguous range of vertices and triangles inside a mesh (e.g. the part generated by one node)
+struct MeshRange {
+  int vertexOffset{};
+  int vertexCount{};
+  int triangleOffset{};
+  int triangleCount{};
+};
+
+// cpu-side mesh buffers, not yet uploaded to the gpu
+struct MeshData {
+  std::vector<glm::vec3> vertices{};
+  std::vector<glm::vec3> normals{};
+  std::vector<glm::uvec3> indices{};  // triangle indices
+  std::vector<MeshRange> ranges{};
+  std::vector<int> strandIds{};  // strand of every vertex (optional, for exports)
+};
+
+// one level of detail of a mesh, with the maximum distance (world units) between its surface and
+// the full resolution one
+struct MeshLOD {
+  MeshData data{};
+  float geometricError{};
+};
+
+// coarsest level whose error, once projected, stays under `maxScreenError` pixels.
+// `pixelsPerUnit` is the size in pixels of one world unit at distance 1 from the camera
+// (viewport height / (2 tan(fov / 2)))
+inline int selectLOD(
+    const std::vector<MeshLOD>& lods, float distance, float pixelsPerUnit, float maxScreenError
+) {
+  int selected = 0;
+  for (int i = 0; i < lods.size(); ++i) {
+    if (lods[i].geometricError * pixelsPerUnit / distance <= maxScreenError) selected = i;
+  }
+
+  return selected;
+}
+
+// how the vertices and indices of a mesh are stored on the gpu
+enum class VertexFormat {
+  FULL,        // float positions and normals, 32-bit indices (24 bytes per vertex)
+  COMPRESSED,  // 16-bit positions quantized in the mesh bounds, 10_10_10_2 normals and 16-bit
+               // indices when there are at most 65536 vertices (12 bytes per vertex)
+};
+
+// gpu memory used by a mesh, in bytes
+struct MeshMemory {
+  std::size_t vertexBytes{};
+  std::size_t indexBytes{};
+
+  std::size_t getTotal() const { return vertexBytes + indexBytes; }
+};
+
 class Mesh {
  private:
   unsigned int vao, vbo, ebo;
+
+  // cpu copies (empty after releaseCpuData)
   std::vector<glm::vec3> vertices;
   std::vector<glm::vec3> normals;
   std::vector<glm::uvec3> indices;  // triangle indices
+  std::vector<MeshRange> ranges;
+
+  int vertexCount{}, triangleCount{};
+  bool withNormals{false};
+
+  // progress of the upload to the gpu buffers
+  int uploadedVertices{}, uploadedTriangles{};
+
+  VertexFormat format{VertexFormat::FULL};
+  bool shortIndices{false};
+
+  // compressed positions are decoded as positionOffset + positionScale * [0, 1] (in the shader)
+  glm::vec3 positionOffset{0.0f};
+  glm::vec3 positionScale{1.0f};
 
  public:
   Mesh(
@@ -29,10 +100,70 @@ class Mesh {
     init();
   }
 
+  // with `deferUpload`, the gpu buffers are only allocated: they are filled by uploadStep
+  explicit Mesh(
+      MeshData&& data, VertexFormat _format = VertexFormat::FULL, bool deferUpload = false
+  )
+      : vertices{std::move(data.vertices)},
+        normals{std::move(data.normals)},
+        indices{std::move(data.indices)},
+        ranges{std::move(data.ranges)},
+        format{_format} {
+    init(deferUpload);
+  }
+
+  // upload at most `budget` bytes of the remaining vertices and triangles, and take them from it.
+  // returns whether the whole mesh is uploaded (nothing is drawn before)
+  bool uploadStep(std::size_t& budget);
+  bool isUploaded() const {
+    return uploadedVertices == vertexCount && uploadedTriangles == triangleCount;
+  }
+
+  void deleteBuffers();
+
   void render() const;
 
+  // draw only the given ranges (ordered by offset, so that consecutive ones are drawn together)
+  void render(const std::vector<int>& rangeIds) const;
+
+  // replace the vertices and triangles of a range (same sizes) with the ones in `data`. returns
+  // false, without changing anything, if a compressed mesh can not hold them (vertices out of the
+  // quantization bounds): the mesh must be rebuilt instead
+  bool updateRange(const MeshData& data, const MeshRange& range);
+
+  // free the cpu copies of the vertices, normals and indices once they are on the gpu (ranges
+  // can still be drawn and updated). does nothing before the upload is done
+  void releaseCpuData();
+  bool hasCpuData() const { return vertices.size() == vertexCount; }
+
+  // shaders decode the compressed positions with these (identity for the full format)
+  const glm::vec3& getPositionOffset() const { return positionOffset; }
+  const glm::vec3& getPositionScale() const { return positionScale; }
+
+  int getVertexCount() const { return vertexCount; }
+  int getTriangleCount() const { return triangleCount; }
+
+  MeshMemory getMemoryUsage() const {
+    return computeMemoryUsage(vertexCount, triangleCount, withNormals, format);
+  }
+
+  static MeshMemory computeMemoryUsage(
+      std::size_t vertexCount, std::size_t triangleCount, bool withNormals, VertexFormat format
+  );
+
  private:
-  void init();
+  std::size_t getVertexSize() const;
+  std::size_t getIndexSize() const {
+    return shortIndices ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+  }
+
+  void init(bool deferUpload = false);
+
+  // write `count` vertices / triangles in the gpu format of the mesh
+  void writeVertices(
+      const glm::vec3* positions, const glm::vec3* vertexNormals, int count, unsigned char* out
+  ) const;
+  void writeIndices(const glm::uvec3* triangles, int count, unsigned char* out) const;
 };
 
 #endif
@@ -0,0 +1,39 @@
+#ifndef __MESH_EXPORT_H__
+#define __MESH_EXPORT_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "geometry/Mesh.h"
+
+struct MeshExportOptions {
+  // per-strand channels, written for every vertex from MeshData::strandIds (when it is filled):
+  // the strand id, and its color if `strandColors` (indexed by strand id) is not empty
+  bool strandIds{true};
+  std::vector<glm::vec4> strandColors{};
+
+  // glb only: 16-bit positions (dequantized by the node transform) and 8-bit normals, as allowed
+  // by KHR_mesh_quantization
+  bool quantize{false};
+};
+
+// binary (little endian) exports, streamed to disk (or to a stream) through a large write
+// buffer. errors throw runtime_error
+void exportPLY(
+    const MeshData& data, const std::string& path, const MeshExportOptions& options = {}
+);
+void exportPLY(const MeshData& data, std::ostream& out, const MeshExportOptions& options = {});
+void exportGLB(
+    const MeshData& data, const std::string& path, const MeshExportOptions& options = {}
+);
+void exportGLB(const MeshData& data, std::ostream& out, const MeshExportOptions& options = {});
+
+// format chosen from the extension of `path` (.ply or .glb)
+void exportMesh(
+    const MeshData& data, const std::string& path, const MeshExportOptions& options = {}
+);
+
+#endif
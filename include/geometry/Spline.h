@@ -1,6 +1,7 @@
 #ifndef __SPLINE_H__
 #define __SPLINE_H__
 
+#include <array>
 #include <vector>
 
 #include <glad/glad.h>
@@ -10,6 +11,14 @@ constexpr int NUM_INTERPOLATED_POINTS = 10;  // 10 points between each other whe
 constexpr float SPLINE_ALPHA = 0.5f;         // centripetal catmull-rom
 constexpr float SPLINE_TENSION = 0.6f;
 
+// control points p0, p1, p2, p3 of the catmull-rom segment [p1, p2)
+using SegmentControlPoints = std::array<glm::vec3, 4>;
+
+// catmull-rom segment in polynomial form: p(t) = a * t^3 + b * t^2 + m1 * t + p1
+struct SplineSegment {
+  glm::vec3 a, b, m1, p1;
+};
+
 class Spline {
  private:
   // vertex data for rendering
@@ -33,11 +42,36 @@ class Spline {
   // interpolate the points given and return the newly interpolated vertices
   static std::vector<glm::vec3> interpolate(const std::vector<glm::vec3>& points_);
 
+  // same as above, writing exactly getNumInterpolatedPoints(nPoints) vertices to `out`. if given,
+  // segment i (from points_[i] to points_[i + 1]) is sampled segmentSamples[i] times instead of
+  // NUM_INTERPOLATED_POINTS
+  static void interpolate(
+      const glm::vec3* points_, int nPoints, glm::vec3* out, const int* segmentSamples = nullptr
+  );
+
+  // interpolate many independent segments at once, each sampled `nSamples` times: the samples in
+  // [0, 1) of segment i are written to [i * nSamples, (i + 1) * nSamples) of a single contiguous
+  // buffer (the same values as the corresponding samples of a whole spline)
+  static void interpolateSegments(
+      const SegmentControlPoints* controlPoints, int count, int nSamples, glm::vec3* out
+  );
+
+  static int getNumInterpolatedPoints(int nPoints) {
+    return (nPoints - 1) * NUM_INTERPOLATED_POINTS + 1;
+  }
+
+  // smallest amount of samples (up to NUM_INTERPOLATED_POINTS) needed in the segment [p1, p2) so
+  // that the polyline does not deviate more than `chordTolerance` from the curve
+  static int computeSegmentSamples(
+      const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
+      float chordTolerance
+  );
+
   void initializeBuffers();
 
  private:
-  static glm::vec3 catmullRom(
-      const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t
+  static SplineSegment computeSegment(
+      const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3
   );
 };
 
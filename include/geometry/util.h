@@ -1,6 +1,7 @@
 #ifndef __GEOMETRY_UTILS_H__
 #define __GEOMETRY_UTILS_H__
 
+#include <utility>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -18,6 +19,22 @@ std::vector<int> computeBoundaryVertices(
     const std::vector<glm::vec2>& planarCoords, const std::vector<glm::uvec3>& triangles
 );
 
+// connect two closed rings of vertices ([offsetA, offsetA + sizeA) and [offsetB, offsetB + sizeB)
+// of `vertices`) with a band of triangles. both rings must turn counterclockwise around the
+// direction going from ring A to ring B, so that the triangles face outwards
+void stitchRings(
+    const std::vector<glm::vec3>& vertices, int offsetA, int sizeA, int offsetB, int sizeB,
+    std::vector<glm::uvec3>& triangles
+);
+
+// split the points [first, last) of `order` (indices in `points`) into `clusterCount` clusters of
+// similar sizes, of points close to each other in the xy plane (median splits along the widest
+// axis). `order` is permuted so that every cluster is a range of it, appended to `clusters`
+void splitClusters(
+    const std::vector<glm::vec3>& points, std::vector<int>& order, int first, int last,
+    int clusterCount, std::vector<std::pair<int, int>>& clusters
+);
+
 };  // namespace util
 
 #endif
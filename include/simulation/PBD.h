@@ -11,6 +11,23 @@
 constexpr float GAMMA_ATTRACTION = 500.0f;
 constexpr int SOLVER_INTERATIONS = 50;
 
+// point sets this large are bucketed in a grid to find the collisions
+constexpr int COLLISION_GRID_POINTS = 64;
+
+// multilevel packing (see PBD::executeMultilevel)
+constexpr int MULTILEVEL_PBD_POINTS = 512;  // smaller sets are solved directly
+constexpr int MULTILEVEL_CLUSTER_POINTS = 64;
+constexpr int MULTILEVEL_MIN_ITERATIONS = 50;
+constexpr int MULTILEVEL_POLISH_ITERATIONS = 50;
+constexpr float MULTILEVEL_CLUSTER_PACKING = 1.1f;  // disk radius over the radius of its area
+
+// pairs (i, j), i < j, of the points closer than the sum of their radii (`radius` for all of them
+// if `radii` is empty). sets of COLLISION_GRID_POINTS points or more are bucketed in a grid
+void findCollisions(
+    const std::vector<glm::vec3>& points, float radius, const std::vector<float>& radii,
+    std::set<std::pair<int, int>>& collisions
+);
+
 // position based dynamics class
 // no masses are considered (w = m = 1)
 class PBD {
@@ -24,6 +41,7 @@ class PBD {
   float dt{};
   float kdamping{};
   float particleRadius{};
+  std::vector<float> radii{};  // of every point (particleRadius for all if empty)
 
   CollisionConstraint collisionConstraint;
   CircularProfileConstraint boundaryConstraint;
@@ -42,15 +60,28 @@ class PBD {
 
   std::vector<glm::vec3> execute(int iterations, glm::vec3 profileCenter, float profileRadius);
 
+  // same, coarse to fine: the clusters (disjoint sets of point indices covering all the points)
+  // are packed as disks of their area first, then the points within every cluster (for a share
+  // of the iterations proportional to its points), then all of them for a few iterations
+  std::vector<glm::vec3> executeMultilevel(
+      int iterations, glm::vec3 profileCenter, float profileRadius,
+      const std::vector<std::vector<int>>& clusters
+  );
+
   void setPoints(const std::vector<glm::vec3>& points) {
     x = points;
     v.resize(x.size());
     p.resize(x.size());
+    radii.clear();
   }
 
+  // collision radius of every point (after setPoints)
+  void setRadii(const std::vector<float>& _radii) { radii = _radii; }
+
  private:
   void simulate();
   glm::vec3 computeExternalForces(int idx);
+  float getRadius(int idx) const { return radii.empty() ? particleRadius : radii[idx]; }
 
   void solve(const std::set<std::pair<int, int>>& mcoll);
 };
@@ -43,6 +43,8 @@ class CollisionConstraint : public PBDConstraint<2> {
   )
       : PBDConstraint<2>(_type, _stiffness, _points), pointRadius{d} {}
 
+  void setRadius(float d) { pointRadius = d; }
+
   std::array<glm::vec3, 2> computeCorrection() const override {
     glm::vec3 u = points[0] - points[1];
     float len = glm::length(u);
@@ -2,14 +2,25 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
+layout (std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec4 viewPos;
+	vec4 lightDir;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// decoding of quantized positions (identity for float positions)
+uniform vec3 positionOffset = vec3(0.0f);
+uniform vec3 positionScale = vec3(1.0f);
 
 out vec3 fNormal;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+	vec3 pos = positionOffset + positionScale * aPos;
+
+	gl_Position = projection * view * model * vec4(pos, 1.0f);
 	fNormal = mat3(transpose(inverse(model))) * aNormal;
 }
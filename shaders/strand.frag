@@ -0,0 +1,9 @@
+#version 330 core
+
+in vec4 fColor;
+
+out vec4 fragColor;
+
+void main() {
+  fragColor = fColor;
+}
\ No newline at end of file
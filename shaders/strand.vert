@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+
+layout (std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec4 viewPos;
+	vec4 lightDir;
+};
+
+uniform mat4 model;
+
+out vec4 fColor;
+
+void main()
+{
+	gl_Position = projection * view * model * vec4(aPos, 1.0f);
+	fColor = aColor;
+}
@@ -0,0 +1,36 @@
+#version 330 core
+layout (location = 0) in int aParticle;  // first particle of the segment (per instance)
+layout (location = 1) in vec4 aColor;
+
+// 3 texels per particle: position (w: radius scale), normal and binormal of its frame
+uniform samplerBuffer particles;
+uniform int ringVertices;
+uniform float strandRadius;
+
+layout (std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec4 viewPos;
+	vec4 lightDir;
+};
+
+uniform mat4 model;
+
+out vec4 fColor;
+
+void main()
+{
+	// triangle strip alternating between the rings at both ends of the segment
+	int particle = aParticle + gl_VertexID % 2;
+	float theta = 6.28318530718f * float(gl_VertexID / 2) / float(ringVertices);
+
+	vec4 particleData = texelFetch(particles, 3 * particle);
+	vec3 pos = particleData.xyz;
+	vec3 normal = texelFetch(particles, 3 * particle + 1).xyz;
+	vec3 binormal = texelFetch(particles, 3 * particle + 2).xyz;
+
+	pos += strandRadius * particleData.w * (cos(theta) * normal + sin(theta) * binormal);
+
+	gl_Position = projection * view * model * vec4(pos, 1.0f);
+	fColor = aColor;
+}
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/Parallel.h"
+#include "core/PlantGraph.h"
+#include "core/PlantGraphIO.h"
+#include "core/StrandDataset.h"
+#include "core/Tree.h"
+#include "geometry/MeshExport.h"
+
+namespace fs = std::filesystem;
+
+// rough peak memory of a tree generation, per interpolated strand particle (particle, cross
+// section data, triangulation and mesh vertices)
+constexpr std::size_t BYTES_PER_STRAND_SAMPLE = 512;
+
+struct BatchOptions {
+  unsigned int threads{parallel::getNumThreads()};
+  std::size_t memoryBytes{0};  // cap of the estimated memory of the trees in flight (0: none)
+  std::string meshFormat{".glb"};
+  bool quantize{false};
+  bool strands{true};
+  unsigned int seed{0};
+  int maxNodeStrands{0};  // strand bundling (see Tree::setStrandBundling)
+  float chordTolerance{};  // adaptive sampling of the strands (see Tree::setAdaptiveSampling)
+  bool expand{false};      // mesh the individual strands (see Tree::expandSuperStrands)
+  std::string cacheDir{};
+  std::string forestPath{};  // strand dataset of all the trees (none if empty)
+};
+
+// a plant graph to generate (or a tree of the input dataset to mesh), and the base path of its
+// outputs
+struct BatchJob {
+  std::string name;
+  fs::path graphPath{};
+  int datasetTree{-1};
+  fs::path outputPath{};  // without extension
+};
+
+struct BatchResult {
+  bool ok{false};
+  std::string error{};
+  int nodes{}, strands{};
+  std::size_t triangles{};
+  float loadSeconds{}, generateSeconds{}, writeSeconds{};
+};
+
+// estimated memory of the trees being generated: a tree waits until it fits under the cap, unless
+// it is the only one (so that trees larger than the cap still run, one at a time)
+class MemoryBudget {
+ private:
+  const std::size_t capacity;  // 0: unlimited
+  std::size_t used{0};
+  std::mutex mutex;
+  std::condition_variable released;
+
+ public:
+  explicit MemoryBudget(std::size_t _capacity) : capacity{_capacity} {}
+
+  void acquire(std::size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [&]() { return capacity == 0 || used == 0 || used + bytes <= capacity; });
+    used += bytes;
+  }
+
+  void release(std::size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      used -= bytes;
+    }
+    released.notify_all();
+  }
+};
+
+// shared by the workers
+struct BatchContext {
+  const BatchOptions& options;
+  MemoryBudget budget;
+  std::unique_ptr<StrandDataset> dataset;  // input trees, if the input is a strand dataset
+  std::unique_ptr<StrandDatasetWriter> forest;
+  std::mutex forestMutex;
+};
+
+std::vector<BatchJob> listJobs(const fs::path& input, const fs::path& outputDir);
+std::vector<BatchJob> listDatasetJobs(const StrandDataset& dataset, const fs::path& outputDir);
+void setOutputPaths(std::vector<BatchJob>& jobs, const fs::path& outputDir);
+std::size_t estimateTreeMemory(const PlantGraph& pg, int maxNodeStrands);
+BatchResult runJob(const BatchJob& job, BatchContext& context);
+
+int main(int argc, char** argv) {
+  BatchOptions options;
+  std::vector<std::string> positional;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      options.threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--memory" && i + 1 < argc) {
+      options.memoryBytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+    } else if (arg == "--format" && i + 1 < argc) {
+      options.meshFormat = std::string(".") + argv[++i];
+    } else if (arg == "--quantize") {
+      options.quantize = true;
+    } else if (arg == "--no-strands") {
+      options.strands = false;
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--bundle" && i + 1 < argc) {
+      options.maxNodeStrands = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--expand") {
+      options.expand = true;
+    } else if (arg == "--adaptive" && i + 1 < argc) {
+      options.chordTolerance = std::max(0.0f, std::strtof(argv[++i], nullptr));
+    } else if (arg == "--cache" && i + 1 < argc) {
+      options.cacheDir = argv[++i];
+    } else if (arg == "--forest" && i + 1 < argc) {
+      options.forestPath = argv[++i];
+    } else if (arg.rfind("--", 0) != 0) {
+      positional.push_back(arg);
+    } else {
+      positional.clear();
+      break;
+    }
+  }
+
+  if (positional.size() != 2 || (options.meshFormat != ".glb" && options.meshFormat != ".ply")) {
+    std::cerr << "Usage: " << argv[0] << " INPUT OUTPUT_DIR [--threads N] [--memory MB]"
+              << " [--format glb|ply] [--quantize] [--no-strands] [--forest FILE] [--seed N]"
+              << " [--bundle N [--expand]] [--adaptive TOL] [--cache DIR]\n"
+              << "INPUT is a directory of plant graph files, a manifest listing one per line, or"
+              << " a strand dataset (its trees are meshed again)\n";
+    return EXIT_FAILURE;
+  }
+
+  BatchContext context{options, MemoryBudget(options.memoryBytes)};
+  std::vector<BatchJob> jobs;
+  try {
+    fs::create_directories(positional[1]);
+
+    if (fs::is_regular_file(positional[0]) && isStrandDataset(positional[0])) {
+      context.dataset = std::make_unique<StrandDataset>(positional[0]);
+      jobs = listDatasetJobs(*context.dataset, positional[1]);
+    } else {
+      jobs = listJobs(positional[0], positional[1]);
+    }
+
+    if (!options.forestPath.empty())
+      context.forest = std::make_unique<StrandDatasetWriter>(options.forestPath);
+  } catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  options.threads = std::min<unsigned int>(options.threads, std::max<std::size_t>(jobs.size(), 1));
+  std::cout << "Generating " << jobs.size() << " trees on " << options.threads << " threads\n";
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<BatchResult> results(jobs.size());
+  std::atomic<int> next{0};
+  int finished = 0;
+  std::mutex outputMutex;
+
+  auto worker = [&]() {
+    // the trees already keep every core busy
+    parallel::serialThread = options.threads > 1;
+
+    for (int i = next++; i < jobs.size(); i = next++) {
+      results[i] = runJob(jobs[i], context);
+
+      const BatchResult& result = results[i];
+      const std::string& name = jobs[i].name;
+
+      std::lock_guard<std::mutex> lock(outputMutex);
+      std::cout << "[" << ++finished << "/" << jobs.size() << "] " << name;
+      if (result.ok) {
+        std::cout << ": " << result.nodes << " nodes, " << result.strands << " strands, "
+                  << result.triangles << " triangles (load " << result.loadSeconds
+                  << " s, generate " << result.generateSeconds << " s, write "
+                  << result.writeSeconds << " s)\n";
+      } else {
+        std::cout << ": FAILED\n";
+        std::cerr << "ERROR: " << name << ": " << result.error << std::endl;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int t = 1; t < options.threads; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads) thread.join();
+
+  if (context.forest) {
+    try {
+      context.forest->finish();
+    } catch (const std::exception& e) {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+
+  int failed = 0;
+  std::size_t triangles = 0;
+  for (const auto& result : results) {
+    failed += !result.ok;
+    triangles += result.triangles;
+  }
+
+  const int generated = jobs.size() - failed;
+  std::cout << generated << " trees generated in " << elapsed.count() << " s ("
+            << generated / elapsed.count() << " trees/s, " << triangles / elapsed.count()
+            << " triangles/s)";
+  if (failed > 0) std::cout << ", " << failed << " failed";
+  std::cout << "\n";
+
+  return failed > 0 ? EXIT_FAILURE : 0;
+}
+
+std::vector<BatchJob> listJobs(const fs::path& input, const fs::path& outputDir) {
+  std::vector<fs::path> graphs;
+
+  if (fs::is_directory(input)) {
+    // every (visible) file of the directory
+    for (const auto& entry : fs::directory_iterator(input)) {
+      if (entry.is_regular_file() && entry.path().filename().string()[0] != '.')
+        graphs.push_back(entry.path());
+    }
+    std::sort(graphs.begin(), graphs.end());
+  } else {
+    // manifest: one path per line, relative to the manifest. '#' starts a comment line
+    std::ifstream manifest(input);
+    if (!manifest) throw std::runtime_error("Failed to open " + input.string());
+
+    for (std::string line; std::getline(manifest, line);) {
+      line.erase(0, line.find_first_not_of(" \t"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (line.empty() || line[0] == '#') continue;
+
+      graphs.push_back(input.parent_path() / line);
+    }
+  }
+
+  std::vector<BatchJob> jobs;
+  for (const auto& graph : graphs) jobs.push_back({graph.stem().string(), graph});
+
+  setOutputPaths(jobs, outputDir);
+  return jobs;
+}
+
+std::vector<BatchJob> listDatasetJobs(const StrandDataset& dataset, const fs::path& outputDir) {
+  std::vector<BatchJob> jobs;
+  for (int t = 0; t < dataset.getTreeCount(); ++t) {
+    std::string name = dataset.getTree(t).getName();
+    jobs.push_back({name.empty() ? "tree" + std::to_string(t) : name, {}, t});
+  }
+
+  setOutputPaths(jobs, outputDir);
+  return jobs;
+}
+
+// outputs named after the jobs (numbered when the name was already given, e.g. to "a" and "a-1"
+// for "a", "a", "a-1": the third is "a-1-1")
+void setOutputPaths(std::vector<BatchJob>& jobs, const fs::path& outputDir) {
+  std::set<std::string> issued;
+  for (auto& job : jobs) {
+    std::string name = job.name;
+    for (int count = 1; !issued.insert(name).second; ++count) {
+      name = job.name + "-" + std::to_string(count);
+    }
+
+    job.outputPath = outputDir / name;
+  }
+}
+
+std::size_t estimateTreeMemory(const PlantGraph& pg, int maxNodeStrands) {
+  // the strands of every leaf go through all the branch segments down to the root (node parents
+  // always have smaller ids), unless they are bundled on the way
+  const int nodeCount = pg.getNodeCount();
+  std::vector<int> childCounts(nodeCount, 0), leaves(nodeCount, 0);
+  for (int id = 1; id < nodeCount; ++id) childCounts[pg.getNode(id).parentId]++;
+
+  std::size_t samples = 0;
+  for (int id = nodeCount - 1; id > 0; --id) {
+    if (childCounts[id] == 0) leaves[id] = 1;
+    leaves[pg.getNode(id).parentId] += leaves[id];
+
+    std::size_t strands = std::size_t(leaves[id]) * NUM_STRANDS_PER_LEAF;
+    if (maxNodeStrands > 0) strands = std::min<std::size_t>(strands, maxNodeStrands);
+    samples += strands * (NUM_INTERPOLATED_POINTS + 1);
+  }
+
+  return samples * BYTES_PER_STRAND_SAMPLE;
+}
+
+BatchResult runJob(const BatchJob& job, BatchContext& context) {
+  const BatchOptions& options = context.options;
+  BatchResult result;
+
+  // the reservation is given back however the generation ends
+  struct Reservation {
+    MemoryBudget& budget;
+    std::size_t bytes{0};
+    ~Reservation() { budget.release(bytes); }
+  } reservation{context.budget};
+
+  try {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    std::unique_ptr<StrandDatasetTree> layout;
+    if (job.datasetTree >= 0)
+      layout = std::make_unique<StrandDatasetTree>(context.dataset->getTree(job.datasetTree));
+
+    PlantGraph pg = layout ? layout->createGraph() : loadPlantGraph(job.graphPath.string());
+    result.nodes = pg.getNodeCount();
+
+    auto loaded = Clock::now();
+
+    // (expanded trees end up with all their strands)
+    reservation.bytes = estimateTreeMemory(pg, options.expand ? 0 : options.maxNodeStrands);
+    context.budget.acquire(reservation.bytes);
+
+    auto generateStart = Clock::now();
+
+    Tree tree(pg);
+    tree.setSeed(options.seed);
+    tree.setStrandBundling(options.maxNodeStrands);
+    tree.setAdaptiveSampling(options.chordTolerance);
+    // (cached strands don't know their bundles, and expanded ones get new cross sections)
+    tree.setEagerCrossSections(!options.expand);
+    if (layout)
+      tree.loadStrands(*layout);
+    else if (options.cacheDir.empty() || options.expand)
+      tree.computeStrandsPosition();
+    else
+      tree.computeStrandsPosition(options.cacheDir);
+
+    if (options.expand) tree.expandSuperStrands({0});
+
+    MeshData data = tree.generateMeshData(true);
+    result.strands = tree.getStrands().size();
+    result.triangles = data.indices.size();
+
+    auto generated = Clock::now();
+
+    MeshExportOptions exportOptions;
+    exportOptions.strandColors = tree.getStrandColors();
+    exportOptions.quantize = options.quantize;
+    exportMesh(data, job.outputPath.string() + options.meshFormat, exportOptions);
+
+    if (options.strands || context.forest) {
+      StrandDatasetTreeData strandData = tree.generateStrandData();
+      strandData.name = job.name;
+
+      if (options.strands) {
+        StrandDatasetWriter writer(job.outputPath.string() + ".strands");
+        writer.addTree(strandData);
+        writer.finish();
+      }
+
+      if (context.forest) {
+        std::lock_guard<std::mutex> lock(context.forestMutex);
+        context.forest->addTree(strandData);
+      }
+    }
+
+    std::chrono::duration<float> load = loaded - start, generate = generated - generateStart,
+                                 write = Clock::now() - generated;
+    result.loadSeconds = load.count();
+    result.generateSeconds = generate.count();
+    result.writeSeconds = write.count();
+    result.ok = true;
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+
+  return result;
+}
@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "core/GenerationProtocol.h"
+
+namespace fs = std::filesystem;
+
+// stub client of the generation service: sends plant graph files as requests, and writes the
+// meshes and strand datasets it gets back
+
+struct ClientOptions {
+  std::uint32_t flags{REQUEST_MESH};
+  std::uint32_t seed{0};
+  std::uint32_t maxNodeStrands{0};
+  bool separateChannels{false};  // by default, every request supersedes the previous ones
+  fs::path outputDir{"."};
+};
+
+void writeFile(const fs::path& path, const char* data, std::size_t size);
+
+int main(int argc, char** argv) {
+  ClientOptions options;
+  std::vector<std::string> positional;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--out" && i + 1 < argc) {
+      options.outputDir = argv[++i];
+    } else if (arg == "--strands") {
+      options.flags |= REQUEST_STRANDS;
+    } else if (arg == "--quantize") {
+      options.flags |= REQUEST_QUANTIZE;
+    } else if (arg == "--expand") {
+      options.flags |= REQUEST_EXPAND;
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--bundle" && i + 1 < argc) {
+      options.maxNodeStrands = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--channels") {
+      options.separateChannels = true;
+    } else if (arg.rfind("--", 0) != 0) {
+      positional.push_back(arg);
+    } else {
+      positional.clear();
+      break;
+    }
+  }
+
+  if (positional.size() < 2) {
+    std::cerr << "Usage: " << argv[0] << " SOCKET GRAPH... [--out DIR] [--strands] [--quantize]"
+              << " [--seed N] [--bundle N [--expand]] [--channels]\n"
+              << "The requests are sent at once, on one channel (only the last one is wanted)"
+              << " unless --channels gives each its own\n";
+    return EXIT_FAILURE;
+  }
+
+  const std::vector<std::string> graphs(positional.begin() + 1, positional.end());
+  int failed = 0;
+
+  try {
+    fs::create_directories(options.outputDir);
+    int fd = connectUnixSocket(positional[0]);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < graphs.size(); ++i) {
+      std::ifstream file(graphs[i], std::ios::binary);
+      if (!file) throw std::runtime_error("Failed to open " + graphs[i]);
+      std::vector<char> graph(std::istreambuf_iterator<char>(file), {});
+
+      GenerationRequest request{};
+      std::memcpy(request.magic, GENERATION_REQUEST_MAGIC, sizeof(GENERATION_REQUEST_MAGIC));
+      request.id = i;
+      request.channel = options.separateChannels ? i : 0;
+      request.flags = options.flags;
+      request.seed = options.seed;
+      request.maxNodeStrands = options.maxNodeStrands;
+
+      writeMessage(fd, {{&request, sizeof(request)}, {graph.data(), graph.size()}});
+    }
+
+    std::vector<char> message;
+    for (int received = 0; received < graphs.size(); ++received) {
+      if (!readMessage(fd, message)) throw std::runtime_error("Connection closed by the server");
+
+      GenerationResponse response;
+      if (message.size() < sizeof(response)) throw std::runtime_error("Truncated response");
+      std::memcpy(&response, message.data(), sizeof(response));
+      if (std::memcmp(response.magic, GENERATION_RESPONSE_MAGIC, 4) != 0 ||
+          response.id >= graphs.size()) {
+        throw std::runtime_error("Invalid response");
+      }
+
+      std::chrono::duration<float> latency = std::chrono::steady_clock::now() - start;
+      const std::string& graph = graphs[response.id];
+      std::cout << graph << ": ";
+
+      const char* body = message.data() + sizeof(response);
+      const std::size_t bodySize = message.size() - sizeof(response);
+
+      if (response.status == RESPONSE_OK) {
+        if (response.meshBytes + response.strandBytes != bodySize)
+          throw std::runtime_error("Invalid response sizes");
+
+        const fs::path output = options.outputDir / fs::path(graph).stem();
+        if (response.meshBytes > 0) writeFile(output.string() + ".glb", body, response.meshBytes);
+        if (response.strandBytes > 0) {
+          writeFile(output.string() + ".strands", body + response.meshBytes, response.strandBytes);
+        }
+
+        std::cout << response.meshBytes << " mesh bytes, " << response.strandBytes
+                  << " strand bytes, generated in " << response.seconds << " s"
+                  << (response.cached ? " (cached)" : "");
+      } else if (response.status == RESPONSE_CANCELLED) {
+        std::cout << "cancelled";
+      } else {
+        std::cout << "failed: " << std::string(body, bodySize);
+        failed++;
+      }
+      std::cout << " (after " << latency.count() << " s)\n";
+    }
+
+    close(fd);
+  } catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return failed > 0 ? EXIT_FAILURE : 0;
+}
+
+void writeFile(const fs::path& path, const char* data, std::size_t size) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(data, size);
+  if (!file) throw std::runtime_error("Failed to write " + path.string());
+}
@@ -0,0 +1,148 @@
+#include "core/FrameTimer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <numeric>
+
+#include <glad/glad.h>
+
+namespace {
+
+float toMilliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+// nearest-rank percentile of sorted samples
+float percentile(const std::vector<float>& sorted, float p) {
+  int rank = static_cast<int>(p / 100.0f * sorted.size() + 0.5f);
+  return sorted[std::clamp(rank - 1, 0, static_cast<int>(sorted.size()) - 1)];
+}
+
+float mean(const std::vector<float>& samples) {
+  return std::accumulate(samples.begin(), samples.end(), 0.0f) / samples.size();
+}
+
+}  // namespace
+
+FrameTimer::FrameTimer(std::vector<std::string> phases, std::vector<std::string> passes)
+    : phaseNames{std::move(phases)},
+      passNames{std::move(passes)},
+      phaseSamples(phaseNames.size()),
+      passSamples(passNames.size()),
+      currentPhaseTimes(phaseNames.size()) {}
+
+void FrameTimer::initialize() {
+  queries.resize(FRAME_TIMER_LATENCY * passNames.size());
+  queryIssued.assign(queries.size(), false);
+  glGenQueries(queries.size(), queries.data());
+}
+
+void FrameTimer::deleteQueries() {
+  glDeleteQueries(queries.size(), queries.data());
+  queries.clear();
+  queryIssued.clear();
+}
+
+void FrameTimer::beginFrame() {
+  frameStart = phaseStart = Clock::now();
+  currentPhase = -1;
+  std::fill(currentPhaseTimes.begin(), currentPhaseTimes.end(), 0.0f);
+
+  if (queries.empty()) return;
+
+  // results of the frame that used this slot, FRAME_TIMER_LATENCY frames ago
+  for (int pass = 0; pass < passNames.size(); ++pass) {
+    const int q = slot * passNames.size() + pass;
+    if (!queryIssued[q]) continue;
+
+    std::uint64_t nanoseconds = 0;
+    glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &nanoseconds);
+    passSamples[pass].push_back(nanoseconds / 1.0e6f);
+    queryIssued[q] = false;
+  }
+}
+
+void FrameTimer::endFrame() {
+  beginPhase(-1);
+
+  frameSamples.push_back(toMilliseconds(Clock::now() - frameStart));
+  for (int phase = 0; phase < phaseNames.size(); ++phase) {
+    phaseSamples[phase].push_back(currentPhaseTimes[phase]);
+  }
+
+  slot = (slot + 1) % FRAME_TIMER_LATENCY;
+}
+
+void FrameTimer::beginPhase(int phase) {
+  Clock::time_point now = Clock::now();
+  if (currentPhase >= 0) currentPhaseTimes[currentPhase] += toMilliseconds(now - phaseStart);
+
+  currentPhase = phase;
+  phaseStart = now;
+}
+
+void FrameTimer::beginPass(int pass) {
+  if (queries.empty()) return;
+
+  const int q = slot * passNames.size() + pass;
+  glBeginQuery(GL_TIME_ELAPSED, queries[q]);
+  queryIssued[q] = true;
+  currentPass = pass;
+}
+
+void FrameTimer::endPass() {
+  if (currentPass < 0) return;
+
+  glEndQuery(GL_TIME_ELAPSED);
+  currentPass = -1;
+}
+
+void FrameTimer::clear() {
+  frameSamples.clear();
+  for (auto& samples : phaseSamples) samples.clear();
+  for (auto& samples : passSamples) samples.clear();
+}
+
+void FrameTimer::printSummary(std::ostream& out) const {
+  if (frameSamples.empty()) return;
+
+  out << std::fixed << std::setprecision(2) << "Frame time: " << mean(frameSamples) << " ms over "
+      << frameSamples.size() << " frames (cpu:";
+  for (int phase = 0; phase < phaseNames.size(); ++phase) {
+    out << " " << phaseNames[phase] << " " << mean(phaseSamples[phase]);
+  }
+
+  out << ", gpu:";
+  for (int pass = 0; pass < passNames.size(); ++pass) {
+    if (!passSamples[pass].empty()) out << " " << passNames[pass] << " " << mean(passSamples[pass]);
+  }
+  out << ")\n" << std::defaultfloat;
+}
+
+void FrameTimer::writePercentiles(std::ostream& out) const {
+  auto writeRow = [&out](const std::string& name, std::vector<float> samples) {
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+
+    out << std::left << std::setw(16) << name << std::right;
+    for (float p : {50.0f, 90.0f, 95.0f, 99.0f}) out << std::setw(10) << percentile(samples, p);
+    out << std::setw(10) << samples.back() << std::setw(10) << mean(samples) << "\n";
+  };
+
+  out << std::fixed << std::setprecision(3) << std::left << std::setw(16) << "ms" << std::right;
+  for (const char* column : {"p50", "p90", "p95", "p99", "max", "mean"}) {
+    out << std::setw(10) << column;
+  }
+  out << "\n";
+
+  writeRow("frame", frameSamples);
+  for (int phase = 0; phase < phaseNames.size(); ++phase) {
+    writeRow("cpu " + phaseNames[phase], phaseSamples[phase]);
+  }
+  for (int pass = 0; pass < passNames.size(); ++pass) {
+    writeRow("gpu " + passNames[pass], passSamples[pass]);
+  }
+
+  out << std::defaultfloat;
+}
@@ -0,0 +1,127 @@
+#include "core/GenerationProtocol.h"
+
+#if defined(GENERATION_SOCKETS)
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int LISTEN_BACKLOG = 16;
+
+sockaddr_un getSocketAddress(const std::string& path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path too long: " + path);
+
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  return address;
+}
+
+std::string getError(const std::string& what) { return what + ": " + std::strerror(errno); }
+
+// false if the peer closed the connection before the first byte
+bool readFully(int fd, void* data, std::size_t size) {
+  auto* p = static_cast<char*>(data);
+  for (std::size_t done = 0; done < size;) {
+    ssize_t n = read(fd, p + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw std::runtime_error(getError("Socket read failed"));
+    if (n == 0) {
+      if (done == 0) return false;
+      throw std::runtime_error("Connection closed in the middle of a message");
+    }
+
+    done += n;
+  }
+
+  return true;
+}
+
+void writeFully(int fd, const void* data, std::size_t size) {
+  const auto* p = static_cast<const char*>(data);
+  for (std::size_t done = 0; done < size;) {
+    ssize_t n = write(fd, p + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw std::runtime_error(getError("Socket write failed"));
+
+    done += n;
+  }
+}
+
+}  // namespace
+
+int listenUnixSocket(const std::string& path) {
+  const sockaddr_un address = getSocketAddress(path);
+  removeUnixSocket(path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) throw std::runtime_error(getError("Failed to create socket"));
+
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(fd, LISTEN_BACKLOG) != 0) {
+    std::string error = getError("Failed to listen on " + path);
+    close(fd);
+    throw std::runtime_error(error);
+  }
+
+  return fd;
+}
+
+void removeUnixSocket(const std::string& path) {
+  // (lstat: a symbolic link to a socket is not followed, nor removed)
+  struct stat status;
+  if (lstat(path.c_str(), &status) != 0) {
+    if (errno == ENOENT) return;
+    throw std::runtime_error(getError("Failed to stat " + path));
+  }
+
+  if (!S_ISSOCK(status.st_mode)) throw std::runtime_error(path + " exists and is not a socket");
+  if (unlink(path.c_str()) != 0 && errno != ENOENT)
+    throw std::runtime_error(getError("Failed to remove " + path));
+}
+
+int connectUnixSocket(const std::string& path) {
+  const sockaddr_un address = getSocketAddress(path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) throw std::runtime_error(getError("Failed to create socket"));
+
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    std::string error = getError("Failed to connect to " + path);
+    close(fd);
+    throw std::runtime_error(error);
+  }
+
+  return fd;
+}
+
+bool readMessage(int fd, std::vector<char>& payload) {
+  std::uint32_t size;
+  if (!readFully(fd, &size, sizeof(size))) return false;
+  if (size > MAX_MESSAGE_BYTES) throw std::runtime_error("Message too large");
+
+  payload.resize(size);
+  if (size > 0 && !readFully(fd, payload.data(), size))
+    throw std::runtime_error("Connection closed in the middle of a message");
+
+  return true;
+}
+
+void writeMessage(int fd, std::initializer_list<MessagePart> parts) {
+  std::size_t size = 0;
+  for (const MessagePart& part : parts) size += part.size;
+  if (size > MAX_MESSAGE_BYTES) throw std::runtime_error("Message too large");
+
+  const auto size32 = static_cast<std::uint32_t>(size);
+  writeFully(fd, &size32, sizeof(size32));
+  for (const MessagePart& part : parts) writeFully(fd, part.data, part.size);
+}
+#endif
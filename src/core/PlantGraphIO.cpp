@@ -0,0 +1,394 @@
+#include "core/PlantGraphIO.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "core/MappedFile.h"
+#include "core/Parallel.h"
+
+namespace {
+
+// text files are split in chunks of at least this size, parsed in parallel
+constexpr std::size_t TEXT_CHUNK_MIN_BYTES = 1 << 20;
+
+// nodes as found in a file, before they are renumbered
+struct NodeRecords {
+  std::vector<int> ids, parents;
+  std::vector<glm::vec3> positions;
+  std::vector<float> radii;
+
+  void reserve(std::size_t n) {
+    ids.reserve(n);
+    parents.reserve(n);
+    positions.reserve(n);
+    radii.reserve(n);
+  }
+};
+
+// parsers of the text format: they never allocate and never read past `end` (the mapped file is
+// not null terminated)
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline void skipBlanks(const char*& p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+}
+
+bool parseInt(const char*& p, const char* end, int& out) {
+  skipBlanks(p, end);
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+  if (p == end || !isDigit(*p)) return false;
+
+  long long value = 0;
+  for (; p < end && isDigit(*p); ++p) {
+    value = value * 10 + (*p - '0');
+    if (value > std::numeric_limits<int>::max()) return false;
+  }
+
+  out = negative ? -value : value;
+  return true;
+}
+
+bool parseFloat(const char*& p, const char* end, float& out) {
+  static const double POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                         1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                         1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  skipBlanks(p, end);
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+  // decimal mantissa (its first 18 digits) and exponent
+  unsigned long long mantissa = 0;
+  int exponent = 0, digits = 0;
+
+  for (; p < end && isDigit(*p); ++p, ++digits) {
+    if (digits < 18)
+      mantissa = mantissa * 10 + (*p - '0');
+    else
+      ++exponent;
+  }
+
+  if (p < end && *p == '.') {
+    for (++p; p < end && isDigit(*p); ++p, ++digits) {
+      if (digits < 18) {
+        mantissa = mantissa * 10 + (*p - '0');
+        --exponent;
+      }
+    }
+  }
+
+  if (digits == 0) return false;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    int e;
+    if (!parseInt(p, end, e)) return false;
+    exponent += e;
+  }
+
+  double value = mantissa;
+  const int maxPower = std::size(POWERS_OF_TEN) - 1;
+  for (; exponent > maxPower; exponent -= maxPower) value *= POWERS_OF_TEN[maxPower];
+  for (; exponent < -maxPower; exponent += maxPower) value /= POWERS_OF_TEN[maxPower];
+  value = exponent >= 0 ? value * POWERS_OF_TEN[exponent] : value / POWERS_OF_TEN[-exponent];
+
+  out = static_cast<float>(negative ? -value : value);
+  return true;
+}
+
+// parse the lines in [p, end) (whole lines). returns the line of the first error, if any
+int parseTextLines(const char* p, const char* end, NodeRecords& records, const char*& error) {
+  // one node per line at most
+  records.reserve(std::count(p, end, '\n') + 1);
+
+  for (int line = 1; p < end; ++line) {
+    skipBlanks(p, end);
+
+    if (p < end && *p != '\n' && *p != '#') {
+      int id, parent;
+      glm::vec3 pos;
+      float radius = 0.0f;
+
+      if (!parseInt(p, end, id) || !parseInt(p, end, parent) || !parseFloat(p, end, pos.x) ||
+          !parseFloat(p, end, pos.y) || !parseFloat(p, end, pos.z)) {
+        error = "expected id parent x y z";
+        return line;
+      }
+
+      skipBlanks(p, end);
+      if (p < end && *p != '\n' && *p != '#' && !parseFloat(p, end, radius)) {
+        error = "invalid radius";
+        return line;
+      }
+
+      // nothing else but a comment
+      skipBlanks(p, end);
+      if (p < end && *p != '\n' && *p != '#') {
+        error = "unexpected text after the radius";
+        return line;
+      }
+
+      records.ids.push_back(id);
+      records.parents.push_back(parent);
+      records.positions.push_back(pos);
+      records.radii.push_back(radius);
+    }
+
+    // rest of the line (comments)
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    p = newline ? newline + 1 : end;
+  }
+
+  return 0;
+}
+
+NodeRecords parseText(const char* begin, const char* end, const std::string& path) {
+  // chunks of whole lines, parsed in parallel
+  const std::size_t size = end - begin;
+  const int nChunks = std::clamp<std::size_t>(
+      size / TEXT_CHUNK_MIN_BYTES, 1, 4 * parallel::getNumThreads()
+  );
+
+  std::vector<const char*> chunkBounds(nChunks + 1, end);
+  chunkBounds[0] = begin;
+  for (int c = 1; c < nChunks; ++c) {
+    const char* p = std::max(begin + size * c / nChunks, chunkBounds[c - 1]);
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    chunkBounds[c] = newline ? newline + 1 : end;
+  }
+
+  std::vector<NodeRecords> chunks(nChunks);
+  std::vector<int> errorLines(nChunks, 0);
+  std::vector<const char*> errors(nChunks, nullptr);
+
+  parallel::forRange(0, nChunks, [&](int c) {
+    errorLines[c] = parseTextLines(chunkBounds[c], chunkBounds[c + 1], chunks[c], errors[c]);
+  });
+
+  // first error, with its line in the whole file
+  int firstLine = 0;
+  for (int c = 0; c < nChunks; ++c) {
+    if (errorLines[c] > 0) {
+      const int line = firstLine + errorLines[c];
+      throw std::runtime_error(path + ":" + std::to_string(line) + ": " + errors[c]);
+    }
+    firstLine += std::count(chunkBounds[c], chunkBounds[c + 1], '\n');
+  }
+
+  if (nChunks == 1) return std::move(chunks[0]);
+
+  NodeRecords records;
+  std::size_t n = 0;
+  for (const auto& chunk : chunks) n += chunk.ids.size();
+  records.reserve(n);
+
+  for (const auto& chunk : chunks) {
+    records.ids.insert(records.ids.end(), chunk.ids.begin(), chunk.ids.end());
+    records.parents.insert(records.parents.end(), chunk.parents.begin(), chunk.parents.end());
+    records.positions.insert(
+        records.positions.end(), chunk.positions.begin(), chunk.positions.end()
+    );
+    records.radii.insert(records.radii.end(), chunk.radii.begin(), chunk.radii.end());
+  }
+
+  return records;
+}
+
+struct BinaryHeader {
+  char magic[4];
+  std::uint32_t nodeCount;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+};
+
+NodeRecords parseBinary(const char* begin, const char* end, const std::string& path) {
+  BinaryHeader header;
+  std::memcpy(&header, begin, sizeof(header));
+
+  const std::size_t n = header.nodeCount;
+  const bool hasRadius = header.flags & PLANT_GRAPH_HAS_RADIUS;
+  const std::size_t expectedSize =
+      sizeof(header) + n * (sizeof(std::int32_t) + 3 * sizeof(float)) +
+      (hasRadius ? n * sizeof(float) : 0);
+
+  if (static_cast<std::size_t>(end - begin) < expectedSize)
+    throw std::runtime_error(path + ": truncated file");
+
+  NodeRecords records;
+  records.ids.resize(n);
+  records.parents.resize(n);
+  records.positions.resize(n);
+  records.radii.assign(n, 0.0f);
+
+  for (int i = 0; i < n; ++i) records.ids[i] = i;
+
+  const char* p = begin + sizeof(header);
+  std::memcpy(records.parents.data(), p, n * sizeof(std::int32_t));
+  p += n * sizeof(std::int32_t);
+  std::memcpy(records.positions.data(), p, n * 3 * sizeof(float));
+  p += n * 3 * sizeof(float);
+  if (hasRadius) std::memcpy(records.radii.data(), p, n * sizeof(float));
+
+  return records;
+}
+
+// renumber the nodes in breadth first order from the root, which puts the root at 0 and every
+// parent before its children
+PlantGraph buildPlantGraph(const NodeRecords& records, const std::string& path) {
+  const int n = records.ids.size();
+  if (n == 0) throw std::runtime_error(path + ": no nodes");
+
+  // index of every id: a table when the ids are dense enough, a hash map otherwise
+  int maxId = 0;
+  for (int id : records.ids) {
+    if (id < 0) throw std::runtime_error(path + ": negative node id " + std::to_string(id));
+    maxId = std::max(maxId, id);
+  }
+
+  std::vector<int> indexTable;
+  std::unordered_map<int, int> indexMap;
+  const bool dense = maxId < 4 * static_cast<long long>(n);
+
+  if (dense)
+    indexTable.assign(maxId + 1, -1);
+  else
+    indexMap.reserve(n);
+
+  for (int i = 0; i < n; ++i) {
+    const int id = records.ids[i];
+
+    bool duplicate;
+    if (dense) {
+      duplicate = indexTable[id] != -1;
+      indexTable[id] = i;
+    } else {
+      duplicate = !indexMap.emplace(id, i).second;
+    }
+
+    if (duplicate) throw std::runtime_error(path + ": duplicate node id " + std::to_string(id));
+  }
+
+  auto indexOf = [&](int id) {
+    if (dense) return id >= 0 && id <= maxId ? indexTable[id] : -1;
+    auto it = indexMap.find(id);
+    return it != indexMap.end() ? it->second : -1;
+  };
+
+  // children of every node, in compressed rows
+  int root = -1;
+  std::vector<int> parentIndices(n);
+  std::vector<int> childOffsets(n + 1, 0);
+
+  for (int i = 0; i < n; ++i) {
+    if (records.parents[i] == -1) {
+      if (root != -1) throw std::runtime_error(path + ": more than one root");
+      root = i;
+      parentIndices[i] = -1;
+      continue;
+    }
+
+    parentIndices[i] = indexOf(records.parents[i]);
+    if (parentIndices[i] == -1) {
+      throw std::runtime_error(
+          path + ": unknown parent " + std::to_string(records.parents[i]) + " of node " +
+          std::to_string(records.ids[i])
+      );
+    }
+    childOffsets[parentIndices[i] + 1]++;
+  }
+
+  if (root == -1) throw std::runtime_error(path + ": no root (node with parent -1)");
+
+  for (int i = 0; i < n; ++i) childOffsets[i + 1] += childOffsets[i];
+
+  std::vector<int> children(childOffsets[n]);
+  std::vector<int> next(childOffsets.begin(), childOffsets.end() - 1);
+  for (int i = 0; i < n; ++i) {
+    if (parentIndices[i] != -1) children[next[parentIndices[i]]++] = i;
+  }
+
+  // breadth first order (children keep their file order)
+  std::vector<int> order;
+  order.reserve(n);
+  order.push_back(root);
+
+  for (int k = 0; k < order.size(); ++k) {
+    const int i = order[k];
+    order.insert(
+        order.end(), children.begin() + childOffsets[i], children.begin() + childOffsets[i + 1]
+    );
+  }
+
+  if (order.size() != n) throw std::runtime_error(path + ": nodes not connected to the root");
+
+  std::vector<int> newIds(n);
+  for (int k = 0; k < n; ++k) newIds[order[k]] = k;
+
+  std::vector<Node> nodes;
+  nodes.reserve(n);
+  for (int k = 0; k < n; ++k) {
+    const int i = order[k];
+    const int parent = parentIndices[i] == -1 ? -1 : newIds[parentIndices[i]];
+    nodes.emplace_back(k, parent, records.positions[i], records.radii[i]);
+  }
+
+  return PlantGraph(std::move(nodes));
+}
+
+}  // namespace
+
+PlantGraph loadPlantGraph(const std::string& path) {
+  MappedFile file(path);
+  return parsePlantGraph(file.begin(), file.getSize(), path);
+}
+
+PlantGraph parsePlantGraph(const char* data, std::size_t size, const std::string& name) {
+  const char* end = data + size;
+  bool binary = size >= sizeof(BinaryHeader) &&
+                std::memcmp(data, PLANT_GRAPH_MAGIC, sizeof(PLANT_GRAPH_MAGIC)) == 0;
+
+  return buildPlantGraph(
+      binary ? parseBinary(data, end, name) : parseText(data, end, name), name
+  );
+}
+
+void savePlantGraphBinary(const PlantGraph& pg, const std::string& path) {
+  const int n = pg.getNodeCount();
+
+  bool hasRadius = std::any_of(pg.nodes.begin(), pg.nodes.end(), [](const Node& node) {
+    return node.radius != 0.0f;
+  });
+
+  BinaryHeader header{};
+  std::memcpy(header.magic, PLANT_GRAPH_MAGIC, sizeof(PLANT_GRAPH_MAGIC));
+  header.nodeCount = n;
+  header.flags = hasRadius ? PLANT_GRAPH_HAS_RADIUS : 0;
+
+  std::vector<std::int32_t> parents(n);
+  std::vector<glm::vec3> positions(n);
+  std::vector<float> radii(n);
+  for (int i = 0; i < n; ++i) {
+    parents[i] = pg.nodes[i].parentId;
+    positions[i] = pg.nodes[i].pos;
+    radii[i] = pg.nodes[i].radius;
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file) throw std::runtime_error("Failed to open " + path + " for writing");
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(parents.data()), n * sizeof(std::int32_t));
+  file.write(reinterpret_cast<const char*>(positions.data()), n * 3 * sizeof(float));
+  if (hasRadius) file.write(reinterpret_cast<const char*>(radii.data()), n * sizeof(float));
+
+  if (!file) throw std::runtime_error("Failed to write " + path);
+}
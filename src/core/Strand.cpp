@@ -1,40 +1,49 @@
 #include "core/Strand.h"
 
+#include <algorithm>
 #include <memory>
 
+glm::vec4 Strand::randomColor(std::mt19937& rng) {
+  std::uniform_int_distribution<int> redGreen(-10, 29), blue(-10, 9);
+
+  return {
+      std::min(111.0f / 255.0f + redGreen(rng) / 255.0f, 1.0f),
+      std::min(186.0f / 255.0f + redGreen(rng) / 255.0f, 1.0f),
+      std::min(131.0f / 255.0f + blue(rng) / 255.0f, 1.0f), 1.0f
+  };
+}
+
 std::shared_ptr<StrandParticle> Strand::addParticle(
-    const glm::vec3& pos, const glm::vec3& localPos
+    const glm::vec3& pos, const glm::vec3& localPos, int nodeId
 ) {
-  auto particle = std::make_shared<StrandParticle>(id, pos, localPos);
+  auto particle = std::make_shared<StrandParticle>(id, pos, localPos, false, nodeId);
   particles.push_back(particle);
 
   return particle;
 }
 
-void Strand::interpolateParticles() {
-  std::vector<glm::vec3> positions(particles.size());
+std::shared_ptr<StrandParticle> Strand::prependParticle(
+    const glm::vec3& pos, const glm::vec3& localPos, int nodeId
+) {
+  auto particle = std::make_shared<StrandParticle>(id, pos, localPos, false, nodeId);
+  particles.insert(particles.begin(), particle);
 
-  for (int i = 0; i < particles.size(); ++i) positions[i] = particles[i]->pos;
+  return particle;
+}
 
-  auto interpolatedPositions = Spline::interpolate(positions);
-
-  // new particles vector
-  std::vector<std::shared_ptr<StrandParticle>> updatedParticles;
-
-  int particleIndex = 0;  // idx for existing particles
-  for (const auto& interpolatedPos : interpolatedPositions) {
-    if (particles[particleIndex]->pos == interpolatedPos) {
-      // if this interpolated position matches an existing particle, keep the original
-      updatedParticles.push_back(particles[particleIndex]);
-      ++particleIndex;  // Move to the next existing particle
-    } else {
-      auto newParticle =
-          std::make_shared<StrandParticle>(id, interpolatedPos, glm::vec3(0.0f), true);
-      updatedParticles.push_back(newParticle);
-    }
-  }
+void Strand::endAt(const std::shared_ptr<StrandParticle>& particle) {
+  auto it = std::find(particles.begin(), particles.end(), particle);
+  if (it != particles.end()) particles.erase(it + 1, particles.end());
+}
 
-  particles = std::move(updatedParticles);
+void Strand::removeInterpolatedParticles() {
+  particles.erase(
+      std::remove_if(
+          particles.begin(), particles.end(),
+          [](const auto& particle) { return particle->interpolated; }
+      ),
+      particles.end()
+  );
 }
 
 void Strand::initializeSplineBuffers() {
@@ -51,66 +60,86 @@ void Strand::renderSpline(const Shader& sh) const {
   spline.render();
 }
 
-void Strand::initializeGeneralizedCylinder() {
-  // generate vertices in a circle around the strand particles
-  std::vector<glm::vec3> vertices;
-  std::vector<glm::uvec3> indices;
+void Strand::computeFrames(glm::vec3* normals, glm::vec3* binormals) const {
+  const int n = particles.size();
+
+  // tangents by central differences
+  std::vector<glm::vec3> tangents(n, glm::vec3{0.0f, 1.0f, 0.0f});
+  for (int i = 0; i < n && n > 1; ++i) {
+    glm::vec3 t = particles[std::min(i + 1, n - 1)]->pos - particles[std::max(i - 1, 0)]->pos;
+    if (glm::length(t) > 0.0f)
+      tangents[i] = glm::normalize(t);
+    else if (i > 0)
+      tangents[i] = tangents[i - 1];
+  }
 
-  for (const auto& particle : particles) {
-    glm::vec3 pos = particle->pos;
+  // any normal for the first particle
+  glm::vec3 axis = std::abs(tangents[0].x) < 0.9f ? glm::vec3{1.0f, 0.0f, 0.0f}
+                                                  : glm::vec3{0.0f, 1.0f, 0.0f};
+  glm::vec3 normal = glm::normalize(glm::cross(tangents[0], axis));
 
-    // generate a circle around the particle
-    for (int i = 0; i < NUM_CIRCLE_VERTICES; ++i) {
-      float theta = 2.0f * M_PI * i / NUM_CIRCLE_VERTICES;
-      float x = STRAND_RADIUS * cos(theta);
-      float z = STRAND_RADIUS * sin(theta);
+  for (int i = 0; i < n; ++i) {
+    if (i > 0) {
+      // double reflection method (Wang et al. 2008) to transport the normal along the strand
+      glm::vec3 v1 = particles[i]->pos - particles[i - 1]->pos;
+      float c1 = glm::dot(v1, v1);
 
-      vertices.push_back(pos + glm::vec3(x, 0.0f, z));
-    }
-  }
+      if (c1 > 0.0f) {
+        glm::vec3 normalL = normal - (2.0f / c1) * glm::dot(v1, normal) * v1;
+        glm::vec3 tangentL = tangents[i - 1] - (2.0f / c1) * glm::dot(v1, tangents[i - 1]) * v1;
 
-  // generate indices for the cylinder
-  for (int i = 0; i < particles.size() - 1; ++i) {
-    for (int j = 0; j < NUM_CIRCLE_VERTICES; ++j) {
-      int idx0 = i * NUM_CIRCLE_VERTICES + j;
-      int idx1 = i * NUM_CIRCLE_VERTICES + (j + 1) % NUM_CIRCLE_VERTICES;
-      int idx2 = (i + 1) * NUM_CIRCLE_VERTICES + j;
-      int idx3 = (i + 1) * NUM_CIRCLE_VERTICES + (j + 1) % NUM_CIRCLE_VERTICES;
+        glm::vec3 v2 = tangents[i] - tangentL;
+        float c2 = glm::dot(v2, v2);
 
-      indices.push_back(glm::uvec3(idx0, idx1, idx2));
-      indices.push_back(glm::uvec3(idx1, idx3, idx2));
-    }
-  }
+        normal = c2 > 0.0f ? normalL - (2.0f / c2) * glm::dot(v2, normalL) * v2 : normalL;
+      }
 
-  generalizedCylinder = std::make_unique<Mesh>(vertices, indices);
-}
+      // keep it orthonormal despite the accumulated error
+      normal = glm::normalize(normal - glm::dot(normal, tangents[i]) * tangents[i]);
+    }
 
-void Strand::renderStrand(const Shader& sh) const {
-  sh.setVec4("color", color);
-  generalizedCylinder->render();
+    normals[i] = normal;
+    binormals[i] = glm::cross(tangents[i], normal);
+  }
 }
 
-void Strand::renderStrandParticles() const {
-  unsigned int vao, vbo;
-  glGenVertexArrays(1, &vao);
-  glGenBuffers(1, &vbo);
+void Strand::writeGeneralizedCylinder(
+    StrandVertex* vertices, unsigned int* indices, unsigned int baseVertex
+) const {
+  StrandVertex vertex;
+  for (int c = 0; c < 4; ++c) vertex.color[c] = static_cast<unsigned char>(color[c] * 255.0f);
 
-  glBindVertexArray(vao);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  std::vector<glm::vec3> normals(particles.size()), binormals(particles.size());
+  computeFrames(normals.data(), binormals.data());
 
-  std::vector<glm::vec3> positions(particles.size());
-  for (int i = 0; i < particles.size(); ++i) positions[i] = particles[i]->pos;
-
-  glBufferData(
-      GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW
-  );
+  // generate vertices in a circle around the strand particles
+  for (int p = 0; p < particles.size(); ++p) {
+    glm::vec3 pos = particles[p]->pos;
+    float radius = particles[p]->getRadius();
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-  glEnableVertexAttribArray(0);
+    // generate a circle around the particle, orthogonal to the strand
+    for (int i = 0; i < NUM_CIRCLE_VERTICES; ++i) {
+      float theta = 2.0f * M_PI * i / NUM_CIRCLE_VERTICES;
+      float x = radius * cos(theta);
+      float y = radius * sin(theta);
 
-  glDrawArrays(GL_POINTS, 0, positions.size());
+      vertex.pos = pos + x * normals[p] + y * binormals[p];
+      *vertices++ = vertex;
+    }
+  }
 
-  glBindVertexArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  // generate indices for the cylinder
+  for (int i = 0; i + 1 < particles.size(); ++i) {
+    for (int j = 0; j < NUM_CIRCLE_VERTICES; ++j) {
+      unsigned int idx0 = baseVertex + i * NUM_CIRCLE_VERTICES + j;
+      unsigned int idx1 = baseVertex + i * NUM_CIRCLE_VERTICES + (j + 1) % NUM_CIRCLE_VERTICES;
+      unsigned int idx2 = baseVertex + (i + 1) * NUM_CIRCLE_VERTICES + j;
+      unsigned int idx3 =
+          baseVertex + (i + 1) * NUM_CIRCLE_VERTICES + (j + 1) % NUM_CIRCLE_VERTICES;
+
+      *indices++ = idx0, *indices++ = idx1, *indices++ = idx2;
+      *indices++ = idx1, *indices++ = idx3, *indices++ = idx2;
+    }
+  }
 }
 
@@ -0,0 +1,369 @@
+#include "core/StrandDataset.h"
+
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <numeric>
+#include <stdexcept>
+
+#include "core/Color.h"
+
+namespace {
+
+// per column: the datasets are written by many trees at once (batch generation)
+constexpr std::size_t COLUMN_BUFFER_BYTES = 256 << 10;
+
+std::array<std::uint64_t, NUM_STRAND_DATASET_COLUMNS> getColumnSizes(
+    const StrandDatasetHeader& header
+) {
+  std::array<std::uint64_t, NUM_STRAND_DATASET_COLUMNS> sizes;
+  sizes[COLUMN_TREES] = header.treeCount * sizeof(StrandDatasetTreeRecord);
+  sizes[COLUMN_STRAND_OFFSETS] = (header.strandCount + 1) * sizeof(std::uint64_t);
+  sizes[COLUMN_NODE_PARTICLE_OFFSETS] = (header.nodeCount + 1) * sizeof(std::uint64_t);
+  sizes[COLUMN_NODE_PARENTS] = header.nodeCount * sizeof(std::int32_t);
+  sizes[COLUMN_NODE_POSITIONS] = header.nodeCount * sizeof(glm::vec3);
+  sizes[COLUMN_NODE_CHILDREN] = (header.nodeCount - header.treeCount) * sizeof(std::int32_t);
+  sizes[COLUMN_STRAND_COLORS] = header.strandCount * sizeof(std::uint32_t);
+  sizes[COLUMN_POINTS] = header.pointCount * sizeof(glm::vec3);
+  sizes[COLUMN_NODE_PARTICLE_POINTS] = header.nodeParticleCount * sizeof(std::uint32_t);
+  sizes[COLUMN_NODE_PARTICLE_STRANDS] = header.nodeParticleCount * sizeof(std::int32_t);
+  sizes[COLUMN_NODE_PARTICLE_LOCAL_POSITIONS] = header.nodeParticleCount * sizeof(glm::vec3);
+  sizes[COLUMN_NODE_PARTICLE_WEIGHTS] =
+      header.version >= 2 ? header.nodeParticleCount * sizeof(std::int32_t) : 0;
+  sizes[COLUMN_NAMES] = header.namesLength;
+
+  return sizes;
+}
+
+// [first, first + count) within [0, total)
+bool isRange(std::uint64_t first, std::uint64_t count, std::uint64_t total) {
+  return first <= total && count <= total - first;
+}
+
+[[noreturn]] void throwCorrupted(const char* what) {
+  throw std::runtime_error(std::string("Corrupted strand dataset: ") + what);
+}
+
+// writes the columns of `tree`, appended to a dataset whose totals are `header` (updated), by
+// calling write(column, data, size) in the column order. the first tree also writes the 0 that
+// starts the offsets tables
+template <typename Write>
+void writeTreeColumns(
+    StrandDatasetHeader& header, const StrandDatasetTreeData& tree, Write&& write
+) {
+  const std::size_t nodeCount = tree.nodeParents.size();
+  const std::size_t strandCount = tree.strandLengths.size();
+  const std::size_t nodeParticleCount = tree.nodeParticlePoints.size();
+
+  const std::uint64_t pointTotal =
+      std::accumulate(tree.strandLengths.begin(), tree.strandLengths.end(), std::uint64_t{0});
+  const std::uint64_t nodeParticleTotal = std::accumulate(
+      tree.nodeParticleCounts.begin(), tree.nodeParticleCounts.end(), std::uint64_t{0}
+  );
+
+  if (nodeCount == 0 || tree.nodePositions.size() != nodeCount ||
+      tree.nodeChildren.size() != nodeCount - 1 || tree.nodeParticleCounts.size() != nodeCount ||
+      tree.strandColors.size() != strandCount || tree.points.size() != pointTotal ||
+      nodeParticleCount != nodeParticleTotal ||
+      tree.nodeParticleStrands.size() != nodeParticleCount ||
+      tree.nodeParticleLocalPositions.size() != nodeParticleCount ||
+      tree.nodeParticleWeights.size() != nodeParticleCount) {
+    throw std::runtime_error("Strand dataset: inconsistent tree " + tree.name);
+  }
+
+  StrandDatasetTreeRecord record{};
+  record.firstNode = header.nodeCount;
+  record.firstChild = header.nodeCount - header.treeCount;
+  record.firstStrand = header.strandCount;
+  record.firstPoint = header.pointCount;
+  record.firstNodeParticle = header.nodeParticleCount;
+  record.nameOffset = header.namesLength;
+  record.pointCount = pointTotal;
+  record.nodeParticleCount = nodeParticleCount;
+  record.nodeCount = nodeCount;
+  record.strandCount = strandCount;
+  record.nameLength = tree.name.size();
+
+  auto writeArray = [&write](int column, const auto& values) {
+    write(column, values.data(), values.size() * sizeof(values[0]));
+  };
+
+  // offsets tables: the end of every strand/node
+  auto writeOffsets = [&](int column, const std::vector<std::uint32_t>& counts,
+                          std::uint64_t offset) {
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(counts.size() + 1);
+    if (header.treeCount == 0) offsets.push_back(0);
+    for (std::uint32_t count : counts) offsets.push_back(offset += count);
+
+    writeArray(column, offsets);
+  };
+
+  write(COLUMN_TREES, &record, sizeof(record));
+  writeOffsets(COLUMN_STRAND_OFFSETS, tree.strandLengths, header.pointCount);
+  writeOffsets(COLUMN_NODE_PARTICLE_OFFSETS, tree.nodeParticleCounts, header.nodeParticleCount);
+  writeArray(COLUMN_NODE_PARENTS, tree.nodeParents);
+  writeArray(COLUMN_NODE_POSITIONS, tree.nodePositions);
+  writeArray(COLUMN_NODE_CHILDREN, tree.nodeChildren);
+  writeArray(COLUMN_STRAND_COLORS, tree.strandColors);
+  writeArray(COLUMN_POINTS, tree.points);
+  writeArray(COLUMN_NODE_PARTICLE_POINTS, tree.nodeParticlePoints);
+  writeArray(COLUMN_NODE_PARTICLE_STRANDS, tree.nodeParticleStrands);
+  writeArray(COLUMN_NODE_PARTICLE_LOCAL_POSITIONS, tree.nodeParticleLocalPositions);
+  writeArray(COLUMN_NODE_PARTICLE_WEIGHTS, tree.nodeParticleWeights);
+  write(COLUMN_NAMES, tree.name.data(), tree.name.size());
+
+  header.treeCount++;
+  header.nodeCount += nodeCount;
+  header.strandCount += strandCount;
+  header.pointCount += pointTotal;
+  header.nodeParticleCount += nodeParticleCount;
+  header.namesLength += tree.name.size();
+}
+
+StrandDatasetHeader createHeader() {
+  StrandDatasetHeader header{};
+  std::memcpy(header.magic, STRAND_DATASET_MAGIC, sizeof(STRAND_DATASET_MAGIC));
+  header.version = STRAND_DATASET_VERSION;
+
+  return header;
+}
+
+}  // namespace
+
+bool isStrandDataset(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+
+  char magic[sizeof(STRAND_DATASET_MAGIC)];
+  return file.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, STRAND_DATASET_MAGIC, sizeof(magic)) == 0;
+}
+
+// dataset
+
+StrandDataset::StrandDataset(const std::string& path) : file(path, false) {
+  if (file.getSize() < sizeof(header))
+    throw std::runtime_error("Truncated strand dataset: " + path);
+  std::memcpy(&header, file.begin(), sizeof(header));
+
+  if (std::memcmp(header.magic, STRAND_DATASET_MAGIC, sizeof(STRAND_DATASET_MAGIC)) != 0)
+    throw std::runtime_error("Not a strand dataset: " + path);
+  if (header.version < 1 || header.version > STRAND_DATASET_VERSION)
+    throw std::runtime_error("Unsupported strand dataset version: " + path);
+
+  // no count can be larger than the file (which also keeps the sizes below from overflowing)
+  const std::uint64_t fileSize = file.getSize();
+  for (std::uint64_t count : {header.nodeCount, header.strandCount, header.pointCount,
+                              header.nodeParticleCount, header.namesLength}) {
+    if (count > fileSize) throwCorrupted("counts");
+  }
+  if (header.nodeCount < header.treeCount) throwCorrupted("counts");
+
+  const auto sizes = getColumnSizes(header);
+  std::uint64_t offset = sizeof(header);
+  for (int c = 0; c < NUM_STRAND_DATASET_COLUMNS; ++c) {
+    columns[c] = file.begin() + offset;
+    offset += sizes[c];
+  }
+  if (offset != fileSize) throwCorrupted("file size");
+
+  // the ranges of every tree (their contents are only checked when they are accessed)
+  for (int t = 0; t < getTreeCount(); ++t) {
+    const auto& record = getColumn<StrandDatasetTreeRecord>(COLUMN_TREES, t, 1)[0];
+    if (record.nodeCount == 0 || !isRange(record.firstNode, record.nodeCount, header.nodeCount) ||
+        !isRange(record.firstChild, record.nodeCount - 1, header.nodeCount - header.treeCount) ||
+        !isRange(record.firstStrand, record.strandCount, header.strandCount) ||
+        !isRange(record.firstPoint, record.pointCount, header.pointCount) ||
+        !isRange(record.firstNodeParticle, record.nodeParticleCount, header.nodeParticleCount) ||
+        !isRange(record.nameOffset, record.nameLength, header.namesLength)) {
+      throwCorrupted("tree ranges");
+    }
+  }
+}
+
+StrandDatasetTree StrandDataset::getTree(int index) const {
+  assert(index >= 0 && index < getTreeCount());
+  return {*this, getColumn<StrandDatasetTreeRecord>(COLUMN_TREES, index, 1)[0]};
+}
+
+int StrandDataset::findTree(const std::string& name) const {
+  for (int t = 0; t < getTreeCount(); ++t) {
+    if (getTree(t).getName() == name) return t;
+  }
+
+  return -1;
+}
+
+// tree
+
+std::string StrandDatasetTree::getName() const {
+  return {dataset.columns[COLUMN_NAMES] + record.nameOffset, record.nameLength};
+}
+
+std::size_t StrandDatasetTree::getPointCount() const { return record.pointCount; }
+
+int StrandDatasetTree::getNodeParent(int nodeId) const {
+  assert(nodeId >= 0 && nodeId < getNodeCount());
+  return dataset.getColumn<std::int32_t>(COLUMN_NODE_PARENTS, record.firstNode + nodeId, 1)[0];
+}
+
+glm::vec3 StrandDatasetTree::getNodePosition(int nodeId) const {
+  assert(nodeId >= 0 && nodeId < getNodeCount());
+  return dataset.getColumn<glm::vec3>(COLUMN_NODE_POSITIONS, record.firstNode + nodeId, 1)[0];
+}
+
+ArrayView<std::int32_t> StrandDatasetTree::getNodeChildren() const {
+  return dataset.getColumn<std::int32_t>(
+      COLUMN_NODE_CHILDREN, record.firstChild, getNodeCount() - 1
+  );
+}
+
+PlantGraph StrandDatasetTree::createGraph() const {
+  std::vector<Node> nodes;
+  nodes.reserve(getNodeCount());
+
+  for (int id = 0; id < getNodeCount(); ++id) {
+    const int parent = getNodeParent(id);
+    if (id == 0 ? parent != -1 : parent < 0 || parent >= id) throwCorrupted("node parents");
+
+    nodes.emplace_back(id, parent, getNodePosition(id));
+  }
+
+  return PlantGraph(std::move(nodes));
+}
+
+ArrayView<glm::vec3> StrandDatasetTree::getPoints() const {
+  return dataset.getColumn<glm::vec3>(COLUMN_POINTS, record.firstPoint, record.pointCount);
+}
+
+std::size_t StrandDatasetTree::getStrandFirstPoint(int strandId) const {
+  assert(strandId >= 0 && strandId < getStrandCount());
+  auto offsets = dataset.getColumn<std::uint64_t>(
+      COLUMN_STRAND_OFFSETS, record.firstStrand + strandId, 1
+  );
+  if (offsets[0] < record.firstPoint || offsets[0] > record.firstPoint + record.pointCount)
+    throwCorrupted("strand offsets");
+
+  return offsets[0] - record.firstPoint;
+}
+
+ArrayView<glm::vec3> StrandDatasetTree::getStrandPoints(int strandId) const {
+  assert(strandId >= 0 && strandId < getStrandCount());
+  auto offsets = dataset.getColumn<std::uint64_t>(
+      COLUMN_STRAND_OFFSETS, record.firstStrand + strandId, 2
+  );
+
+  const std::uint64_t end = record.firstPoint + record.pointCount;
+  if (offsets[0] < record.firstPoint || offsets[0] > offsets[1] || offsets[1] > end)
+    throwCorrupted("strand offsets");
+
+  return dataset.getColumn<glm::vec3>(COLUMN_POINTS, offsets[0], offsets[1] - offsets[0]);
+}
+
+glm::vec4 StrandDatasetTree::getStrandColor(int strandId) const {
+  assert(strandId >= 0 && strandId < getStrandCount());
+  return unpackColor(
+      dataset.getColumn<std::uint32_t>(COLUMN_STRAND_COLORS, record.firstStrand + strandId, 1)[0]
+  );
+}
+
+StrandDatasetNodeParticles StrandDatasetTree::getNodeParticles(int nodeId) const {
+  assert(nodeId >= 0 && nodeId < getNodeCount());
+  auto offsets = dataset.getColumn<std::uint64_t>(
+      COLUMN_NODE_PARTICLE_OFFSETS, record.firstNode + nodeId, 2
+  );
+
+  const std::uint64_t end = record.firstNodeParticle + record.nodeParticleCount;
+  if (offsets[0] < record.firstNodeParticle || offsets[0] > offsets[1] || offsets[1] > end)
+    throwCorrupted("node particle offsets");
+
+  const std::uint64_t first = offsets[0], count = offsets[1] - offsets[0];
+  const bool weighted = dataset.header.version >= 2;
+  return {
+      dataset.getColumn<std::uint32_t>(COLUMN_NODE_PARTICLE_POINTS, first, count),
+      dataset.getColumn<std::int32_t>(COLUMN_NODE_PARTICLE_STRANDS, first, count),
+      dataset.getColumn<glm::vec3>(COLUMN_NODE_PARTICLE_LOCAL_POSITIONS, first, count),
+      dataset.getColumn<std::int32_t>(COLUMN_NODE_PARTICLE_WEIGHTS, first, weighted ? count : 0)
+  };
+}
+
+// writer
+
+StrandDatasetWriter::StrandDatasetWriter(const std::string& _path)
+    : path{_path}, header{createHeader()} {
+  for (int c = 0; c < NUM_STRAND_DATASET_COLUMNS; ++c)
+    columns[c] = std::make_unique<BufferedWriter>(getColumnPath(c), COLUMN_BUFFER_BYTES);
+}
+
+StrandDatasetWriter::~StrandDatasetWriter() {
+  if (finished) return;
+
+  for (int c = 0; c < NUM_STRAND_DATASET_COLUMNS; ++c) {
+    columns[c].reset();
+
+    std::error_code error;
+    std::filesystem::remove(getColumnPath(c), error);
+  }
+}
+
+std::string StrandDatasetWriter::getColumnPath(int column) const {
+  return path + ".column" + std::to_string(column);
+}
+
+void StrandDatasetWriter::addTree(const StrandDatasetTreeData& tree) {
+  writeTreeColumns(header, tree, [this](int column, const void* data, std::size_t size) {
+    columns[column]->write(data, size);
+  });
+}
+
+void StrandDatasetWriter::finish() {
+  // (the offsets tables of an empty dataset still have their 0)
+  if (header.treeCount == 0) {
+    columns[COLUMN_STRAND_OFFSETS]->write(std::uint64_t{0});
+    columns[COLUMN_NODE_PARTICLE_OFFSETS]->write(std::uint64_t{0});
+  }
+
+  for (auto& column : columns) column->close();
+
+  // header and columns in a temporary file, then renamed: readers never see a partial dataset
+  const std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open " + tempPath + " for writing");
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int c = 0; c < NUM_STRAND_DATASET_COLUMNS; ++c) {
+      const std::string columnPath = getColumnPath(c);
+
+      // (inserting an empty stream buffer would fail the file)
+      if (std::filesystem::file_size(columnPath) > 0) {
+        std::ifstream column(columnPath, std::ios::binary);
+        file << column.rdbuf();
+      }
+      std::filesystem::remove(columnPath);
+    }
+
+    if (!file) throw std::runtime_error("Failed to write " + tempPath);
+  }
+
+  std::filesystem::rename(tempPath, path);
+  finished = true;
+}
+
+void writeStrandDataset(const StrandDatasetTreeData& tree, std::ostream& stream) {
+  // the totals first (for the header), then the columns of the tree, which follow one another
+  StrandDatasetHeader header = createHeader();
+  writeTreeColumns(header, tree, [](int, const void*, std::size_t) {});
+
+  BufferedWriter out(stream);
+  out.write(header);
+
+  StrandDatasetHeader totals = createHeader();
+  writeTreeColumns(totals, tree, [&out](int, const void* data, std::size_t size) {
+    out.write(data, size);
+  });
+
+  out.close();
+}
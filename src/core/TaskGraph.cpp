@@ -0,0 +1,207 @@
+#include "core/TaskGraph.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "core/Parallel.h"
+
+namespace {
+
+// ready tasks of one thread: it works at the back, thieves take from the front
+struct TaskQueue {
+  std::mutex mutex;
+  std::deque<int> tasks;
+
+  void push(int task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(task);
+  }
+
+  bool pop(int& task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) return false;
+
+    task = tasks.back();
+    tasks.pop_back();
+    return true;
+  }
+
+  bool steal(int& task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) return false;
+
+    task = tasks.front();
+    tasks.pop_front();
+    return true;
+  }
+};
+
+// sets parallel::serialThread on the current thread for its lifetime
+struct SerialThreadScope {
+  bool previous{parallel::serialThread};
+
+  SerialThreadScope() { parallel::serialThread = true; }
+  ~SerialThreadScope() { parallel::serialThread = previous; }
+};
+
+}  // namespace
+
+int TaskGraph::add(std::function<void()> fn) {
+  tasks.push_back({std::move(fn)});
+  return tasks.size() - 1;
+}
+
+void TaskGraph::depend(int task, int dependency) {
+  tasks[dependency].successors.push_back(task);
+  tasks[task].dependencies++;
+}
+
+void TaskGraph::run(const std::function<bool()>& cancelled) {
+  checkAcyclic();
+
+  const int taskCount = tasks.size();
+  const unsigned int numThreads = std::min<unsigned int>(parallel::getNumThreads(), taskCount);
+
+  if (numThreads <= 1 || parallel::serialThread) {
+    runSerial(cancelled);
+    return;
+  }
+
+  auto pending = std::make_unique<std::atomic<int>[]>(taskCount);
+  auto queues = std::make_unique<TaskQueue[]>(numThreads);
+
+  // the ready tasks are dealt between the threads
+  std::atomic<int> queued{0};  // tasks in the queues (only increased with idleMutex held)
+  int nextQueue = 0;
+  for (int i = 0; i < taskCount; ++i) {
+    pending[i] = tasks[i].dependencies;
+    if (tasks[i].dependencies == 0) {
+      queues[nextQueue++ % numThreads].push(i);
+      queued++;
+    }
+  }
+
+  std::atomic<int> remaining{taskCount};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+
+  // idle threads sleep until a task is queued, the last one is done or one failed
+  std::mutex idleMutex;
+  std::condition_variable idle;
+
+  auto worker = [&](unsigned int id) {
+    SerialThreadScope serial;
+
+    auto findTask = [&](int& task) {
+      bool found = queues[id].pop(task);
+      for (unsigned int k = 1; !found && k < numThreads; ++k) {
+        found = queues[(id + k) % numThreads].steal(task);
+      }
+
+      if (found) queued--;
+      return found;
+    };
+
+    while (remaining > 0 && !failed) {
+      int task;
+      if (!findTask(task)) {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [&]() { return queued > 0 || remaining == 0 || failed; });
+        continue;
+      }
+
+      try {
+        if (cancelled && cancelled()) throw Cancelled{};
+        tasks[task].fn();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (!failed) error = std::current_exception();
+        failed = true;
+        idle.notify_all();
+        return;
+      }
+
+      // the tasks made ready are kept, the other threads are woken up to steal them
+      int readied = 0;
+      for (int successor : tasks[task].successors) {
+        if (--pending[successor] == 0) {
+          queues[id].push(successor);
+          readied++;
+        }
+      }
+
+      const bool done = --remaining == 0;
+      if (readied > 0 || done) {
+        {
+          std::lock_guard<std::mutex> lock(idleMutex);
+          queued += readied;
+        }
+
+        if (done || readied > 1)
+          idle.notify_all();
+        else
+          idle.notify_one();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+  for (unsigned int t = 1; t < numThreads; ++t) threads.emplace_back(worker, t);
+
+  worker(0);
+
+  for (auto& thread : threads) thread.join();
+
+  if (error) std::rethrow_exception(error);
+}
+
+void TaskGraph::checkAcyclic() const {
+  // kahn's algorithm on the dependency counts: tasks on a cycle never become ready
+  std::vector<int> pending(tasks.size());
+  std::vector<int> ready;
+  for (int i = 0; i < tasks.size(); ++i) {
+    pending[i] = tasks[i].dependencies;
+    if (pending[i] == 0) ready.push_back(i);
+  }
+
+  int visited = 0;
+  while (!ready.empty()) {
+    const int task = ready.back();
+    ready.pop_back();
+    visited++;
+
+    for (int successor : tasks[task].successors) {
+      if (--pending[successor] == 0) ready.push_back(successor);
+    }
+  }
+
+  if (visited != tasks.size()) throw std::runtime_error("TaskGraph: cyclic dependencies");
+}
+
+void TaskGraph::runSerial(const std::function<bool()>& cancelled) {
+  // ready tasks in id order, then the tasks they make ready
+  std::vector<int> pending(tasks.size());
+  std::deque<int> ready;
+  for (int i = 0; i < tasks.size(); ++i) {
+    pending[i] = tasks[i].dependencies;
+    if (pending[i] == 0) ready.push_back(i);
+  }
+
+  while (!ready.empty()) {
+    const int task = ready.front();
+    ready.pop_front();
+
+    if (cancelled && cancelled()) throw Cancelled{};
+    tasks[task].fn();
+    for (int successor : tasks[task].successors) {
+      if (--pending[successor] == 0) ready.push_back(successor);
+    }
+  }
+}
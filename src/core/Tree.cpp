@@ -1,175 +1,846 @@
 #include "core/Tree.h"
 
 #include <algorithm>
-#include <cstdlib>  // for rand
-#include <ctime>    // for time (seed rand)
-#include <iostream>
+#include <array>
+#include <cassert>
+#include <numeric>
+#include <random>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
-#include <glad/glad.h>
-
+#include "core/Parallel.h"
 #include "core/Strand.h"
-#include "geometry/Spline.h"  // for NUM_INTERPOLATED_POINTS
+#include "core/TaskGraph.h"
+#include "geometry/Spline.h"
 #include "geometry/util.h"
 #include "simulation/PBD.h"
 
-void Tree::computeStrandsPosition() {
-  time_t t = time(nullptr);
-  // std::cout << "random seed: " << t << std::endl;
-  std::srand(t);
+namespace {
+
+// node particles by strand id, for binary searches
+using StrandLookup = std::vector<std::pair<int, const StrandParticle*>>;
+
+void addToLookup(
+    const std::vector<std::shared_ptr<StrandParticle>>& particles, StrandLookup& lookup
+) {
+  for (const auto& particle : particles) lookup.emplace_back(particle->strandId, particle.get());
+}
+
+const StrandParticle* findInLookup(const StrandLookup& lookup, int strandId) {
+  auto it = std::lower_bound(lookup.begin(), lookup.end(), strandId, [](const auto& entry, int id) {
+    return entry.first < id;
+  });
+  return it != lookup.end() && it->first == strandId ? it->second : nullptr;
+}
+
+}  // namespace
 
+void Tree::computeStrandsPosition() {
   computeCoordinateSystems();
-  computeStrandsInNode(0);  // compute all strands recursively
-  applyPBD();
+
+  // leaf strands in depth-first order, so that the strand ids don't depend on the scheduling
+  pg.traverseDFS(0, [&](const Node& n) {
+    if (pg.getChildren(n.id).empty()) createLeafStrands(n.id);
+  });
+
+  bundledStrands.assign(strands.size(), {});
+  runStrandTasks(true);
+
+  pg.clearDirtyNodes();  // everything is up to date
 }
 
-// recursively compute strands in specified node of the plant graph
-void Tree::computeStrandsInNode(int nodeId) {
-  const Node& node = pg.getNode(nodeId);
-  glm::mat3 currentFrontplane = frontplanes[nodeId];
-  std::vector<int>& children = pg.adj[nodeId];
+// the merges of different subtrees, the pbd of all the merged nodes and the interpolation of all
+// the packed segments run concurrently. the tasks only look up existing map entries, and every
+// task writes its own entries (or strands) only
+void Tree::runStrandTasks(bool packLayouts) {
+  const int nodeCount = pg.getNodeCount();
+  TaskGraph graph;
+  std::vector<int> mergeTasks(nodeCount, -1), pbdTasks(nodeCount, -1), segmentTasks(nodeCount, -1);
+
+  segmentParticles.clear();
+  interpolatedCrossSections.clear();
+  crossSectionsTriangulations.clear();
+
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    nodeParticles.try_emplace(nodeId);
+    mergedLayouts.try_emplace(nodeId);
+    if (!pg.getNode(nodeId).isRoot()) segmentParticles.try_emplace(nodeId);
+  }
 
-  // 1. compute strands for children (or create strands if there are no children)
-  if (!children.empty()) {
-    for (auto child : children) {
-      computeStrandsInNode(child);
+  // every node is merged once its children are, and packed right after
+  for (int nodeId = 0; packLayouts && nodeId < nodeCount; ++nodeId) {
+    if (!pg.getChildren(nodeId).empty()) {
+      mergeTasks[nodeId] = graph.add([this, nodeId]() { mergeChildrenStrands(nodeId); });
     }
-  } else {
-    // leaf nodes (no outgoing branches)
-    // generate strand particle positions randomly in a defined radius
-    for (int i = 0; i < NUM_STRANDS_PER_LEAF; ++i) {
-      float radius = NODE_STRAND_AREA_RADIUS - STRAND_RADIUS;
-      float theta = static_cast<float>(std::rand()) / RAND_MAX * 2 * M_PI;
+  }
 
-      glm::vec3 particlePos = {radius * std::cos(theta), radius * std::sin(theta), 0};
+  for (int nodeId = 0; packLayouts && nodeId < nodeCount; ++nodeId) {
+    pbdTasks[nodeId] = graph.add([this, nodeId]() { applyPBD(nodeId); });
+    if (mergeTasks[nodeId] == -1) continue;
 
-      Strand strand;
-      auto particle = strand.addParticle(node.pos + currentFrontplane * particlePos, particlePos);
+    graph.depend(pbdTasks[nodeId], mergeTasks[nodeId]);
+    for (int child : pg.getChildren(nodeId)) {
+      if (mergeTasks[child] != -1) graph.depend(mergeTasks[nodeId], mergeTasks[child]);
+    }
+  }
 
-      strands.emplace_back(std::move(strand));
-      nodeParticles[nodeId].push_back(particle);
+  auto dependOnPBD = [&](int task, int nodeId) {
+    if (pbdTasks[nodeId] != -1) graph.depend(task, pbdTasks[nodeId]);
+  };
+
+  // a segment needs the packed particles of its two nodes, and of the nodes around them for the
+  // catmull-rom tangents: the children of its child node and the parent of its parent node
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    const Node& node = pg.getNode(nodeId);
+    if (node.isRoot()) continue;
+
+    segmentTasks[nodeId] = graph.add([this, nodeId]() {
+      segmentParticles.at(nodeId) = interpolateSegment(nodeId);
+    });
+
+    dependOnPBD(segmentTasks[nodeId], nodeId);
+    dependOnPBD(segmentTasks[nodeId], node.parentId);
+    if (!pg.getNode(node.parentId).isRoot()) {
+      dependOnPBD(segmentTasks[nodeId], pg.getNode(node.parentId).parentId);
     }
+    for (int child : pg.getChildren(nodeId)) dependOnPBD(segmentTasks[nodeId], child);
+  }
 
-    return;  // nothing more to do for leaf nodes
+  // the strands of a leaf get their interpolated particles once all the segments on their way to
+  // the root are interpolated
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    if (!pg.getChildren(nodeId).empty() || pg.getNode(nodeId).isRoot()) continue;
+
+    const int spliceTask = graph.add([this, nodeId]() {
+      for (const auto& particle : nodeParticles.at(nodeId)) {
+        spliceSegmentParticles(particle->strandId);
+      }
+    });
+    for (int id = nodeId; !pg.getNode(id).isRoot(); id = pg.getNode(id).parentId) {
+      graph.depend(spliceTask, segmentTasks[id]);
+    }
+  }
+
+  // eager cross sections: the branch segments from a node are computed once the segments from its
+  // children are interpolated
+  std::vector<BranchSegment> branchSegments(eagerCrossSections ? nodeCount : 0);
+
+  for (int nodeId = 0; eagerCrossSections && nodeId < nodeCount; ++nodeId) {
+    const int branchSegmentTask = graph.add([this, &branchSegments, nodeId]() {
+      branchSegments[nodeId] = computeBranchSegment(nodeId);
+    });
+
+    dependOnPBD(branchSegmentTask, nodeId);
+    for (int child : pg.getChildren(nodeId)) graph.depend(branchSegmentTask, segmentTasks[child]);
   }
 
-  // 2. merge results
+  graph.run(cancellation);
+
+  for (int nodeId = 0; nodeId < branchSegments.size(); ++nodeId) {
+    storeBranchSegment(nodeId, std::move(branchSegments[nodeId]));
+  }
+}
+
+void Tree::createLeafStrands(int nodeId) {
+  const Node& node = pg.getNode(nodeId);
+
+  // random numbers of every leaf depend only on the seed and the leaf: the same graph and seed
+  // give the same strands, whatever the order the leaves are created in
+  std::seed_seq seedSequence{seed, static_cast<unsigned int>(nodeId)};
+  std::mt19937 rng(seedSequence);
+  std::uniform_real_distribution<float> angle(0.0f, 2.0f * M_PI);
+
+  // leaf nodes (no outgoing branches)
+  // generate strand particle positions randomly in a defined radius
+  for (int i = 0; i < NUM_STRANDS_PER_LEAF; ++i) {
+    float radius = NODE_STRAND_AREA_RADIUS - STRAND_RADIUS;
+    float theta = angle(rng);
+
+    glm::vec3 particlePos = {radius * std::cos(theta), radius * std::sin(theta), 0};
+
+    Strand strand(strands.size(), Strand::randomColor(rng));
+    auto particle =
+        strand.addParticle(node.pos + frontplanes[nodeId] * particlePos, particlePos, nodeId);
+
+    strands.emplace_back(std::move(strand));
+    nodeParticles[nodeId].push_back(particle);
+    mergedLayouts[nodeId].push_back(particlePos);
+  }
+}
+
+// compute the (pre-PBD) layout of the node from the layouts of its children. particles already
+// present in the node are reused, new strands get a new particle in this node
+void Tree::mergeChildrenStrands(int nodeId) {
+  const Node& node = pg.getNode(nodeId);
+  glm::mat3 currentFrontplane = frontplanes.at(nodeId);
+  auto children = pg.getChildren(nodeId);
+
+  std::vector<MergedStrand> merged;
+  std::vector<int> childOffsets{0};  // strands of every child in `merged`
+
   // if not branching, directly project the strand particle positions from the child plane
   // to the underlying branching node plane
   bool branching = children.size() > 1;
   if (!branching) {
-    for (auto child : children) {
-      for (auto& particle : nodeParticles[child]) {
-        // project in same position
-        auto newParticle = strands[particle->strandId].addParticle(
-            node.pos + currentFrontplane * particle->localPos, particle->localPos
-        );
-        nodeParticles[nodeId].push_back(newParticle);
+    int child = children[0];
+    const auto& childParticles = nodeParticles.at(child);
+    for (int j = 0; j < childParticles.size(); ++j) {
+      // project in same position
+      const auto& particle = childParticles[j];
+      merged.push_back({particle, mergedLayouts.at(child)[j], particle->weight});
+    }
+    childOffsets.push_back(merged.size());
+  } else {
+    // strands coming from multiple branches -> merge algorithm
+    // sort the children (ascending) according to their amount of strand particles
+    std::stable_sort(children.begin(), children.end(), [&](int a, int b) -> bool {
+      return nodeParticles.at(a).size() > nodeParticles.at(b).size();
+    });
+
+    float dlarge = 0.0f;
+    for (int i = 0; i < children.size(); ++i) {
+      int child = children[i];
+      glm::vec3 dir{glm::normalize(glm::vec2{pg.getNode(child).pos - node.pos}), 0.0f};
+
+      const auto& childParticles = nodeParticles.at(child);
+      float dsmall = 0.0f;
+      for (int j = 0; j < childParticles.size(); ++j) {
+        const glm::vec3& localPos = mergedLayouts.at(child)[j];
+
+        // offset (length and direction) to project from origin
+        float offset = i != 0 ? dlarge + dsmall : 0;
+        glm::vec3 mergedPos = localPos + offset * dir;
+
+        if (i == 0)
+          dlarge = std::max(dlarge, glm::length(mergedPos));
+        else
+          dsmall = std::max(dsmall, glm::length(mergedPos) - dlarge);
+
+        const auto& particle = childParticles[j];
+        merged.push_back({particle, mergedPos, particle->weight});
       }
+      childOffsets.push_back(merged.size());
     }
+  }
+
+  // (the strands arrive in a single node: no other merge writes their bundles)
+  for (const MergedStrand& strand : merged) bundledStrands[strand.childParticle->strandId] = {};
+
+  if (maxNodeStrands > 0 && merged.size() > maxNodeStrands) {
+    merged = bundleStrands(merged, childOffsets);
+  }
+
+  std::unordered_map<int, std::shared_ptr<StrandParticle>> existingParticles;
+  for (auto& particle : nodeParticles.at(nodeId)) existingParticles[particle->strandId] = particle;
+
+  std::vector<std::shared_ptr<StrandParticle>> particles;
+  std::vector<glm::vec3> layout;
+
+  for (const MergedStrand& strand : merged) {
+    const int strandId = strand.childParticle->strandId;
+    glm::vec3 pos = node.pos + currentFrontplane * strand.localPos;
+
+    auto it = existingParticles.find(strandId);
+    if (it != existingParticles.end()) {
+      it->second->pos = pos;
+      it->second->localPos = strand.localPos;
+      particles.push_back(it->second);
+    } else {
+      particles.push_back(strands[strandId].addParticle(pos, strand.localPos, nodeId));
+    }
+
+    particles.back()->weight = strand.weight;
+    layout.push_back(strand.localPos);
+  }
 
-    return;  // nothing more to do for not branch nodes
+  nodeParticles.at(nodeId) = std::move(particles);
+  mergedLayouts.at(nodeId) = std::move(layout);
+}
+
+// bundle the strands of every child so that the node gets about maxNodeStrands of them: each
+// bundle goes on as its heaviest strand, at the (weighted) centroid of the bundle
+std::vector<Tree::MergedStrand> Tree::bundleStrands(
+    const std::vector<MergedStrand>& merged, const std::vector<int>& childOffsets
+) {
+  const int total = merged.size();
+
+  std::vector<glm::vec3> layout;
+  layout.reserve(total);
+  for (const MergedStrand& strand : merged) layout.push_back(strand.localPos);
+
+  std::vector<int> order(total);
+  std::iota(order.begin(), order.end(), 0);
+
+  // bundles never mix children, so that every branch segment keeps strands, and thin branches
+  // keep enough of them for a proper cross section
+  std::vector<std::pair<int, int>> groups;
+  for (int c = 0; c + 1 < childOffsets.size(); ++c) {
+    const int first = childOffsets[c], last = childOffsets[c + 1];
+    const int count = last - first;
+    if (count == 0) continue;
+
+    const int groupCount = std::max(
+        static_cast<int>(static_cast<long long>(count) * maxNodeStrands / total),
+        std::min(count, NUM_STRANDS_PER_LEAF)
+    );
+    util::splitClusters(layout, order, first, last, groupCount, groups);
   }
 
-  // strands coming from multiple branches -> merge algorithm
-  // sort the children (ascending) according to their amount of strand particles
-  std::sort(children.begin(), children.end(), [&](int a, int b) -> bool {
-    return nodeParticles[a].size() > nodeParticles[b].size();
+  std::vector<std::pair<int, MergedStrand>> bundles;  // by index of their super-strand
+  bundles.reserve(groups.size());
+
+  for (const auto& [first, last] : groups) {
+    // heaviest strand, the first one on ties (the result doesn't depend on the split order)
+    const int superStrand = *std::max_element(
+        order.begin() + first, order.begin() + last,
+        [&](int a, int b) {
+          return merged[a].weight < merged[b].weight ||
+                 (merged[a].weight == merged[b].weight && a > b);
+        }
+    );
+
+    MergedStrand bundle = merged[superStrand];
+    bundle.weight = 0;
+
+    glm::vec3 centroid{0.0f};
+    for (int i = first; i < last; ++i) {
+      const MergedStrand& strand = merged[order[i]];
+      bundle.weight += strand.weight;
+      centroid += static_cast<float>(strand.weight) * strand.localPos;
+    }
+    bundle.localPos = centroid / static_cast<float>(bundle.weight);
+
+    // the other strands end in the child (they may have gone further before an update)
+    for (int i = first; i < last; ++i) {
+      if (order[i] == superStrand) continue;
+
+      const MergedStrand& strand = merged[order[i]];
+      const int strandId = strand.childParticle->strandId;
+      strands[strandId].endAt(strand.childParticle);
+      const glm::vec3 offset = strand.localPos - bundle.localPos;
+      bundledStrands[strandId] = {bundle.childParticle->strandId, offset};
+    }
+
+    bundles.emplace_back(superStrand, bundle);
+  }
+
+  // same order as the merged layout
+  std::sort(bundles.begin(), bundles.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
   });
 
-  float dlarge = 0.0f;
-  for (int i = 0; i < children.size(); ++i) {
-    int child = children[i];
-    glm::vec3 dir{glm::normalize(glm::vec2{pg.getNode(child).pos - node.pos}), 0.0f};
+  std::vector<MergedStrand> result;
+  result.reserve(bundles.size());
+  for (auto& [index, bundle] : bundles) result.push_back(std::move(bundle));
 
-    float dsmall = 0.0f;
-    for (auto& particle : nodeParticles[child]) {
-      // offset (length and direction) to project from origin
-      float offset = i != 0 ? dlarge + dsmall : 0;
-      glm::vec3 mergedPos = particle->localPos + offset * dir;
+  return result;
+}
 
-      if (i == 0)
-        dlarge = std::max(dlarge, glm::length(mergedPos));
-      else
-        dsmall = std::max(dsmall, glm::length(mergedPos) - dlarge);
+void Tree::expandSuperStrands(const std::vector<int>& nodeIds) {
+  // strands ending in the subtrees (below their root) in a super-strand, the ones ending nearer
+  // the root first: the super-strands they follow go on to the root by then
+  std::vector<std::tuple<int, int, int>> expanded;  // (depth of its end, strand id, subtree root)
+  std::set<int> subtreeNodes;
+
+  for (int rootId : nodeIds) {
+    pg.traverseDFS(rootId, [&](const Node& n) {
+      subtreeNodes.insert(n.id);
+      if (n.id == rootId) return;
+
+      for (const auto& particle : nodeParticles.at(n.id)) {
+        const int strandId = particle->strandId;
+        if (bundledStrands[strandId].superStrand == -1 ||
+            strands[strandId].getParticles().back() != particle) {
+          continue;
+        }
 
-      auto newParticle = strands[particle->strandId].addParticle(
-          node.pos + currentFrontplane * mergedPos, mergedPos
-      );
-      nodeParticles[nodeId].push_back(newParticle);
+        int depth = 0;
+        for (int id = n.id; id != rootId; id = pg.getNode(id).parentId) ++depth;
+        expanded.emplace_back(depth, strandId, rootId);
+      }
+    });
+  }
+  std::sort(expanded.begin(), expanded.end());
+
+  for (const auto& [depth, strandId, rootId] : expanded) {
+    Strand& strand = strands[strandId];
+    const BundledStrand& bundled = bundledStrands[strandId];
+
+    int nodeId = strand.getParticles().back()->nodeId;
+    while (nodeId != rootId) {
+      nodeId = pg.getNode(nodeId).parentId;
+
+      // the super-strand particle in the node (with its merged layout position)
+      auto& particles = nodeParticles.at(nodeId);
+      int superIndex = 0;
+      while (superIndex < particles.size() &&
+             particles[superIndex]->strandId != bundled.superStrand) {
+        ++superIndex;
+      }
+      assert(superIndex < particles.size());
+      if (superIndex == particles.size()) break;
+
+      const glm::vec3 localPos = particles[superIndex]->localPos + bundled.offset;
+      const glm::vec3 mergedPos = mergedLayouts.at(nodeId)[superIndex] + bundled.offset;
+
+      particles.push_back(strand.addParticle(
+          pg.getNode(nodeId).pos + frontplanes.at(nodeId) * localPos, localPos, nodeId
+      ));
+      mergedLayouts.at(nodeId).push_back(mergedPos);
     }
   }
+
+  // every strand in the subtrees stands for itself
+  for (int nodeId : subtreeNodes) {
+    for (auto& particle : nodeParticles.at(nodeId)) particle->weight = 1;
+  }
+
+  runStrandTasks(false);
 }
 
 void Tree::computeCoordinateSystems() {
-  pg.traverseDFS(0, [&](const Node& n) {
-    // frontplanes
-    if (!n.isRoot()) {
-      glm::vec3 yparent = frontplanes[n.parentId][1];
+  pg.traverseDFS(0, [&](const Node& n) { computeCoordinateSystem(n.id); });
+}
 
-      glm::vec3 zaxis = glm::normalize(n.pos - pg.getNode(n.parentId).pos);
-      glm::vec3 xaxis = glm::normalize(glm::cross(yparent, zaxis));
-      glm::vec3 yaxis = glm::cross(zaxis, xaxis);
+void Tree::computeCoordinateSystem(int nodeId) {
+  const Node& n = pg.getNode(nodeId);
 
-      frontplanes[n.id] = glm::mat3(xaxis, yaxis, zaxis);
-    } else {
-      frontplanes[n.id] = DEFAULT_COORDINATES;
-    }
-  });
+  // frontplanes
+  if (!n.isRoot()) {
+    glm::vec3 yparent = frontplanes[n.parentId][1];
+
+    glm::vec3 zaxis = glm::normalize(n.pos - pg.getNode(n.parentId).pos);
+    glm::vec3 xaxis = glm::normalize(glm::cross(yparent, zaxis));
+    glm::vec3 yaxis = glm::cross(zaxis, xaxis);
+
+    frontplanes[n.id] = glm::mat3(xaxis, yaxis, zaxis);
+  } else {
+    frontplanes[n.id] = DEFAULT_COORDINATES;
+  }
 }
 
-void Tree::applyPBD() {
+void Tree::applyPBD(int nodeId, const std::unordered_map<int, glm::vec3>& previous) {
   std::vector<glm::vec3> attractors{
       {0.0f, 0.0f, 0.0f}
   };
   PBD pbd({}, attractors, 0.02, 0.002, STRAND_RADIUS, {0.0f, 0.0f, 0.0f}, NODE_STRAND_AREA_RADIUS);
 
-  for (auto& [nodeId, particles] : nodeParticles) {
-    std::vector<glm::vec3> pos;
+  auto& particles = nodeParticles.at(nodeId);
+  std::vector<glm::vec3> pos = mergedLayouts.at(nodeId);
+
+  // warm start: the strands that were already packed in the node start from there
+  int previousCount = 0;
+  for (const auto& particle : particles) previousCount += previous.count(particle->strandId);
 
-    for (auto& particle : particles) pos.push_back(particle->localPos);
+  const bool warmStart = previousCount > 0 && 2 * previousCount >= particles.size();
+  for (int i = 0; warmStart && i < particles.size(); ++i) {
+    auto packed = previous.find(particles[i]->strandId);
+    if (packed != previous.end()) pos[i] = packed->second;
+  }
+
+  // execute pbd for every node, to "pack" the strands, without intersections
+  pbd.setPoints(pos);
+
+  // super-strands take the area of the strands they stand for
+  int totalWeight = 0;
+  std::vector<float> radii;
+  for (const auto& particle : particles) {
+    totalWeight += particle->weight;
+    radii.push_back(particle->getRadius());
+  }
+  if (totalWeight > particles.size()) pbd.setRadii(radii);
+
+  // with bundling, the iterations don't grow with the leaf count either
+  int simulatedStrands = strands.size();
+  if (maxNodeStrands > 0) simulatedStrands = std::min(simulatedStrands, maxNodeStrands);
 
-    // execute pbd for every node, to "pack" the strands, without intersections
-    pbd.setPoints(pos);
+  const int iterations = 5 * simulatedStrands;
+  const float profileRadius = 0.1 * totalWeight * NODE_STRAND_AREA_RADIUS;
+
+  if (warmStart) {
+    const int newStrands = particles.size() - previousCount;
     pos = pbd.execute(
-        5 * Strand::getStrandCount(), {0.0f, 0.0f, 0.0f}, 0.1 * pos.size() * NODE_STRAND_AREA_RADIUS
+        std::min(iterations, WARM_START_PBD_ITERATIONS + 5 * newStrands), {0.0f, 0.0f, 0.0f},
+        profileRadius
     );
+  } else if (pos.size() < MULTILEVEL_PBD_POINTS) {
+    pos = pbd.execute(iterations, {0.0f, 0.0f, 0.0f}, profileRadius);
+  } else {
+    // large nodes are packed coarse to fine, from clusters of neighbouring particles
+    std::vector<int> order(pos.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::vector<std::pair<int, int>> ranges;
+    const int clusterCount =
+        (pos.size() + MULTILEVEL_CLUSTER_POINTS - 1) / MULTILEVEL_CLUSTER_POINTS;
+    util::splitClusters(pos, order, 0, pos.size(), clusterCount, ranges);
+
+    std::vector<std::vector<int>> clusters;
+    for (const auto& [first, last] : ranges) {
+      clusters.emplace_back(order.begin() + first, order.begin() + last);
+    }
+
+    pos = pbd.executeMultilevel(iterations, {0.0f, 0.0f, 0.0f}, profileRadius, clusters);
+  }
+
+  // set the strand particles position after running the PBD simulation
+  for (int i = 0; i < particles.size(); ++i) {
+    particles[i]->pos = pg.getNode(nodeId).pos + frontplanes.at(nodeId) * pos[i];
+    particles[i]->localPos = pos[i];
+  }
+}
+
+/* ------------------- INCREMENTAL RECOMPUTATION ------------------- */
+
+std::set<int> Tree::update() {
+  if (!pg.hasDirtyNodes()) return {};
+
+  std::set<int> addedNodes, movedNodes;
+  for (int nodeId : pg.getDirtyNodes()) {
+    if (frontplanes.count(nodeId))
+      movedNodes.insert(nodeId);
+    else
+      addedNodes.insert(nodeId);
+  }
 
-    // set the strand particles position after running the PBD simulation
-    for (int i = 0; i < particles.size(); ++i) {
-      particles[i]->pos = pg.getNode(nodeId).pos + frontplanes[nodeId] * pos[i];
-      particles[i]->localPos = pos[i];
+  // 1. find what is invalidated by the edit
+  std::set<int> frontplaneDirty;  // frontplane (and thus world positions) changed
+  std::set<int> layoutDirty;      // merged layout (and thus pbd) changed
+  std::set<int> segmentDirty;     // cross sections must be recomputed
+
+  auto markAncestors = [&](int nodeId, std::set<int>& dirty) {
+    for (int id = nodeId; id != -1; id = pg.getNode(id).parentId) dirty.insert(id);
+  };
+
+  for (int nodeId : movedNodes) {
+    // frontplanes depend on the parent axes, so the whole subtree is affected
+    pg.traverseDFS(nodeId, [&](const Node& n) { frontplaneDirty.insert(n.id); });
+    markAncestors(nodeId, layoutDirty);
+  }
+
+  // a leaf that gets new children hands its strands to the first of them
+  auto adoptsParentStrands = [&](int nodeId) {
+    int parentId = pg.getNode(nodeId).parentId;
+    if (parentId == -1 || addedNodes.count(parentId)) return false;
+    if (pg.getChildren(parentId)[0] != nodeId) return false;
+
+    const auto siblings = pg.getChildren(parentId);
+    return std::all_of(siblings.begin(), siblings.end(), [&](int id) {
+      return addedNodes.count(id);
+    });
+  };
+
+  for (int nodeId : addedNodes) {
+    frontplaneDirty.insert(nodeId);
+
+    int parentId = pg.getNode(nodeId).parentId;
+    if (parentId == -1) continue;
+
+    // if the adopted strands are the only ones, the layouts above stay the same (the segments
+    // around the new node are marked below)
+    if (adoptsParentStrands(nodeId) && pg.getChildren(parentId).size() == 1) continue;
+    markAncestors(parentId, layoutDirty);
+  }
+
+  std::set<int> positionDirty = frontplaneDirty;
+  positionDirty.insert(layoutDirty.begin(), layoutDirty.end());
+
+  // cross sections of a segment are interpolated from the strand particles at its start node,
+  // its children, grandchildren and the parent (catmull-rom window)
+  for (int nodeId : positionDirty) {
+    int parentId = pg.getNode(nodeId).parentId;
+
+    segmentDirty.insert(nodeId);
+    if (parentId != -1) {
+      segmentDirty.insert(parentId);
+      if (!pg.getNode(parentId).isRoot()) segmentDirty.insert(pg.getNode(parentId).parentId);
     }
+    for (int child : pg.getChildren(nodeId)) segmentDirty.insert(child);
   }
+
+  // 2. new frontplanes, top-down
+  pg.traverseDFS(0, [&](const Node& n) {
+    if (frontplaneDirty.count(n.id)) computeCoordinateSystem(n.id);
+  });
+
+  // 3. structural changes: strands for the new nodes
+  for (int nodeId : addedNodes) {
+    int parentId = pg.getNode(nodeId).parentId;
+    nodeParticles.try_emplace(nodeId);
+    mergedLayouts.try_emplace(nodeId);
+
+    if (adoptsParentStrands(nodeId)) {
+      // the parent was a leaf: its strands now start at the new node
+      for (int i = 0; i < nodeParticles[parentId].size(); ++i) {
+        auto& parentParticle = nodeParticles[parentId][i];
+        const glm::vec3& localPos = mergedLayouts[parentId][i];
+
+        nodeParticles[nodeId].push_back(strands[parentParticle->strandId].prependParticle(
+            pg.getNode(nodeId).pos + frontplanes[nodeId] * localPos, localPos, nodeId
+        ));
+        mergedLayouts[nodeId].push_back(localPos);
+      }
+    } else if (pg.getChildren(nodeId).empty()) {
+      createLeafStrands(nodeId);
+    }
+
+    // new inner nodes get their layout merged (and packed) with the ancestors below
+    if (pg.getChildren(nodeId).empty()) applyPBD(nodeId);
+  }
+
+  // 4. merged layouts and pbd of the ancestors, bottom-up
+  bundledStrands.resize(strands.size());
+
+  std::vector<std::pair<int, int>> layoutOrder;  // (depth, node id)
+  for (int nodeId : layoutDirty) {
+    int depth = 0;
+    for (int id = nodeId; !pg.getNode(id).isRoot(); id = pg.getNode(id).parentId) ++depth;
+    layoutOrder.emplace_back(depth, nodeId);
+  }
+  std::sort(layoutOrder.rbegin(), layoutOrder.rend());
+
+  for (auto& [depth, nodeId] : layoutOrder) {
+    if (pg.getChildren(nodeId).empty()) continue;  // leaf layouts are not derived from anything
+
+    // the packed layout of the node before the update, to start its pbd from
+    std::unordered_map<int, glm::vec3> previous;
+    for (const auto& particle : nodeParticles.at(nodeId)) {
+      previous[particle->strandId] = particle->localPos;
+    }
+
+    mergeChildrenStrands(nodeId);
+    applyPBD(nodeId, previous);
+  }
+
+  // 5. world positions of the nodes whose frontplane changed but not their layout
+  for (int nodeId : frontplaneDirty) {
+    if (layoutDirty.count(nodeId)) continue;
+
+    for (auto& particle : nodeParticles[nodeId]) {
+      particle->pos = pg.getNode(nodeId).pos + frontplanes[nodeId] * particle->localPos;
+    }
+  }
+
+  pg.clearDirtyNodes();
+
+  // 6. the segments of the dirty branch segments interpolated again (the strands through them,
+  // which include the new and the bundled ones, get their new particles), and the branch segments
+  // dropped: they are computed again when next needed
+  std::set<int> dirtySegments;  // by child node
+  for (int nodeId : segmentDirty) {
+    for (int child : pg.getChildren(nodeId)) dirtySegments.insert(child);
+  }
+
+  std::set<int> touchedStrands;
+  for (int childId : dirtySegments) {
+    for (auto& particle : nodeParticles[childId]) touchedStrands.insert(particle->strandId);
+  }
+
+  TaskGraph graph;
+  std::map<int, int> segmentTasks;
+  for (int childId : dirtySegments) {
+    segmentParticles.try_emplace(childId);
+    segmentTasks[childId] = graph.add([this, childId]() {
+      segmentParticles.at(childId) = interpolateSegment(childId);
+    });
+  }
+
+  for (int strandId : touchedStrands) {
+    const int spliceTask = graph.add([this, strandId]() { spliceSegmentParticles(strandId); });
+    for (const auto& particle : strands[strandId].getParticles()) {
+      auto segmentTask = segmentTasks.find(particle->nodeId);
+      if (!particle->interpolated && segmentTask != segmentTasks.end())
+        graph.depend(spliceTask, segmentTask->second);
+    }
+  }
+
+  graph.run(cancellation);
+
+  for (int nodeId : positionDirty) {
+    for (auto& particle : nodeParticles[nodeId]) particleDirtyStrands.insert(particle->strandId);
+  }
+  particleDirtyStrands.insert(touchedStrands.begin(), touchedStrands.end());
+
+  for (int nodeId : segmentDirty) {
+    interpolatedCrossSections.erase(nodeId);
+    crossSectionsTriangulations.erase(
+        crossSectionsTriangulations.lower_bound({nodeId, -1}),
+        crossSectionsTriangulations.lower_bound({nodeId + 1, -1})
+    );
+  }
+
+  // mesh ranges to be regenerated: node particles and cross sections that changed
+  std::set<int> meshDirty = positionDirty;
+  meshDirty.insert(segmentDirty.begin(), segmentDirty.end());
+
+  return meshDirty;
+}
+
+// the segments the branch segments are built from are interpolated (and their nodes packed) by the
+// strand computations: the tasks only depend on those
+void Tree::computeBranchSegments(const std::vector<int>& nodeIds) {
+  std::vector<int> missing;
+  for (int nodeId : nodeIds) {
+    if (!interpolatedCrossSections.count(nodeId)) missing.push_back(nodeId);
+  }
+
+  TaskGraph graph;
+  std::vector<BranchSegment> branchSegments(missing.size());
+  for (int i = 0; i < missing.size(); ++i) {
+    graph.add([this, &branchSegments, &missing, i]() {
+      branchSegments[i] = computeBranchSegment(missing[i]);
+    });
+  }
+
+  graph.run(cancellation);
+
+  for (int i = 0; i < missing.size(); ++i) {
+    storeBranchSegment(missing[i], std::move(branchSegments[i]));
+  }
+}
+
+Tree::BranchSegment Tree::computeBranchSegment(int branchStartNode) const {
+  BranchSegment segment;
+  segment.crossSections = interpolateBranchSegment(branchStartNode);
+  segment.triangulations = triangulateCrossSections(branchStartNode, segment.crossSections);
+
+  return segment;
+}
+
+void Tree::storeBranchSegment(int branchStartNode, BranchSegment&& segment) {
+  for (int k = 0; k < segment.triangulations.size(); ++k) {
+    crossSectionsTriangulations[{branchStartNode, k - 1}] = std::move(segment.triangulations[k]);
+  }
+  interpolatedCrossSections[branchStartNode] = std::move(segment.crossSections);
+}
+
+int Tree::SegmentParticles::findStrand(int strandId) const {
+  auto it = std::lower_bound(
+      strandOffsets.begin(), strandOffsets.end(), std::make_pair(strandId, -1)
+  );
+  return it != strandOffsets.end() && it->first == strandId ? it->second : -1;
+}
+
+// catmull-rom interpolation of every strand going on from the child node to its parent, in a
+// single batch. the control points are looked up in the node particles (the strands are being
+// spliced meanwhile): the ends of a strand get mirrored control points
+Tree::SegmentParticles Tree::interpolateSegment(int childId) const {
+  const int parentId = pg.getNode(childId).parentId;
+  const int grandparentId = pg.getNode(parentId).parentId;
+
+  StrandLookup previous, next, last;
+  for (int grandchild : pg.getChildren(childId)) {
+    addToLookup(nodeParticles.at(grandchild), previous);
+  }
+  addToLookup(nodeParticles.at(parentId), next);
+  if (grandparentId != -1) addToLookup(nodeParticles.at(grandparentId), last);
+  for (StrandLookup* lookup : {&previous, &next, &last}) std::sort(lookup->begin(), lookup->end());
+
+  SegmentParticles segment;
+  std::vector<const StrandParticle*> ends;  // particle in the parent of every strand going on
+  std::vector<SegmentControlPoints> controlPoints;
+
+  for (const auto& particle : nodeParticles.at(childId)) {
+    const StrandParticle* p2 = findInLookup(next, particle->strandId);
+    if (!p2) continue;  // bundled into a super-strand here
+
+    const glm::vec3& p1 = particle->pos;
+    const StrandParticle* p0 = findInLookup(previous, particle->strandId);
+    const StrandParticle* p3 = findInLookup(last, particle->strandId);
+
+    segment.strandOffsets.emplace_back(particle->strandId, ends.size());
+    ends.push_back(p2);
+    controlPoints.push_back({
+        p0 ? p0->pos : 2.0f * p1 - p2->pos,
+        p1,
+        p2->pos,
+        p3 ? p3->pos : 2.0f * p2->pos - p1,
+    });
+  }
+
+  // the samples are the maximum needed by any strand to stay within the chord tolerance
+  if (adaptiveSamplingTolerance > 0.0f && !controlPoints.empty()) {
+    segment.samples = MIN_ADAPTIVE_SEGMENT_SAMPLES;
+    for (const auto& [p0, p1, p2, p3] : controlPoints) {
+      segment.samples = std::max(
+          segment.samples, Spline::computeSegmentSamples(p0, p1, p2, p3, adaptiveSamplingTolerance)
+      );
+    }
+  }
+
+  // the samples of all the strands in one buffer (the first one of every strand is its particle
+  // in the child node)
+  const int nSamples = segment.samples;
+  std::vector<glm::vec3> samples(controlPoints.size() * nSamples);
+  Spline::interpolateSegments(controlPoints.data(), controlPoints.size(), nSamples, samples.data());
+
+  // interpolated particles belong to the branch segment ending at the parent
+  segment.particles = std::make_shared<std::vector<StrandParticle>>();
+  segment.particles->reserve(controlPoints.size() * (nSamples - 1));
+
+  for (int i = 0; i < controlPoints.size(); ++i) {
+    for (int k = 1; k < nSamples; ++k) {
+      segment.particles->emplace_back(
+          ends[i]->strandId, samples[i * nSamples + k], glm::vec3(0.0f), true, parentId
+      );
+      segment.particles->back().weight = ends[i]->weight;
+    }
+  }
+
+  // offsets of the strands in the particles
+  for (auto& [strandId, offset] : segment.strandOffsets) offset *= nSamples - 1;
+  std::sort(segment.strandOffsets.begin(), segment.strandOffsets.end());
+
+  return segment;
 }
 
-void Tree::computeCrossSections() {
-  for (int i = 0; i < Strand::getStrandCount(); ++i) strands[i].interpolateParticles();
-  for (int i = 0; i < Node::getNodeCount(); ++i) interpolateBranchSegment(i);
-  triangulateCrossSections();
+int Tree::getSegmentSamples(int childId) const {
+  auto it = segmentParticles.find(childId);
+  return it != segmentParticles.end() ? it->second.samples : NUM_INTERPOLATED_POINTS;
 }
 
-void Tree::interpolateBranchSegment(int branchStartNode) {
-  interpolatedCrossSections[branchStartNode] = {};
+void Tree::spliceSegmentParticles(int strandId) {
+  Strand& strand = strands[strandId];
+  strand.removeInterpolatedParticles();
+
+  const auto& nodeParts = strand.getParticles();
+  std::vector<std::shared_ptr<StrandParticle>> particles;
+
+  for (int i = 0; i < nodeParts.size(); ++i) {
+    particles.push_back(nodeParts[i]);
+    if (i + 1 == nodeParts.size()) break;
 
-  if (pg.adj[branchStartNode].empty()) return;  // ignore leaf nodes
+    // aliases of the segment particles: they live as long as any strand holds one of them
+    const SegmentParticles& segment = segmentParticles.at(nodeParts[i]->nodeId);
+    const int first = segment.findStrand(strandId);
+    assert(first != -1);
+    for (int k = 0; k < segment.samples - 1; ++k) {
+      particles.emplace_back(segment.particles, &(*segment.particles)[first + k]);
+    }
+  }
+
+  strand.setParticles(std::move(particles));
+}
 
-  for (auto& childId : pg.adj[branchStartNode]) {
-    for (int i = 1; i < NUM_INTERPOLATED_POINTS; ++i) {
+std::vector<CrossSection> Tree::interpolateBranchSegment(int branchStartNode) const {
+  std::vector<CrossSection> crossSections;
+
+  for (int childId : pg.getChildren(branchStartNode)) {  // none for leaf nodes
+    const SegmentParticles& segment = segmentParticles.at(childId);
+
+    for (int i = 1; i < segment.samples; ++i) {
       CrossSection crossSection;
 
       // add the corresponding interpolation level to the cross section (not coplanar yet)
-      for (auto& particle : nodeParticles[childId]) {
-        const auto& strandParticles = strands[particle->strandId].getParticles();
-
-        int idx;
-        for (idx = 0; idx < strandParticles.size(); ++idx) {
-          if (strandParticles[idx] == particle) break;
-        }
+      for (auto& particle : nodeParticles.at(childId)) {
+        const int offset = segment.findStrand(particle->strandId);
+        if (offset == -1) continue;  // bundled into a super-strand here
 
-        crossSection.particlePositions.push_back(strandParticles[idx + i]->pos);
+        const StrandParticle* interpolated = &(*segment.particles)[offset + i - 1];
+        crossSection.particlePositions.push_back(interpolated->pos);
         crossSection.particleStrandIds.push_back(particle->strandId);
-        crossSection.particleIndices.push_back(idx + i);
+        crossSection.particles.push_back(interpolated);
       }
 
       // calculate least squares plane
@@ -203,190 +874,237 @@ void Tree::interpolateBranchSegment(int branchStartNode) {
         crossSection.particlePositions[j] = glm::vec3(local.x, local.y, 0.0f);
       }
 
-      interpolatedCrossSections[branchStartNode].push_back(crossSection);
+      crossSections.push_back(crossSection);
     }
   }
+
+  return crossSections;
 }
 
-Mesh Tree::generateMesh() const {
-  std::vector<glm::vec3> vertices;
-  std::vector<glm::vec3> normals;
-  std::vector<glm::uvec3> indices;
-
-  int vertexOffset = 0;
-  for (int nodeId = 0; nodeId < Node::getNodeCount(); ++nodeId) {
-    // first: node particles (not interpolated)
-    const auto& nodeParts = nodeParticles.at(nodeId);
-    for (const auto& particle : nodeParts) {
-      vertices.push_back(particle->pos);
-      normals.push_back(glm::normalize(particle->pos - pg.getNode(nodeId).pos));
-    }
+Mesh Tree::generateMesh(VertexFormat format) { return Mesh{generateMeshData(), format}; }
 
-    for (const auto& triangle : crossSectionsTriangulations.at({nodeId, -1})) {
-      indices.push_back(glm::uvec3(vertexOffset) + triangle);
-    }
+std::vector<glm::vec4> Tree::getStrandColors() const {
+  std::vector<glm::vec4> colors;
+  colors.reserve(strands.size());
+  for (const Strand& strand : strands) colors.push_back(strand.getColor());
 
-    vertexOffset += nodeParts.size();
+  return colors;
+}
 
-    // second: interpolated cross sections
-    for (int crossIdx = 0; crossIdx < interpolatedCrossSections.at(nodeId).size(); ++crossIdx) {
-      const auto& curCrossSection = interpolatedCrossSections.at(nodeId)[crossIdx];
-      const int crossSectionSize = curCrossSection.getNumParticles();
+MeshData Tree::generateMeshData(bool withStrandIds) {
+  const int nodeCount = pg.getNodeCount();
 
-      // add the particle positions to the vertices
-      for (int i = 0; i < crossSectionSize; ++i) {
-        int strandId = curCrossSection.particleStrandIds[i];
-        int idx = curCrossSection.particleIndices[i];
+  std::vector<int> nodeIds(nodeCount);
+  std::iota(nodeIds.begin(), nodeIds.end(), 0);
+  computeBranchSegments(nodeIds);
 
-        vertices.push_back(strands[strandId].getParticles()[idx]->pos);
-        normals.push_back(curCrossSection.particleNormals[i]);
-      }
+  // first pass: count the vertices and triangles generated by every node
+  std::vector<NodeMeshLayout> layouts(nodeCount);
+  parallel::forRange(0, nodeCount, [&](int nodeId) {
+    layouts[nodeId] = computeNodeMeshLayout(nodeId);
+  });
 
-      // actual cross section triangulation
-      for (const auto& triangle : crossSectionsTriangulations.at({nodeId, crossIdx})) {
-        indices.push_back(glm::uvec3(vertexOffset) + triangle);
-      }
+  // prefix sum of the counts gives the offset of each node in the final buffers
+  MeshData data;
+  data.ranges.resize(nodeCount);
 
-      // connect the cross section with the previous one
-      CrossSection previousCrossSection;
-      if (crossIdx == 0) {
-        // connect with the last node particles if this is the first cross section
-        for (int i = 0; i < nodeParts.size(); ++i) {
-          previousCrossSection.particlePositions.push_back(nodeParts[i]->pos);
-          previousCrossSection.particleStrandIds.push_back(nodeParts[i]->strandId);
-        }
-      } else {
-        previousCrossSection = interpolatedCrossSections.at(nodeId)[crossIdx - 1];
-      }
+  int vertexOffset = 0, triangleOffset = 0;
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    data.ranges[nodeId] = {
+        vertexOffset, layouts[nodeId].vertexCount, triangleOffset, layouts[nodeId].triangleCount
+    };
 
-      // connect the previous boundary particles with corresponding strand ids
-      // search the previous cross section particleStrandIds for the current strandId
-      int curBoundaryIdx = 0;
-      for (int i : curCrossSection.boundaryVertices) {
-        curBoundaryIdx++;
-        int strandId = curCrossSection.particleStrandIds[i];
-
-        int matchingVertex = -1;
-        int matchingIdx = 0;
-        for (int j : previousCrossSection.boundaryVertices) {
-          if (previousCrossSection.particleStrandIds[j] == strandId) {
-            matchingVertex = j;
-            break;
-          }
-          matchingIdx++;
-        }
+    vertexOffset += layouts[nodeId].vertexCount;
+    triangleOffset += layouts[nodeId].triangleCount;
+  }
 
-        // @TODO: handle the case of strand not present in the previous cross section boundary
-        if (matchingVertex == -1) {
-          continue;
-        }
+  data.vertices.resize(vertexOffset);
+  data.normals.resize(vertexOffset);
+  data.indices.resize(triangleOffset);
+  if (withStrandIds) data.strandIds.resize(vertexOffset);
 
-        int prevOffset = vertexOffset - previousCrossSection.getNumParticles();
-        int nextCurBoundaryIdx = (curBoundaryIdx) % curCrossSection.boundaryVertices.size();
-        int nextMatchingIdx = (matchingIdx + 1) % previousCrossSection.boundaryVertices.size();
-        int afterCurrent = curCrossSection.boundaryVertices[nextCurBoundaryIdx];
-        int afterMatching = previousCrossSection.boundaryVertices[nextMatchingIdx];
-
-        indices.emplace_back(
-            vertexOffset + i, prevOffset + matchingVertex, prevOffset + afterMatching
-        );
-        indices.emplace_back(
-            vertexOffset + i, prevOffset + afterMatching, vertexOffset + afterCurrent
-        );
-      }
+  // second pass: every node fills its own (disjoint) range of the buffers
+  parallel::forRange(0, nodeCount, [&](int nodeId) {
+    fillNodeMesh(nodeId, layouts[nodeId], data.ranges[nodeId], data);
+  });
+
+  return data;
+}
 
-      // @TODO: for the last cross section, connect with next node particles with corresponding
-      // strand ids
+bool Tree::updateMeshData(MeshData& data, const std::set<int>& nodes) {
+  std::vector<int> nodeIds(nodes.begin(), nodes.end());
+  std::vector<NodeMeshLayout> layouts(nodeIds.size());
+  computeBranchSegments(nodeIds);
 
-      vertexOffset += crossSectionSize;
-    }
+  parallel::forRange(0, nodeIds.size(), [&](int i) {
+    layouts[i] = computeNodeMeshLayout(nodeIds[i]);
+  });
+
+  // ranges can only be rewritten in place if their sizes did not change
+  bool sameLayout = data.ranges.size() == pg.getNodeCount();
+  for (int i = 0; sameLayout && i < nodeIds.size(); ++i) {
+    const MeshRange& range = data.ranges[nodeIds[i]];
+    sameLayout = range.vertexCount == layouts[i].vertexCount &&
+                 range.triangleCount == layouts[i].triangleCount;
   }
 
-  return Mesh{vertices, indices, normals};
-}
+  if (!sameLayout) {
+    data = generateMeshData(!data.strandIds.empty());
+    return false;
+  }
 
-void Tree::triangulateCrossSections() {
-  for (int i = 0; i < Node::getNodeCount(); ++i) {
-    // mesh for not interpolated node particles
-    std::vector<glm::vec2> planarCoords;
-    for (auto& particle : nodeParticles.at(i)) {
-      planarCoords.emplace_back(particle->localPos);
-    }
+  parallel::forRange(0, nodeIds.size(), [&](int i) {
+    fillNodeMesh(nodeIds[i], layouts[i], data.ranges[nodeIds[i]], data);
+  });
 
-    crossSectionsTriangulations[{i, -1}] = util::delaunay(planarCoords);
+  return true;
+}
 
-    // mesh for interpolated strand particles
-    int crossSectionIdx = 0;
-    for (auto& crossSection : interpolatedCrossSections[i]) {
-      planarCoords.clear();
+Tree::NodeMeshLayout Tree::computeNodeMeshLayout(int nodeId) const {
+  NodeMeshLayout layout;
 
-      for (int j = 0; j < crossSection.getNumParticles(); ++j) {
-        planarCoords.emplace_back(
-            crossSection.particlePositions[j].x, crossSection.particlePositions[j].y
-        );
-      }
+  const auto& crossSections = interpolatedCrossSections.at(nodeId);
 
-      auto triangles = util::delaunay(planarCoords);
-      crossSectionsTriangulations[{i, crossSectionIdx}] = triangles;
-      crossSection.boundaryVertices = util::computeBoundaryVertices(planarCoords, triangles);
+  layout.vertexCount = nodeParticles.at(nodeId).size();
+  layout.triangleCount = crossSectionsTriangulations.at({nodeId, -1}).size();
+  layout.boundaryLookup.resize(crossSections.size());
 
-      crossSectionIdx++;
+  for (int crossIdx = 0; crossIdx < crossSections.size(); ++crossIdx) {
+    const auto& curCrossSection = crossSections[crossIdx];
+
+    // strand id -> position in the boundary loop (first occurrence wins, like a linear search)
+    auto& lookup = layout.boundaryLookup[crossIdx];
+    lookup.reserve(curCrossSection.boundaryVertices.size());
+    for (int i = 0; i < curCrossSection.boundaryVertices.size(); ++i) {
+      lookup.emplace(curCrossSection.particleStrandIds[curCrossSection.boundaryVertices[i]], i);
     }
-  }
-}
 
-/* ---------------------- DISPLAY METHODS ---------------------- */
+    layout.vertexCount += curCrossSection.getNumParticles();
+    layout.triangleCount += crossSectionsTriangulations.at({nodeId, crossIdx}).size();
 
-void Tree::printNodeParticles(int nodeId) const {
-  std::cout << "Particles at node ID: " << nodeId << std::endl;
-  for (auto& particle : nodeParticles.at(nodeId)) {
-    std::cout << *particle << std::endl;
+    // the first cross section connects to the node particles, which have no boundary loop
+    if (crossIdx == 0) continue;
+
+    const auto& previousCrossSection = crossSections[crossIdx - 1];
+    const auto& previousLookup = layout.boundaryLookup[crossIdx - 1];
+    for (int i : curCrossSection.boundaryVertices) {
+      if (previousLookup.count(curCrossSection.particleStrandIds[i])) layout.triangleCount += 2;
+    }
   }
+
+  return layout;
 }
 
-void Tree::initializeStrandBuffers() {
-  for (auto& strand : strands) {
-    strand.initializeGeneralizedCylinder();
+void Tree::fillNodeMesh(
+    int nodeId, const NodeMeshLayout& layout, const MeshRange& range, MeshData& data
+) const {
+  int vertexOffset = range.vertexOffset;
+  int vertexIdx = range.vertexOffset;
+  int triangleIdx = range.triangleOffset;
+
+  // first: node particles (not interpolated)
+  const bool withStrandIds = !data.strandIds.empty();
+
+  const auto& nodeParts = nodeParticles.at(nodeId);
+  for (const auto& particle : nodeParts) {
+    data.vertices[vertexIdx] = particle->pos;
+    data.normals[vertexIdx] = glm::normalize(particle->pos - pg.getNode(nodeId).pos);
+    if (withStrandIds) data.strandIds[vertexIdx] = particle->strandId;
+    ++vertexIdx;
   }
-}
 
-void Tree::renderStrands(const Shader& sh) const {
-  for (auto& strand : strands) {
-    strand.renderStrand(sh);
+  for (const auto& triangle : crossSectionsTriangulations.at({nodeId, -1})) {
+    data.indices[triangleIdx++] = glm::uvec3(vertexOffset) + triangle;
   }
-}
 
-void Tree::renderStrandParticles() const {
-  for (auto& strand : strands) {
-    strand.renderStrandParticles();
+  vertexOffset += nodeParts.size();
+
+  // second: interpolated cross sections
+  const auto& crossSections = interpolatedCrossSections.at(nodeId);
+  for (int crossIdx = 0; crossIdx < crossSections.size(); ++crossIdx) {
+    const auto& curCrossSection = crossSections[crossIdx];
+    const int crossSectionSize = curCrossSection.getNumParticles();
+
+    // add the particle positions to the vertices
+    for (int i = 0; i < crossSectionSize; ++i) {
+      data.vertices[vertexIdx] = curCrossSection.particles[i]->pos;
+      data.normals[vertexIdx] = curCrossSection.particleNormals[i];
+      if (withStrandIds) data.strandIds[vertexIdx] = curCrossSection.particleStrandIds[i];
+      ++vertexIdx;
+    }
+
+    // actual cross section triangulation
+    for (const auto& triangle : crossSectionsTriangulations.at({nodeId, crossIdx})) {
+      data.indices[triangleIdx++] = glm::uvec3(vertexOffset) + triangle;
+    }
+
+    // connect the previous boundary particles with corresponding strand ids
+    // (the first cross section is connected to the node particles, which have no boundary)
+    // @TODO: handle the case of strand not present in the previous cross section boundary
+    if (crossIdx > 0) {
+      const auto& previousCrossSection = crossSections[crossIdx - 1];
+      const auto& previousLookup = layout.boundaryLookup[crossIdx - 1];
+      const int prevOffset = vertexOffset - previousCrossSection.getNumParticles();
+      const int curBoundarySize = curCrossSection.boundaryVertices.size();
+      const int prevBoundarySize = previousCrossSection.boundaryVertices.size();
+
+      for (int b = 0; b < curBoundarySize; ++b) {
+        int i = curCrossSection.boundaryVertices[b];
+
+        auto match = previousLookup.find(curCrossSection.particleStrandIds[i]);
+        if (match == previousLookup.end()) continue;
+
+        int matchingIdx = match->second;
+        int matchingVertex = previousCrossSection.boundaryVertices[matchingIdx];
+        int afterCurrent = curCrossSection.boundaryVertices[(b + 1) % curBoundarySize];
+        int afterMatching =
+            previousCrossSection.boundaryVertices[(matchingIdx + 1) % prevBoundarySize];
+
+        data.indices[triangleIdx++] =
+            glm::uvec3(vertexOffset + i, prevOffset + matchingVertex, prevOffset + afterMatching);
+        data.indices[triangleIdx++] =
+            glm::uvec3(vertexOffset + i, prevOffset + afterMatching, vertexOffset + afterCurrent);
+      }
+    }
+
+    // @TODO: for the last cross section, connect with next node particles with corresponding
+    // strand ids
+
+    vertexOffset += crossSectionSize;
   }
+
+  assert(vertexIdx == range.vertexOffset + range.vertexCount);
+  assert(triangleIdx == range.triangleOffset + range.triangleCount);
 }
 
-// void Tree::renderCoordinateSystems(const Shader& sh) const {
-//   // generate a 2 point spline with each of the coordinate system axes (frontplanes)
-//   for (int i = 0; i < Node::getNodeCount(); ++i) {
-//     const Node& node = pg.getNode(i);
-//     const glm::mat3& frontplane = frontplanes.at(i);
+std::vector<std::vector<glm::uvec3>> Tree::triangulateCrossSections(
+    int nodeId, std::vector<CrossSection>& crossSections
+) const {
+  std::vector<std::vector<glm::uvec3>> triangulations;
+  triangulations.reserve(crossSections.size() + 1);
 
-//     // x-axis
-//     Spline xaxisSpline({node.pos, node.pos + frontplane[0] * 0.5f});
+  // mesh for not interpolated node particles
+  std::vector<glm::vec2> planarCoords;
+  for (auto& particle : nodeParticles.at(nodeId)) {
+    planarCoords.emplace_back(particle->localPos);
+  }
 
-//     // y-axis
-//     Spline yaxisSpline({node.pos, node.pos + frontplane[1] * 0.5f});
+  triangulations.push_back(util::delaunay(planarCoords));
 
-//     // z-axis
-//     Spline zaxisSpline({node.pos, node.pos + frontplane[2] * 0.5f});
+  // mesh for interpolated strand particles
+  for (auto& crossSection : crossSections) {
+    planarCoords.clear();
 
-//     sh.setVec4("color", {1.0f, 0.0f, 0.0f, 1.0f});
-//     xaxisSpline.initializeBuffers();
-//     xaxisSpline.render();
+    for (int j = 0; j < crossSection.getNumParticles(); ++j) {
+      planarCoords.emplace_back(
+          crossSection.particlePositions[j].x, crossSection.particlePositions[j].y
+      );
+    }
 
-//     sh.setVec4("color", {0.0f, 1.0f, 0.0f, 1.0f});
-//     yaxisSpline.initializeBuffers();
-//     yaxisSpline.render();
+    auto triangles = util::delaunay(planarCoords);
+    crossSection.boundaryVertices = util::computeBoundaryVertices(planarCoords, triangles);
+    triangulations.push_back(std::move(triangles));
+  }
 
-//     sh.setVec4("color", {0.0f, 0.0f, 1.0f, 1.0f});
-//     zaxisSpline.initializeBuffers();
-//     zaxisSpline.render();
-//   }
-// }
+  return triangulations;
+}
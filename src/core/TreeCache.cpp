@@ -0,0 +1,372 @@
+#include "core/Tree.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+#include "core/Hash.h"
+#include "simulation/PBD.h"
+
+namespace {
+
+// bumped whenever the format or the strand generation changes (older entries become stale)
+constexpr char STRAND_CACHE_MAGIC[4] = {'S', 'L', 'C', 'F'};
+constexpr std::uint32_t STRAND_CACHE_VERSION = 2;
+
+// the arrays follow, in this order:
+//   vec4 colors[strandCount], int32 strandLengths[strandCount]
+//   int32 nodeParticleOffsets[nodeCount + 1] (particles of every node, in node id order)
+//   int32 particleStrands[particleCount], int32 particleIndices[particleCount] (along the strand)
+//   vec3 localPositions[particleCount] (after pbd), vec3 mergedLayouts[particleCount] (before)
+//   int32 particleWeights[particleCount] (leaf strands of super-strands)
+//   int32 children[childCount] (children of every node, in the order the layouts were merged in)
+struct StrandCacheHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint64_t checksum;  // of the arrays
+  std::uint32_t nodeCount, strandCount, particleCount, childCount;
+};
+
+struct StrandLayout {
+  std::vector<glm::vec4> colors;
+  std::vector<std::int32_t> strandLengths;
+  std::vector<std::int32_t> nodeParticleOffsets;
+  std::vector<std::int32_t> particleStrands, particleIndices;
+  std::vector<glm::vec3> localPositions, mergedLayouts;
+  std::vector<std::int32_t> particleWeights;
+  std::vector<std::int32_t> children;
+
+  // calls fn(data, size in bytes) on every array, in the file order
+  template <typename Fn>
+  void forEachArray(Fn&& fn) {
+    fn(colors.data(), colors.size() * sizeof(glm::vec4));
+    fn(strandLengths.data(), strandLengths.size() * sizeof(std::int32_t));
+    fn(nodeParticleOffsets.data(), nodeParticleOffsets.size() * sizeof(std::int32_t));
+    fn(particleStrands.data(), particleStrands.size() * sizeof(std::int32_t));
+    fn(particleIndices.data(), particleIndices.size() * sizeof(std::int32_t));
+    fn(localPositions.data(), localPositions.size() * sizeof(glm::vec3));
+    fn(mergedLayouts.data(), mergedLayouts.size() * sizeof(glm::vec3));
+    fn(particleWeights.data(), particleWeights.size() * sizeof(std::int32_t));
+    fn(children.data(), children.size() * sizeof(std::int32_t));
+  }
+
+  void resize(const StrandCacheHeader& header) {
+    colors.resize(header.strandCount);
+    strandLengths.resize(header.strandCount);
+    nodeParticleOffsets.resize(header.nodeCount + 1);
+    particleStrands.resize(header.particleCount);
+    particleIndices.resize(header.particleCount);
+    localPositions.resize(header.particleCount);
+    mergedLayouts.resize(header.particleCount);
+    particleWeights.resize(header.particleCount);
+    children.resize(header.childCount);
+  }
+
+  std::uint64_t computeChecksum() {
+    std::uint64_t checksum = HASH_SEED;
+    forEachArray([&](const void* data, std::size_t size) {
+      checksum = hashBytes(data, size, checksum);
+    });
+    return checksum;
+  }
+};
+
+std::string getCachePath(const std::string& cacheDir, std::uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.strands", static_cast<unsigned long long>(key));
+
+  return (std::filesystem::path(cacheDir) / name).string();
+}
+
+// unique among the processes (batch workers, servers) and threads writing to the same directory
+std::string getTempPath(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+  const long pid = getpid();
+#else
+  const long pid = _getpid();
+#endif
+  const std::size_t thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+  return path + ".tmp" + std::to_string(pid) + "-" + std::to_string(thread);
+}
+
+}  // namespace
+
+bool Tree::computeStrandsPosition(const std::string& cacheDir) {
+  // the key is computed first: merging the layouts reorders the children of the nodes
+  const std::uint64_t key = computeLayoutKey();
+  const std::string path = getCachePath(cacheDir, key);
+
+  bool loaded = false;
+  if (std::filesystem::exists(path)) {
+    try {
+      loaded = loadStrandLayout(path, key);
+    } catch (const std::runtime_error& e) {
+      std::cerr << "WARNING: Invalid strand cache entry " << path << ": " << e.what() << "\n";
+    }
+  }
+
+  // the cached strands are interpolated again
+  if (loaded) {
+    runStrandTasks(false);
+    return true;
+  }
+
+  computeStrandsPosition();
+
+  // the cache is only an optimization: failing to write it is not an error
+  try {
+    std::filesystem::create_directories(cacheDir);
+    saveStrandLayout(path, key);
+  } catch (const std::exception& e) {
+    std::cerr << "WARNING: Failed to write strand cache entry " << path << ": " << e.what()
+              << "\n";
+  }
+
+  return false;
+}
+
+std::uint64_t Tree::computeLayoutKey() const {
+  std::uint64_t hash = hashValue(STRAND_CACHE_VERSION);
+
+  // generation parameters
+  hash = hashValue(seed, hash);
+  hash = hashValue(NUM_STRANDS_PER_LEAF, hash);
+  hash = hashValue(STRAND_RADIUS, hash);
+  hash = hashValue(NODE_STRAND_AREA_RADIUS, hash);
+  hash = hashValue(GAMMA_ATTRACTION, hash);
+  hash = hashValue(SOLVER_INTERATIONS, hash);
+  hash = hashValue(MULTILEVEL_PBD_POINTS, hash);
+  hash = hashValue(MULTILEVEL_CLUSTER_POINTS, hash);
+  hash = hashValue(MULTILEVEL_MIN_ITERATIONS, hash);
+  hash = hashValue(MULTILEVEL_POLISH_ITERATIONS, hash);
+  hash = hashValue(MULTILEVEL_CLUSTER_PACKING, hash);
+  hash = hashValue(maxNodeStrands, hash);
+
+  // plant graph (children order included: it decides how the layouts are merged)
+  hash = hashValue(pg.getNodeCount(), hash);
+  for (const Node& node : pg.nodes) {
+    hash = hashValue(node.parentId, hash);
+    hash = hashValue(node.pos, hash);
+    hash = hashValue(node.radius, hash);
+
+    const auto children = pg.getChildren(node.id);
+    hash = hashBytes(children.begin(), children.size() * sizeof(int), hash);
+  }
+
+  return hash;
+}
+
+// returns false if the entry is stale (written for another key or version), throws if it is
+// corrupted. the tree is only modified once the whole entry was validated
+bool Tree::loadStrandLayout(const std::string& path, std::uint64_t key) {
+  // the tree copies everything it reads: a plain read, straight into the arrays
+  std::ifstream file(path, std::ios::binary);
+  if (!file) throw std::runtime_error("failed to open");
+  const std::uintmax_t fileSize = std::filesystem::file_size(path);
+
+  StrandCacheHeader header;
+  if (fileSize < sizeof(header)) throw std::runtime_error("truncated header");
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  if (std::memcmp(header.magic, STRAND_CACHE_MAGIC, sizeof(STRAND_CACHE_MAGIC)) != 0)
+    throw std::runtime_error("not a strand cache file");
+  if (header.version != STRAND_CACHE_VERSION || header.key != key) return false;
+
+  const int nodeCount = pg.getNodeCount();
+  const int childCount = pg.getChildCount();
+
+  if (header.nodeCount != nodeCount || header.childCount != childCount) return false;
+
+  // arrays, checked against the checksum before anything else
+  StrandLayout layout;
+  layout.resize(header);
+
+  std::size_t expectedSize = sizeof(header);
+  layout.forEachArray([&](const void*, std::size_t size) { expectedSize += size; });
+  if (fileSize != expectedSize) throw std::runtime_error("unexpected file size");
+
+  layout.forEachArray([&](void* data, std::size_t size) {
+    file.read(static_cast<char*>(data), size);
+  });
+  if (!file) throw std::runtime_error("failed to read");
+
+  if (layout.computeChecksum() != header.checksum) throw std::runtime_error("checksum mismatch");
+
+  // consistency of the indices
+  const int strandCount = header.strandCount, particleCount = header.particleCount;
+  auto fail = [](const char* what) { throw std::runtime_error(what); };
+
+  std::vector<int> strandOffsets(strandCount + 1, 0);
+  for (int s = 0; s < strandCount; ++s) {
+    if (layout.strandLengths[s] <= 0) fail("empty strand");
+    strandOffsets[s + 1] = strandOffsets[s] + layout.strandLengths[s];
+  }
+  if (strandOffsets[strandCount] != particleCount) fail("strand lengths mismatch");
+
+  const auto& offsets = layout.nodeParticleOffsets;
+  if (offsets[0] != 0 || offsets[nodeCount] != particleCount ||
+      !std::is_sorted(offsets.begin(), offsets.end())) {
+    fail("node particles mismatch");
+  }
+
+  std::vector<int> particleNodes(particleCount);
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    std::fill(
+        particleNodes.begin() + offsets[nodeId], particleNodes.begin() + offsets[nodeId + 1], nodeId
+    );
+  }
+
+  // every particle of every strand appears exactly once
+  std::vector<int> strandSlots(particleCount, -1);
+  for (int k = 0; k < particleCount; ++k) {
+    const int s = layout.particleStrands[k], i = layout.particleIndices[k];
+    if (s < 0 || s >= strandCount || i < 0 || i >= layout.strandLengths[s])
+      fail("particle out of range");
+    if (layout.particleWeights[k] <= 0) fail("invalid particle weight");
+
+    int& slot = strandSlots[strandOffsets[s] + i];
+    if (slot != -1) fail("duplicate particle");
+    slot = k;
+  }
+
+  // same children as the graph, possibly in another order
+  for (int nodeId = 0, c = 0; nodeId < nodeCount; ++nodeId) {
+    const auto children = pg.getChildren(nodeId);
+    if (!std::is_permutation(children.begin(), children.end(), layout.children.begin() + c))
+      fail("children mismatch");
+    c += children.size();
+  }
+
+  // rebuild the strands, then the node particles
+  for (int nodeId = 0, c = 0; nodeId < nodeCount; ++nodeId) {
+    auto children = pg.getChildren(nodeId);
+    std::copy_n(layout.children.begin() + c, children.size(), children.begin());
+    c += children.size();
+  }
+
+  computeCoordinateSystems();
+
+  strands.clear();
+  strands.reserve(strandCount);
+  for (int s = 0; s < strandCount; ++s) strands.emplace_back(s, layout.colors[s]);
+  bundledStrands.assign(strandCount, {});  // not stored
+
+  std::vector<std::shared_ptr<StrandParticle>> particles(particleCount);
+  for (int s = 0; s < strandCount; ++s) {
+    for (int slot = strandOffsets[s]; slot < strandOffsets[s + 1]; ++slot) {
+      const int k = strandSlots[slot];
+      const int nodeId = particleNodes[k];
+      const glm::vec3& localPos = layout.localPositions[k];
+
+      particles[k] = strands[s].addParticle(
+          pg.getNode(nodeId).pos + frontplanes[nodeId] * localPos, localPos, nodeId
+      );
+      particles[k]->weight = layout.particleWeights[k];
+    }
+  }
+
+  nodeParticles.clear();
+  mergedLayouts.clear();
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    if (offsets[nodeId] == offsets[nodeId + 1]) continue;
+
+    nodeParticles[nodeId].assign(
+        particles.begin() + offsets[nodeId], particles.begin() + offsets[nodeId + 1]
+    );
+    mergedLayouts[nodeId].assign(
+        layout.mergedLayouts.begin() + offsets[nodeId],
+        layout.mergedLayouts.begin() + offsets[nodeId + 1]
+    );
+  }
+
+  pg.clearDirtyNodes();  // everything is up to date
+
+  return true;
+}
+
+void Tree::saveStrandLayout(const std::string& path, std::uint64_t key) const {
+  StrandLayout layout;
+
+  // index of every node particle along its strand (the interpolated ones are computed again)
+  std::unordered_map<const StrandParticle*, int> particleIndices;
+  for (const Strand& strand : strands) {
+    int length = 0;
+    for (const auto& particle : strand.getParticles()) {
+      if (!particle->interpolated) particleIndices[particle.get()] = length++;
+    }
+
+    layout.colors.push_back(strand.getColor());
+    layout.strandLengths.push_back(length);
+  }
+
+  layout.nodeParticleOffsets.push_back(0);
+  for (int nodeId = 0; nodeId < pg.getNodeCount(); ++nodeId) {
+    auto particles = nodeParticles.find(nodeId);
+    auto merged = mergedLayouts.find(nodeId);
+
+    if (particles != nodeParticles.end()) {
+      for (int j = 0; j < particles->second.size(); ++j) {
+        const StrandParticle* particle = particles->second[j].get();
+
+        layout.particleStrands.push_back(particle->strandId);
+        layout.particleIndices.push_back(particleIndices.at(particle));
+        layout.localPositions.push_back(particle->localPos);
+        layout.mergedLayouts.push_back(merged->second[j]);
+        layout.particleWeights.push_back(particle->weight);
+      }
+    }
+
+    layout.nodeParticleOffsets.push_back(layout.particleStrands.size());
+
+    const auto children = pg.getChildren(nodeId);
+    layout.children.insert(layout.children.end(), children.begin(), children.end());
+  }
+
+  StrandCacheHeader header{};
+  std::memcpy(header.magic, STRAND_CACHE_MAGIC, sizeof(STRAND_CACHE_MAGIC));
+  header.version = STRAND_CACHE_VERSION;
+  header.key = key;
+  header.checksum = layout.computeChecksum();
+  header.nodeCount = pg.getNodeCount();
+  header.strandCount = layout.colors.size();
+  header.particleCount = layout.particleStrands.size();
+  header.childCount = layout.children.size();
+
+  // written next to the entry, then renamed over it: readers never see a partial file
+  const std::string tempPath = getTempPath(path);
+
+  try {
+    {
+      std::ofstream file(tempPath, std::ios::binary);
+      if (!file) throw std::runtime_error("failed to open " + tempPath);
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      layout.forEachArray([&](const void* data, std::size_t size) {
+        file.write(static_cast<const char*>(data), size);
+      });
+
+      if (!file) throw std::runtime_error("failed to write " + tempPath);
+    }
+
+    std::filesystem::rename(tempPath, path);
+  } catch (...) {
+    std::error_code error;  // (the entry is not written anyway)
+    std::filesystem::remove(tempPath, error);
+    throw;
+  }
+}
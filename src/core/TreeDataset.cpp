@@ -0,0 +1,223 @@
+#include "core/Tree.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "core/Color.h"
+
+StrandDatasetTreeData Tree::generateStrandData() const {
+  StrandDatasetTreeData data;
+
+  // plant graph
+  const int nodeCount = pg.getNodeCount();
+  for (const Node& node : pg.nodes) {
+    data.nodeParents.push_back(node.parentId);
+    data.nodePositions.push_back(node.pos);
+
+    const auto children = pg.getChildren(node.id);
+    data.nodeChildren.insert(data.nodeChildren.end(), children.begin(), children.end());
+  }
+
+  // strand curves, and the point of every particle
+  std::unordered_map<const StrandParticle*, std::uint32_t> particlePoints;
+  for (const Strand& strand : strands) {
+    for (const auto& particle : strand.getParticles()) {
+      particlePoints[particle.get()] = data.points.size();
+      data.points.push_back(particle->pos);
+    }
+
+    data.strandLengths.push_back(strand.getParticles().size());
+    data.strandColors.push_back(packColor(strand.getColor()));
+  }
+
+  // node particles
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    auto particles = nodeParticles.find(nodeId);
+    if (particles == nodeParticles.end()) {
+      data.nodeParticleCounts.push_back(0);
+      continue;
+    }
+
+    for (const auto& particle : particles->second) {
+      data.nodeParticlePoints.push_back(particlePoints.at(particle.get()));
+      data.nodeParticleStrands.push_back(particle->strandId);
+      data.nodeParticleLocalPositions.push_back(particle->localPos);
+      data.nodeParticleWeights.push_back(particle->weight);
+    }
+    data.nodeParticleCounts.push_back(particles->second.size());
+  }
+
+  return data;
+}
+
+void Tree::loadStrands(const StrandDatasetTree& layout) {
+  auto fail = [](const char* what) {
+    throw std::runtime_error(std::string("Strand dataset tree mismatch: ") + what);
+  };
+
+  const int nodeCount = pg.getNodeCount();
+  if (layout.getNodeCount() != nodeCount) fail("node count");
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    if (layout.getNodeParent(nodeId) != pg.getNode(nodeId).parentId) fail("node parents");
+  }
+
+  // node particles, by point (checked before the tree is modified)
+  const int strandCount = layout.getStrandCount();
+  const std::size_t pointCount = layout.getPointCount();
+
+  struct PointParticle {
+    int nodeId{-1}, index{-1};  // in the node particles
+  };
+  std::vector<PointParticle> pointParticles(pointCount);
+
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    const StrandDatasetNodeParticles particles = layout.getNodeParticles(nodeId);
+    for (int i = 0; i < particles.points.size(); ++i) {
+      const std::uint32_t point = particles.points[i];
+      const int strandId = particles.strands[i];
+      if (point >= pointCount || pointParticles[point].nodeId != -1) fail("node particle points");
+      if (strandId < 0 || strandId >= strandCount) fail("node particle strands");
+      if (!particles.weights.empty() && particles.weights[i] <= 0) fail("node particle weights");
+
+      pointParticles[point] = {nodeId, i};
+    }
+  }
+
+  // the strands cover all the points, in order, and own their node particles
+  std::size_t covered = 0;
+  for (int s = 0; s < strandCount; ++s) {
+    const std::size_t first = layout.getStrandFirstPoint(s);
+    if (first != covered) fail("strand offsets");
+    covered = first + layout.getStrandPoints(s).size();
+
+    for (std::size_t point = first; point < covered; ++point) {
+      const PointParticle& particle = pointParticles[point];
+      if (particle.nodeId != -1 &&
+          layout.getNodeParticles(particle.nodeId).strands[particle.index] != s) {
+        fail("node particle strands");
+      }
+    }
+  }
+  if (covered != pointCount) fail("strand offsets");
+
+  // the points between two node particles of a strand are the interpolated particles of the branch
+  // segment from the first node (the child) to its parent, whose samples all its strands share
+  std::vector<int> segmentSamples(nodeCount, 0);
+  for (int s = 0; s < strandCount; ++s) {
+    const std::size_t first = layout.getStrandFirstPoint(s);
+    const std::size_t end = first + layout.getStrandPoints(s).size();
+    if (first == end || pointParticles[first].nodeId == -1 || pointParticles[end - 1].nodeId == -1)
+      fail("strand ends");
+
+    for (std::size_t point = first + 1, child = first; point < end; ++point) {
+      const int nodeId = pointParticles[point].nodeId;
+      if (nodeId == -1) continue;
+
+      const int childId = pointParticles[child].nodeId;
+      if (pg.getNode(childId).parentId != nodeId) fail("strand nodes");
+
+      const int samples = point - child;
+      if (segmentSamples[childId] != 0 && segmentSamples[childId] != samples)
+        fail("segment samples");
+      segmentSamples[childId] = samples;
+      child = point;
+    }
+  }
+
+  // children, in the order their layouts were merged in
+  const ArrayView<std::int32_t> children = layout.getNodeChildren();
+  for (int nodeId = 0, c = 0; nodeId < nodeCount; ++nodeId) {
+    const auto graphChildren = pg.getChildren(nodeId);
+    if (!std::is_permutation(graphChildren.begin(), graphChildren.end(), children.begin() + c))
+      fail("children");
+    c += graphChildren.size();
+  }
+
+  for (int nodeId = 0, c = 0; nodeId < nodeCount; ++nodeId) {
+    auto graphChildren = pg.getChildren(nodeId);
+    std::copy_n(children.begin() + c, graphChildren.size(), graphChildren.begin());
+    c += graphChildren.size();
+  }
+
+  computeCoordinateSystems();
+
+  // strands with their node particles first
+  strands.clear();
+  strands.reserve(strandCount);
+  nodeParticles.clear();
+  mergedLayouts.clear();
+  bundledStrands.assign(strandCount, {});
+
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    const std::size_t count = layout.getNodeParticles(nodeId).points.size();
+    if (count > 0) nodeParticles[nodeId].resize(count);
+  }
+
+  const ArrayView<glm::vec3> points = layout.getPoints();
+  for (int s = 0; s < strandCount; ++s) {
+    strands.emplace_back(s, layout.getStrandColor(s));
+
+    const std::size_t first = layout.getStrandFirstPoint(s);
+    const std::size_t end = first + layout.getStrandPoints(s).size();
+    for (std::size_t point = first; point < end; ++point) {
+      const PointParticle& particle = pointParticles[point];
+      if (particle.nodeId == -1) continue;
+
+      const StrandDatasetNodeParticles layoutParticles = layout.getNodeParticles(particle.nodeId);
+      auto& nodeParticle = nodeParticles[particle.nodeId][particle.index];
+      nodeParticle = strands[s].addParticle(
+          points[point], layoutParticles.localPositions[particle.index], particle.nodeId
+      );
+      if (!layoutParticles.weights.empty())
+        nodeParticle->weight = layoutParticles.weights[particle.index];
+    }
+  }
+
+  // then the segments, with the stored interpolated points (strand after strand, so that the
+  // offsets are sorted by strand id)
+  segmentParticles.clear();
+  interpolatedCrossSections.clear();
+  crossSectionsTriangulations.clear();
+
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    nodeParticles.try_emplace(nodeId);
+    mergedLayouts.try_emplace(nodeId);
+    if (pg.getNode(nodeId).isRoot()) continue;
+
+    SegmentParticles& segment = segmentParticles[nodeId];
+    if (segmentSamples[nodeId] > 0) segment.samples = segmentSamples[nodeId];
+    segment.particles = std::make_shared<std::vector<StrandParticle>>();
+  }
+
+  for (int s = 0; s < strandCount; ++s) {
+    const auto& particles = strands[s].getParticles();
+    std::size_t point = layout.getStrandFirstPoint(s);
+
+    for (int i = 0; i + 1 < particles.size(); ++i) {
+      SegmentParticles& segment = segmentParticles.at(particles[i]->nodeId);
+      const StrandParticle& end = *particles[i + 1];
+
+      segment.strandOffsets.emplace_back(s, segment.particles->size());
+      for (int k = 1; k < segment.samples; ++k) {
+        segment.particles->emplace_back(s, points[point + k], glm::vec3(0.0f), true, end.nodeId);
+        segment.particles->back().weight = end.weight;
+      }
+      point += segment.samples;
+    }
+  }
+
+  // (once the segments are complete: the strands hold aliases of their particles)
+  for (int s = 0; s < strandCount; ++s) spliceSegmentParticles(s);
+
+  if (eagerCrossSections) {
+    std::vector<int> nodeIds(nodeCount);
+    std::iota(nodeIds.begin(), nodeIds.end(), 0);
+    computeBranchSegments(nodeIds);
+  }
+
+  pg.clearDirtyNodes();  // everything is up to date
+}
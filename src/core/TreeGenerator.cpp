@@ -0,0 +1,110 @@
+#include "core/TreeGenerator.h"
+
+#include <chrono>
+
+namespace {
+
+// the worker checks for requests at least this often, in case it missed a notification
+constexpr auto WORKER_WAKE_INTERVAL = std::chrono::milliseconds(10);
+
+}  // namespace
+
+TreeGenerator::~TreeGenerator() {
+  stopping = true;
+  wake.notify_one();
+  worker.join();
+}
+
+bool TreeGenerator::request(const PlantGraph& graph) {
+  if (!requests.push(std::make_unique<PlantGraph>(graph))) return false;
+
+  pendingRequests++;
+  wake.notify_one();
+
+  return true;
+}
+
+bool TreeGenerator::requestMesh(std::shared_ptr<GeneratedTree> generated) {
+  if (!meshRequests.push(std::move(generated))) return false;
+
+  pendingMeshes++;
+  wake.notify_one();
+
+  return true;
+}
+
+void TreeGenerator::run() {
+  while (!stopping) {
+    // meshes first: their trees are already drawn
+    for (std::shared_ptr<GeneratedTree> generated; meshRequests.pop(generated);) {
+      generateMesh(*generated);
+
+      while (!stopping && !meshResults.push(std::move(generated))) {
+        std::this_thread::sleep_for(WORKER_WAKE_INTERVAL);
+      }
+
+      pendingMeshes--;
+    }
+
+    // latest request only: the older ones are outdated
+    std::unique_ptr<PlantGraph> graph;
+    int nRequests = 0;
+    for (std::unique_ptr<PlantGraph> next; requests.pop(next); ++nRequests) graph = std::move(next);
+
+    if (!graph) {
+      std::unique_lock<std::mutex> lock(wakeMutex);
+      wake.wait_for(lock, WORKER_WAKE_INTERVAL, [this]() {
+        return stopping || !requests.isEmpty() || !meshRequests.isEmpty();
+      });
+      continue;
+    }
+
+    std::unique_ptr<GeneratedTree> result = generate(std::move(graph));
+
+    // wait for the render thread to take the previous results
+    while (!stopping && !results.push(std::move(result))) {
+      std::this_thread::sleep_for(WORKER_WAKE_INTERVAL);
+    }
+
+    pendingRequests -= nRequests;
+  }
+}
+
+std::unique_ptr<GeneratedTree> TreeGenerator::generate(std::unique_ptr<PlantGraph> graph) const {
+  auto start = std::chrono::steady_clock::now();
+
+  auto result = std::make_unique<GeneratedTree>();
+  result->graph = std::move(graph);
+  result->tree = std::make_unique<Tree>(*result->graph);
+
+  Tree& tree = *result->tree;
+  tree.setSeed(options.seed);
+  tree.setStrandBundling(options.maxNodeStrands);
+  tree.setAdaptiveSampling(options.chordTolerance);
+
+  const bool withMesh = meshWanted;
+  tree.setEagerCrossSections(withMesh);
+
+  if (options.cacheDir.empty())
+    tree.computeStrandsPosition();
+  else
+    result->cached = tree.computeStrandsPosition(options.cacheDir);
+
+  if (withMesh) generateMesh(*result);
+
+  // cpu side of the gpu buffers: the render thread only uploads them
+  tree.prepareStrandTubes();
+  tree.buildBoundingHierarchy();
+
+  result->graph->clearDirtyNodes();
+
+  std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+  result->seconds = elapsed.count();
+
+  return result;
+}
+
+void TreeGenerator::generateMesh(GeneratedTree& generated) const {
+  generated.meshLODs = generated.tree->generateMeshLODs();
+  generated.hasMesh = true;
+}
@@ -0,0 +1,268 @@
+#include "core/Tree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "core/Parallel.h"
+#include "geometry/util.h"
+
+// closed boundary loop of the strands of a branch segment at some point along it
+struct Tree::Ring {
+  std::vector<glm::vec3> positions{};  // counterclockwise around the segment direction
+  glm::vec3 centroid{0.0f};
+  float radius{};  // mean distance of the positions to the centroid
+};
+
+namespace {
+
+float distanceToSegment(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+  glm::vec3 ab = b - a;
+  float len2 = glm::dot(ab, ab);
+  float t = len2 > 0.0f ? glm::clamp(glm::dot(p - a, ab) / len2, 0.0f, 1.0f) : 0.0f;
+
+  return glm::distance(p, a + t * ab);
+}
+
+// mesh of one branch segment at one level of detail (indices local to the chunk)
+struct LODChunk {
+  MeshData data{};
+  float error{};
+};
+
+}  // namespace
+
+std::vector<Tree::Ring> Tree::computeBranchSegmentRings(int branchStartNode, int childIdx) const {
+  const int childId = pg.getChildren(branchStartNode)[childIdx];
+  const glm::vec3 dir =
+      glm::normalize(pg.getNode(branchStartNode).pos - pg.getNode(childId).pos);
+
+  // boundary loop of a set of positions, given their planar coordinates
+  auto makeRing = [&](const std::vector<glm::vec3>& positions,
+                      const std::vector<glm::vec2>& planar, std::vector<int> boundary) {
+    Ring ring;
+
+    if (boundary.size() < 3) {
+      // degenerate triangulation: use all the positions in angular order
+      boundary.resize(planar.size());
+      for (int i = 0; i < boundary.size(); ++i) boundary[i] = i;
+
+      glm::vec2 center{0.0f};
+      for (const auto& p : planar) center += p;
+      center /= static_cast<float>(planar.size());
+
+      std::sort(boundary.begin(), boundary.end(), [&](int a, int b) {
+        glm::vec2 da = planar[a] - center, db = planar[b] - center;
+        return std::atan2(da.y, da.x) < std::atan2(db.y, db.x);
+      });
+    }
+
+    for (int i : boundary) ring.positions.push_back(positions[i]);
+    for (const auto& p : ring.positions) ring.centroid += p;
+    ring.centroid /= static_cast<float>(ring.positions.size());
+
+    for (const auto& p : ring.positions) ring.radius += glm::distance(p, ring.centroid);
+    ring.radius /= ring.positions.size();
+
+    // newell's normal of the loop gives its orientation
+    glm::vec3 normal{0.0f};
+    for (int i = 0; i < ring.positions.size(); ++i) {
+      normal += glm::cross(ring.positions[i], ring.positions[(i + 1) % ring.positions.size()]);
+    }
+    if (glm::dot(normal, dir) < 0.0f) std::reverse(ring.positions.begin(), ring.positions.end());
+
+    return ring;
+  };
+
+  std::vector<Ring> rings;
+  const auto& childParticles = nodeParticles.at(childId);
+  const int nSamples = getSegmentSamples(childId);
+
+  // ring at the child node: boundary of its own triangulation
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> planar;
+  for (const auto& particle : childParticles) {
+    positions.push_back(particle->pos);
+    planar.emplace_back(particle->localPos);
+  }
+
+  rings.push_back(makeRing(
+      positions, planar,
+      util::computeBoundaryVertices(planar, crossSectionsTriangulations.at({childId, -1}))
+  ));
+
+  // rings at the interpolated cross sections of this child (stored after the previous children)
+  int firstCrossSection = 0;
+  for (int i = 0; i < childIdx; ++i) {
+    firstCrossSection += getSegmentSamples(pg.getChildren(branchStartNode)[i]) - 1;
+  }
+
+  const auto& crossSections = interpolatedCrossSections.at(branchStartNode);
+  for (int k = firstCrossSection; k < firstCrossSection + nSamples - 1; ++k) {
+    const CrossSection& crossSection = crossSections[k];
+
+    positions.clear();
+    planar.clear();
+    for (int j = 0; j < crossSection.getNumParticles(); ++j) {
+      positions.push_back(crossSection.particles[j]->pos);
+      planar.emplace_back(crossSection.particlePositions[j]);
+    }
+
+    rings.push_back(makeRing(positions, planar, crossSection.boundaryVertices));
+  }
+
+  // ring at the branch start node, with only the strands coming from this child (and going on)
+  std::unordered_map<int, const StrandParticle*> startParticles;
+  for (const auto& particle : nodeParticles.at(branchStartNode)) {
+    startParticles[particle->strandId] = particle.get();
+  }
+
+  positions.clear();
+  planar.clear();
+  for (const auto& particle : childParticles) {
+    auto startParticle = startParticles.find(particle->strandId);
+    if (startParticle == startParticles.end()) continue;
+
+    positions.push_back(startParticle->second->pos);
+    planar.emplace_back(startParticle->second->localPos);
+  }
+
+  std::vector<int> boundary;
+  if (planar.size() >= 3) boundary = util::computeBoundaryVertices(planar, util::delaunay(planar));
+  rings.push_back(makeRing(positions, planar, boundary));
+
+  return rings;
+}
+
+std::vector<MeshLOD> Tree::generateMeshLODs() {
+  std::vector<MeshLOD> lods;
+  lods.reserve(NUM_MESH_LOD_LEVELS + 1);
+  lods.push_back({generateMeshData(), 0.0f});
+
+  // the rings of every branch segment are computed once and shared by all the levels
+  std::vector<std::pair<int, int>> segments;  // (branch start node, child index)
+  for (int nodeId = 0; nodeId < pg.getNodeCount(); ++nodeId) {
+    for (int i = 0; i < pg.getChildren(nodeId).size(); ++i) segments.emplace_back(nodeId, i);
+  }
+
+  std::vector<std::vector<Ring>> segmentRings(segments.size());
+  parallel::forRange(0, segments.size(), [&](int s) {
+    segmentRings[s] = computeBranchSegmentRings(segments[s].first, segments[s].second);
+  });
+
+  for (const LODLevel& level : MESH_LOD_LEVELS) {
+    std::vector<LODChunk> chunks(segments.size());
+
+    parallel::forRange(0, segments.size(), [&](int s) {
+      const auto& [branchStartNode, childIdx] = segments[s];
+      const int childId = pg.getChildren(branchStartNode)[childIdx];
+      const std::vector<Ring>& rings = segmentRings[s];
+      const int last = rings.size() - 1;
+
+      LODChunk& chunk = chunks[s];
+
+      // rings kept at this level (the ones at both nodes are always kept)
+      std::vector<int> kept{0};
+      for (int r = level.crossSectionStride; level.crossSectionStride > 0 && r < last;
+           r += level.crossSectionStride) {
+        kept.push_back(r);
+      }
+      kept.push_back(last);
+
+      // error of the skipped rings, against the interpolation of the kept ones around them
+      for (int k = 0; k + 1 < kept.size(); ++k) {
+        const Ring& a = rings[kept[k]];
+        const Ring& b = rings[kept[k + 1]];
+
+        for (int r = kept[k] + 1; r < kept[k + 1]; ++r) {
+          float u = static_cast<float>(r - kept[k]) / (kept[k + 1] - kept[k]);
+          float error = glm::distance(rings[r].centroid, glm::mix(a.centroid, b.centroid, u)) +
+                        std::abs(rings[r].radius - glm::mix(a.radius, b.radius, u));
+          chunk.error = std::max(chunk.error, error);
+        }
+      }
+
+      // coarser rings on thin branches (at least a triangle is kept)
+      bool thin = nodeParticles.at(childId).size() <= LOD_THIN_BRANCH_STRANDS;
+
+      std::vector<std::pair<int, int>> ringRanges;  // (vertex offset, size) of the kept rings
+      for (int r : kept) {
+        const Ring& ring = rings[r];
+        const int ringSize = ring.positions.size();
+        const int stride = thin ? std::max(1, std::min(level.thinRingStride, ringSize / 3)) : 1;
+
+        ringRanges.emplace_back(chunk.data.vertices.size(), 0);
+        for (int i = 0; i < ringSize; i += stride) {
+          chunk.data.vertices.push_back(ring.positions[i]);
+          chunk.data.normals.push_back(glm::normalize(ring.positions[i] - ring.centroid));
+          ringRanges.back().second++;
+
+          // chord error of the dropped vertices
+          const glm::vec3& next = ring.positions[std::min(i + stride, ringSize) % ringSize];
+          for (int j = i + 1; j < std::min(i + stride, ringSize); ++j) {
+            float error = distanceToSegment(ring.positions[j], ring.positions[i], next);
+            chunk.error = std::max(chunk.error, error);
+          }
+        }
+      }
+
+      // boundary-only tube: bands between consecutive rings
+      for (int k = 0; k + 1 < ringRanges.size(); ++k) {
+        util::stitchRings(
+            chunk.data.vertices, ringRanges[k].first, ringRanges[k].second,
+            ringRanges[k + 1].first, ringRanges[k + 1].second, chunk.data.indices
+        );
+      }
+
+      // close the tube at the tips (leaves) and at the base of the tree
+      auto addCap = [&](const std::pair<int, int>& ringRange, bool facingBack) {
+        auto [offset, size] = ringRange;
+        for (int i = 1; i + 1 < size; ++i) {
+          if (facingBack)
+            chunk.data.indices.emplace_back(offset, offset + i + 1, offset + i);
+          else
+            chunk.data.indices.emplace_back(offset, offset + i, offset + i + 1);
+        }
+      };
+
+      if (pg.getChildren(childId).empty()) addCap(ringRanges.front(), true);
+      if (pg.getNode(branchStartNode).isRoot()) addCap(ringRanges.back(), false);
+    });
+
+    // concatenate the chunks, grouping them by branch start node
+    MeshLOD lod;
+    lod.data.ranges.resize(pg.getNodeCount());
+
+    for (int s = 0; s < segments.size(); ++s) {
+      const LODChunk& chunk = chunks[s];
+      MeshRange& range = lod.data.ranges[segments[s].first];
+
+      if (range.vertexCount == 0 && range.triangleCount == 0) {
+        range.vertexOffset = lod.data.vertices.size();
+        range.triangleOffset = lod.data.indices.size();
+      }
+
+      const glm::uvec3 vertexOffset(lod.data.vertices.size());
+      lod.data.vertices.insert(
+          lod.data.vertices.end(), chunk.data.vertices.begin(), chunk.data.vertices.end()
+      );
+      lod.data.normals.insert(
+          lod.data.normals.end(), chunk.data.normals.begin(), chunk.data.normals.end()
+      );
+      for (const auto& triangle : chunk.data.indices) {
+        lod.data.indices.push_back(vertexOffset + triangle);
+      }
+
+      range.vertexCount += chunk.data.vertices.size();
+      range.triangleCount += chunk.data.indices.size();
+      lod.geometricError = std::max(lod.geometricError, chunk.error);
+    }
+
+    // a coarser level is never more accurate than the previous one
+    lod.geometricError = std::max(lod.geometricError, lods.back().geometricError);
+    lods.push_back(std::move(lod));
+  }
+
+  return lods;
+}
@@ -0,0 +1,612 @@
+#include "core/Tree.h"
+
+#include <algorithm>
+#include <cstddef>  // for offsetof
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "core/Parallel.h"
+#include "core/Strand.h"
+#include "geometry/util.h"
+
+/* ---------------------- DISPLAY METHODS ---------------------- */
+
+void Tree::printNodeParticles(int nodeId) const {
+  std::cout << "Particles at node ID: " << nodeId << std::endl;
+  for (auto& particle : nodeParticles.at(nodeId)) {
+    std::cout << *particle << std::endl;
+  }
+}
+
+void Tree::initializeStrandBuffers() {
+  const int nStrands = strands.size();
+
+  // offsets of every strand in the shared buffers
+  std::vector<unsigned int> vertexOffsets(nStrands + 1, 0);
+  strandIndexOffsets.assign(nStrands + 1, 0);
+  for (int i = 0; i < nStrands; ++i) {
+    vertexOffsets[i + 1] = vertexOffsets[i] + strands[i].getNumCylinderVertices();
+    strandIndexOffsets[i + 1] = strandIndexOffsets[i] + strands[i].getNumCylinderIndices();
+  }
+
+  std::vector<StrandVertex> vertices(vertexOffsets[nStrands]);
+  std::vector<unsigned int> indices(strandIndexOffsets[nStrands]);
+
+  parallel::forRange(0, nStrands, [&](int i) {
+    strands[i].writeGeneralizedCylinder(
+        &vertices[vertexOffsets[i]], &indices[strandIndexOffsets[i]], vertexOffsets[i]
+    );
+  });
+
+  glGenVertexArrays(1, &strandVao);
+  glGenBuffers(1, &strandVbo);
+  glGenBuffers(1, &strandEbo);
+
+  glBindVertexArray(strandVao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, strandVbo);
+  glBufferData(
+      GL_ARRAY_BUFFER, sizeof(StrandVertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW
+  );
+
+  glVertexAttribPointer(
+      0, 3, GL_FLOAT, GL_FALSE, sizeof(StrandVertex), (void*)offsetof(StrandVertex, pos)
+  );
+  glEnableVertexAttribArray(0);
+
+  glVertexAttribPointer(
+      1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StrandVertex), (void*)offsetof(StrandVertex, color)
+  );
+  glEnableVertexAttribArray(1);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, strandEbo);
+  glBufferData(
+      GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(),
+      GL_STATIC_DRAW
+  );
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  if (strandVisibility.size() != nStrands) strandVisibility.assign(nStrands, true);
+  updateVisibleStrandRanges();
+}
+
+void Tree::initializeStrandTubes() {
+  prepareStrandTubes();
+  createStrandTubeBuffers();
+
+  std::size_t budget = std::numeric_limits<std::size_t>::max();
+  uploadStrandTubes(budget);
+}
+
+void Tree::prepareStrandTubes() {
+  const int nStrands = strands.size();
+
+  // offsets of every strand in the particle buffer
+  std::vector<int> particleOffsets(nStrands + 1, 0);
+  for (int i = 0; i < nStrands; ++i) {
+    particleOffsets[i + 1] = particleOffsets[i] + strands[i].getParticles().size();
+  }
+
+  // 3 texels per particle: position (and radius scale), normal and binormal of its frame
+  std::vector<glm::vec4>& particles = tubeParticleData;
+  particles.assign(3 * particleOffsets[nStrands], glm::vec4{});
+
+  parallel::forRange(0, nStrands, [&](int i) {
+    const auto& strandParticles = strands[i].getParticles();
+    const int nParticles = strandParticles.size();
+
+    std::vector<glm::vec3> normals(nParticles), binormals(nParticles);
+    strands[i].computeFrames(normals.data(), binormals.data());
+
+    glm::vec4* texels = &particles[3 * particleOffsets[i]];
+    for (int p = 0; p < nParticles; ++p) {
+      // w: scale of the tube radius (super-strands are thicker)
+      const float radiusScale = strandParticles[p]->getRadius() / STRAND_RADIUS;
+      *texels++ = glm::vec4(strandParticles[p]->pos, radiusScale);
+      *texels++ = glm::vec4(normals[p], 0.0f);
+      *texels++ = glm::vec4(binormals[p], 0.0f);
+    }
+  });
+
+  // the segment (p, p + 1) of a strand belongs to the branch segment starting at the node of
+  // particle p + 1. runs first hold the first particle of their segments
+  nodeTubeRuns.assign(pg.getNodeCount(), {});
+  for (int i = 0; i < nStrands; ++i) {
+    const auto& strandParticles = strands[i].getParticles();
+
+    for (int p = 0; p + 1 < strandParticles.size(); ++p) {
+      auto& runs = nodeTubeRuns[strandParticles[p + 1]->nodeId];
+      if (runs.empty() || runs.back().strandId != i) runs.push_back({i, particleOffsets[i] + p, 0});
+      runs.back().count++;
+    }
+  }
+
+  orderStrandTubeRuns();
+
+  std::vector<StrandTubeInstance>& instances = tubeInstanceData;
+  instances.clear();
+  instances.reserve(particleOffsets[nStrands]);
+
+  for (auto& runs : nodeTubeRuns) {
+    for (TubeRun& run : runs) {
+      const glm::vec4& color = strands[run.strandId].getColor();
+
+      StrandTubeInstance instance;
+      for (int c = 0; c < 4; ++c) instance.color[c] = static_cast<unsigned char>(color[c] * 255.0f);
+
+      const int firstParticle = run.first;
+      run.first = instances.size();
+
+      for (int k = 0; k < run.count; ++k) {
+        instance.particle = firstParticle + k;
+        instances.push_back(instance);
+      }
+    }
+  }
+
+  if (strandVisibility.size() != nStrands) strandVisibility.assign(nStrands, true);
+  updateVisibleStrandRanges();
+}
+
+// boundary strands of every branch segment come first (they keep the silhouette), then the
+// interior ones in bit-reversed order, so that any prefix of them is spread over the cross section
+void Tree::orderStrandTubeRuns() {
+  nodeBoundaryRuns.assign(nodeTubeRuns.size(), 0);
+
+  for (int nodeId = 0; nodeId < nodeTubeRuns.size(); ++nodeId) {
+    auto& runs = nodeTubeRuns[nodeId];
+    if (runs.empty()) continue;
+
+    // without a proper triangulation, every strand is on the boundary. the node particles are
+    // triangulated here if the branch segment isn't computed (see Tree::computeBranchSegments)
+    std::set<int> boundaryStrands;
+    auto particles = nodeParticles.find(nodeId);
+
+    if (particles != nodeParticles.end()) {
+      std::vector<glm::vec2> planar;
+      for (const auto& particle : particles->second) planar.emplace_back(particle->localPos);
+
+      std::vector<glm::uvec3> triangles;
+      auto triangulation = crossSectionsTriangulations.find({nodeId, -1});
+      if (triangulation != crossSectionsTriangulations.end())
+        triangles = triangulation->second;
+      else if (planar.size() >= 3)
+        triangles = util::delaunay(planar);
+
+      if (!triangles.empty()) {
+        for (int i : util::computeBoundaryVertices(planar, triangles)) {
+          boundaryStrands.insert(particles->second[i]->strandId);
+        }
+      }
+    }
+
+    auto boundaryEnd = std::stable_partition(runs.begin(), runs.end(), [&](const TubeRun& run) {
+      return boundaryStrands.empty() || boundaryStrands.count(run.strandId) > 0;
+    });
+    nodeBoundaryRuns[nodeId] = boundaryEnd - runs.begin();
+
+    const int nInterior = runs.end() - boundaryEnd;
+    int bits = 0;
+    while ((1 << bits) < nInterior) ++bits;
+
+    auto reverseBits = [bits](int k) {
+      int reversed = 0;
+      for (int b = 0; b < bits; ++b) reversed |= ((k >> b) & 1) << (bits - 1 - b);
+      return reversed;
+    };
+
+    std::vector<TubeRun> interior(boundaryEnd, runs.end());
+    std::vector<int> order(nInterior);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return reverseBits(a) < reverseBits(b);
+    });
+    for (int k = 0; k < nInterior; ++k) *(boundaryEnd + k) = interior[order[k]];
+  }
+}
+
+void Tree::createStrandTubeBuffers() {
+  // buffers are allocated now and filled by uploadStrandTubes
+  glGenBuffers(1, &particleBuffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, particleBuffer);
+  glBufferData(
+      GL_TEXTURE_BUFFER, sizeof(glm::vec4) * tubeParticleData.size(), nullptr, GL_STATIC_DRAW
+  );
+
+  glGenTextures(1, &particleTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, particleTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, particleBuffer);
+
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+  glGenVertexArrays(1, &tubeVao);
+  glGenBuffers(1, &tubeInstanceVbo);
+
+  glBindVertexArray(tubeVao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, tubeInstanceVbo);
+  glBufferData(
+      GL_ARRAY_BUFFER, sizeof(StrandTubeInstance) * tubeInstanceData.size(), nullptr,
+      GL_STATIC_DRAW
+  );
+
+  // the instance attributes are pointed at the first visible instance before each draw
+  glEnableVertexAttribArray(0);
+  glVertexAttribDivisor(0, 1);
+  glEnableVertexAttribArray(1);
+  glVertexAttribDivisor(1, 1);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  tubeUploads.clear();
+  tubeUploads.emplace_back(
+      GL_TEXTURE_BUFFER, particleBuffer, tubeParticleData.data(),
+      sizeof(glm::vec4) * tubeParticleData.size()
+  );
+  tubeUploads.emplace_back(
+      GL_ARRAY_BUFFER, tubeInstanceVbo, tubeInstanceData.data(),
+      sizeof(StrandTubeInstance) * tubeInstanceData.size()
+  );
+}
+
+bool Tree::uploadStrandTubes(std::size_t& budget) {
+  for (auto& upload : tubeUploads) {
+    upload.step(budget);
+    if (!upload.isDone()) return false;
+  }
+
+  // everything is on the gpu: the cpu side data is not needed anymore
+  if (!tubeUploads.empty()) {
+    tubeUploads.clear();
+    std::vector<glm::vec4>().swap(tubeParticleData);
+    std::vector<StrandTubeInstance>().swap(tubeInstanceData);
+  }
+
+  return true;
+}
+
+void Tree::deleteBuffers() {
+  glDeleteVertexArrays(1, &strandVao);
+  glDeleteBuffers(1, &strandVbo);
+  glDeleteBuffers(1, &strandEbo);
+
+  glDeleteVertexArrays(1, &tubeVao);
+  glDeleteBuffers(1, &tubeInstanceVbo);
+  glDeleteBuffers(1, &particleBuffer);
+  glDeleteTextures(1, &particleTexture);
+
+  glDeleteVertexArrays(1, &particleVao);
+  glDeleteBuffers(1, &particleVbo);
+
+  strandVao = strandVbo = strandEbo = 0;
+  tubeVao = tubeInstanceVbo = particleBuffer = particleTexture = 0;
+  particleVao = particleVbo = 0;
+}
+
+void Tree::renderStrandTubes(const Shader& sh) const {
+  if (!tubeUploads.empty()) return;
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_BUFFER, particleTexture);
+
+  sh.setInt("particles", 0);
+  sh.setFloat("strandRadius", STRAND_RADIUS);
+
+  glBindVertexArray(tubeVao);
+  glBindBuffer(GL_ARRAY_BUFFER, tubeInstanceVbo);
+
+  for (int level = 0; level < NUM_STRAND_LOD_LEVELS; ++level) {
+    if (visibleInstanceRanges[level].empty()) continue;
+
+    // triangle strip around the segment, closed by repeating the first ring vertex
+    const int ringVertices = STRAND_LOD_LEVELS[level].ringVertices;
+    const int nVertices = 2 * (ringVertices + 1);
+    sh.setInt("ringVertices", ringVertices);
+
+    for (const auto& [first, count] : visibleInstanceRanges[level]) {
+      const std::size_t offset = sizeof(StrandTubeInstance) * first;
+
+      glVertexAttribIPointer(
+          0, 1, GL_INT, sizeof(StrandTubeInstance),
+          (void*)(offset + offsetof(StrandTubeInstance, particle))
+      );
+      glVertexAttribPointer(
+          1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StrandTubeInstance),
+          (void*)(offset + offsetof(StrandTubeInstance, color))
+      );
+
+      glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, nVertices, count);
+    }
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void Tree::setStrandVisible(int strandId, bool visible) {
+  if (strandVisibility[strandId] == visible) return;
+
+  strandVisibility[strandId] = visible;
+  updateVisibleStrandRanges();
+}
+
+// consecutive visible strands are merged into a single range of indices (and of tube instances)
+void Tree::updateVisibleStrandRanges() {
+  visibleStrandCounts.clear();
+  visibleStrandOffsets.clear();
+  for (auto& ranges : visibleInstanceRanges) ranges.clear();
+
+  // cpu generated cylinders, stored strand after strand
+  for (int i = 0; i < strandVisibility.size() && !strandIndexOffsets.empty(); ++i) {
+    if (!strandVisibility[i]) continue;
+
+    int count = strandIndexOffsets[i + 1] - strandIndexOffsets[i];
+    if (i > 0 && strandVisibility[i - 1] && !visibleStrandCounts.empty()) {
+      visibleStrandCounts.back() += count;
+    } else {
+      visibleStrandCounts.push_back(count);
+      visibleStrandOffsets.push_back(
+          reinterpret_cast<const void*>(sizeof(unsigned int) * strandIndexOffsets[i])
+      );
+    }
+  }
+
+  // tube instances of the visible strands in the visible branch segments, at their level of detail
+  std::array<int, NUM_STRAND_LOD_LEVELS> ends;  // instance after the last range added
+  ends.fill(-1);
+
+  for (int nodeId = 0; nodeId < nodeTubeRuns.size(); ++nodeId) {
+    if (!nodeVisibility.empty() && !nodeVisibility[nodeId]) continue;
+
+    const int level = nodeStrandLODs.empty() ? 0 : nodeStrandLODs[nodeId];
+    const int stride = STRAND_LOD_LEVELS[level].interiorStride;
+
+    const auto& runs = nodeTubeRuns[nodeId];
+    const int nInterior = runs.size() - nodeBoundaryRuns[nodeId];
+    const int nRuns =
+        nodeBoundaryRuns[nodeId] + (stride > 0 ? (nInterior + stride - 1) / stride : 0);
+
+    auto& ranges = visibleInstanceRanges[level];
+    for (int r = 0; r < nRuns; ++r) {
+      const TubeRun& run = runs[r];
+      if (!strandVisibility[run.strandId]) continue;
+
+      if (run.first == ends[level])
+        ranges.back().second += run.count;
+      else
+        ranges.emplace_back(run.first, run.count);
+
+      ends[level] = run.first + run.count;
+    }
+  }
+
+  cullingStats.visibleInstances = 0;
+  for (const auto& ranges : visibleInstanceRanges) {
+    for (const auto& [first, count] : ranges) cullingStats.visibleInstances += count;
+  }
+}
+
+void Tree::buildBoundingHierarchy() {
+  const int nodeCount = pg.getNodeCount();
+
+  // a particle bounds the branch segment of its node, with the one before it on the strand
+  std::vector<AABB> bounds(nodeCount);
+  std::vector<float> margins(nodeCount, STRAND_RADIUS);  // thickest strand tube
+  for (const Strand& strand : strands) {
+    const auto& particles = strand.getParticles();
+
+    for (int p = 0; p < particles.size(); ++p) {
+      const int nodeId = particles[p]->nodeId;
+      bounds[nodeId].expand(particles[p]->pos);
+      margins[nodeId] = std::max(margins[nodeId], particles[p]->getRadius());
+      if (p > 0) bounds[nodeId].expand(particles[p - 1]->pos);
+    }
+  }
+
+  for (int nodeId = 0; nodeId < nodeCount; ++nodeId) {
+    if (!bounds[nodeId].isEmpty()) bounds[nodeId].pad(margins[nodeId]);
+  }
+
+  branchBVH.build(bounds);
+  nodeBounds = std::move(bounds);
+
+  nodeVisibility.clear();
+  nodeStrandLODs.clear();
+  visibleNodes.resize(nodeCount);
+  std::iota(visibleNodes.begin(), visibleNodes.end(), 0);
+
+  cullingStats = {};
+  cullingStats.visibleBranches = cullingStats.totalBranches = nodeCount;
+  cullingStats.branchesPerLOD[0] = nodeCount;
+  for (const auto& runs : nodeTubeRuns) {
+    for (const TubeRun& run : runs) cullingStats.totalInstances += run.count;
+  }
+
+  updateVisibleStrandRanges();
+}
+
+void Tree::cullBranches(const Frustum& frustum, const glm::vec3& viewPos, float pixelsPerUnit) {
+  if (branchBVH.isEmpty()) return;
+
+  std::swap(visibleNodes, previousVisibleNodes);
+  visibleNodes.clear();
+  cullingStats.testedBoxes = branchBVH.cull(frustum, visibleNodes);
+  std::sort(visibleNodes.begin(), visibleNodes.end());
+
+  cullingStats.visibleBranches = visibleNodes.size();
+
+  // the visible instance ranges are only rebuilt if the visible nodes or their levels changed:
+  // most camera moves change neither
+  bool changed = nodeVisibility.empty() || visibleNodes != previousVisibleNodes;
+  if (changed) {
+    nodeVisibility.assign(pg.getNodeCount(), false);
+    for (int nodeId : visibleNodes) nodeVisibility[nodeId] = true;
+  }
+
+  // level of detail from the width on screen of the strands at the closest point of the branch
+  if (nodeStrandLODs.empty()) nodeStrandLODs.assign(pg.getNodeCount(), 0);
+  cullingStats.branchesPerLOD.fill(0);
+  cullingStats.closestDistance = std::numeric_limits<float>::max();
+
+  for (int nodeId : visibleNodes) {
+    int level = 0;
+
+    const AABB& box = nodeBounds[nodeId];
+    float distance = glm::distance(glm::clamp(viewPos, box.min, box.max), viewPos);
+    cullingStats.closestDistance = std::min(cullingStats.closestDistance, distance);
+
+    if (pixelsPerUnit > 0.0f) {
+      float strandPixels = 2.0f * STRAND_RADIUS * pixelsPerUnit / std::max(distance, 1e-3f);
+
+      while (level + 1 < NUM_STRAND_LOD_LEVELS &&
+             strandPixels < STRAND_LOD_LEVELS[level].minStrandPixels) {
+        ++level;
+      }
+    }
+
+    changed |= nodeStrandLODs[nodeId] != level;
+    nodeStrandLODs[nodeId] = level;
+    cullingStats.branchesPerLOD[level]++;
+  }
+
+  if (changed) updateVisibleStrandRanges();
+}
+
+void Tree::renderStrands() const {
+  if (visibleStrandCounts.empty()) return;
+
+  glBindVertexArray(strandVao);
+
+  // a single draw call when every strand is visible
+  if (visibleStrandCounts.size() == 1) {
+    glDrawElements(GL_TRIANGLES, visibleStrandCounts[0], GL_UNSIGNED_INT, visibleStrandOffsets[0]);
+  } else {
+    glMultiDrawElements(
+        GL_TRIANGLES, visibleStrandCounts.data(), GL_UNSIGNED_INT, visibleStrandOffsets.data(),
+        visibleStrandCounts.size()
+    );
+  }
+
+  glBindVertexArray(0);
+}
+
+void Tree::initializeStrandParticles() {
+  const int nStrands = strands.size();
+
+  strandParticleOffsets.assign(nStrands + 1, 0);
+  for (int i = 0; i < nStrands; ++i) {
+    strandParticleOffsets[i + 1] = strandParticleOffsets[i] + strands[i].getParticles().size();
+  }
+
+  std::vector<glm::vec3> positions(strandParticleOffsets[nStrands]);
+  parallel::forRange(0, nStrands, [&](int i) {
+    const auto& particles = strands[i].getParticles();
+    for (int p = 0; p < particles.size(); ++p) {
+      positions[strandParticleOffsets[i] + p] = particles[p]->pos;
+    }
+  });
+
+  if (particleVao == 0) {
+    glGenVertexArrays(1, &particleVao);
+    glGenBuffers(1, &particleVbo);
+  }
+
+  glBindVertexArray(particleVao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, particleVbo);
+  glBufferData(
+      GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions.size(), positions.data(), GL_DYNAMIC_DRAW
+  );
+
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  particleDirtyStrands.clear();
+}
+
+void Tree::updateStrandParticles() {
+  if (particleDirtyStrands.empty() || particleVao == 0) return;
+
+  // new strands or particles: the buffer is rebuilt
+  bool resized = strandParticleOffsets.size() != strands.size() + 1;
+  for (auto it = particleDirtyStrands.begin(); !resized && it != particleDirtyStrands.end(); ++it) {
+    int count = strandParticleOffsets[*it + 1] - strandParticleOffsets[*it];
+    resized = count != strands[*it].getParticles().size();
+  }
+
+  if (resized) {
+    initializeStrandParticles();
+    return;
+  }
+
+  // consecutive dirty strands are uploaded together
+  std::vector<glm::vec3> positions;
+  glBindBuffer(GL_ARRAY_BUFFER, particleVbo);
+
+  for (auto it = particleDirtyStrands.begin(); it != particleDirtyStrands.end();) {
+    const int first = *it;
+    positions.clear();
+
+    for (int next = first; it != particleDirtyStrands.end() && *it == next; ++it, ++next) {
+      for (const auto& particle : strands[*it].getParticles()) positions.push_back(particle->pos);
+    }
+
+    glBufferSubData(
+        GL_ARRAY_BUFFER, sizeof(glm::vec3) * strandParticleOffsets[first],
+        sizeof(glm::vec3) * positions.size(), positions.data()
+    );
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  particleDirtyStrands.clear();
+}
+
+void Tree::renderStrandParticles() const {
+  if (strandParticleOffsets.empty()) return;
+
+  glBindVertexArray(particleVao);
+  glDrawArrays(GL_POINTS, 0, strandParticleOffsets.back());
+  glBindVertexArray(0);
+}
+
+// void Tree::renderCoordinateSystems(const Shader& sh) const {
+//   // generate a 2 point spline with each of the coordinate system axes (frontplanes)
+//   for (int i = 0; i < pg.getNodeCount(); ++i) {
+//     const Node& node = pg.getNode(i);
+//     const glm::mat3& frontplane = frontplanes.at(i);
+
+//     // x-axis
+//     Spline xaxisSpline({node.pos, node.pos + frontplane[0] * 0.5f});
+
+//     // y-axis
+//     Spline yaxisSpline({node.pos, node.pos + frontplane[1] * 0.5f});
+
+//     // z-axis
+//     Spline zaxisSpline({node.pos, node.pos + frontplane[2] * 0.5f});
+
+//     sh.setVec4("color", {1.0f, 0.0f, 0.0f, 1.0f});
+//     xaxisSpline.initializeBuffers();
+//     xaxisSpline.render();
+
+//     sh.setVec4("color", {0.0f, 1.0f, 0.0f, 1.0f});
+//     yaxisSpline.initializeBuffers();
+//     yaxisSpline.render();
+
+//     sh.setVec4("color", {0.0f, 0.0f, 1.0f, 1.0f});
+//     zaxisSpline.initializeBuffers();
+//     zaxisSpline.render();
+//   }
+// }
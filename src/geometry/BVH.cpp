@@ -0,0 +1,85 @@
+#include "geometry/BVH.h"
+
+#include <algorithm>
+
+void BVH::build(const std::vector<AABB>& bounds) {
+  nodes.clear();
+  items.clear();
+
+  for (int i = 0; i < bounds.size(); ++i) {
+    if (!bounds[i].isEmpty()) items.push_back(i);
+  }
+
+  if (!items.empty()) buildNode(bounds, 0, items.size());
+
+  itemBounds.resize(items.size());
+  for (int i = 0; i < items.size(); ++i) itemBounds[i] = bounds[items[i]];
+}
+
+int BVH::buildNode(const std::vector<AABB>& bounds, int first, int count) {
+  const int nodeIdx = nodes.size();
+  nodes.emplace_back();
+
+  AABB box, centroids;
+  for (int i = first; i < first + count; ++i) {
+    box.expand(bounds[items[i]]);
+    centroids.expand(bounds[items[i]].getCenter());
+  }
+
+  nodes[nodeIdx].bounds = box;
+  nodes[nodeIdx].first = first;
+  nodes[nodeIdx].count = count;
+
+  if (count <= BVH_MAX_LEAF_ITEMS) return nodeIdx;
+
+  // median split along the longest axis of the centroids
+  glm::vec3 extent = centroids.max - centroids.min;
+  int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+  auto begin = items.begin() + first;
+  std::nth_element(begin, begin + count / 2, begin + count, [&](int a, int b) {
+    return bounds[a].getCenter()[axis] < bounds[b].getCenter()[axis];
+  });
+
+  int left = buildNode(bounds, first, count / 2);
+  int right = buildNode(bounds, first + count / 2, count - count / 2);
+
+  nodes[nodeIdx].left = left;
+  nodes[nodeIdx].right = right;
+
+  return nodeIdx;
+}
+
+int BVH::cull(const Frustum& frustum, std::vector<int>& visible) const {
+  if (nodes.empty()) return 0;
+
+  int tested = 0;
+  std::vector<int> stack{0};
+
+  while (!stack.empty()) {
+    const Node& node = nodes[stack.back()];
+    stack.pop_back();
+
+    ++tested;
+    Frustum::Containment containment = frustum.classify(node.bounds);
+    if (containment == Frustum::Containment::OUTSIDE) continue;
+
+    if (containment == Frustum::Containment::INSIDE) {
+      visible.insert(
+          visible.end(), items.begin() + node.first, items.begin() + node.first + node.count
+      );
+    } else if (node.left == -1) {
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        ++tested;
+        if (frustum.classify(itemBounds[i]) != Frustum::Containment::OUTSIDE) {
+          visible.push_back(items[i]);
+        }
+      }
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+    }
+  }
+
+  return tested;
+}
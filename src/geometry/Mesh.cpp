@@ -1,28 +1,145 @@
 #include "geometry/Mesh.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 #include <glad/glad.h>
 
+#include "core/BufferUpload.h"
+
+namespace {
+
+constexpr int MAX_SHORT_INDEX_VERTICES = 65536;
+
+// 16-bit positions (the 4th one pads the vertex to 4 bytes) and a GL_INT_2_10_10_10_REV normal
+struct CompressedVertex {
+  std::uint16_t pos[4];
+  std::uint32_t normal;
+};
+
+std::uint32_t packNormal(const glm::vec3& n) {
+  auto pack = [](float v) {
+    int c = static_cast<int>(std::round(std::clamp(v, -1.0f, 1.0f) * 511.0f));
+    return static_cast<std::uint32_t>(c) & 0x3ffu;
+  };
+
+  return pack(n.x) | pack(n.y) << 10 | pack(n.z) << 20;
+}
+
+}  // namespace
+
 void Mesh::render() const {
+  if (!isUploaded()) return;
+
+  glBindVertexArray(vao);
+  glDrawElements(
+      GL_TRIANGLES, triangleCount * 3, shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, 0
+  );
+  glBindVertexArray(0);
+}
+
+void Mesh::render(const std::vector<int>& rangeIds) const {
+  std::vector<GLsizei> counts;
+  std::vector<const void*> offsets;
+
+  int end = -1;  // triangle after the last range added
+  for (int id : rangeIds) {
+    const MeshRange& range = ranges[id];
+    if (range.triangleCount == 0) continue;
+
+    if (range.triangleOffset == end) {
+      counts.back() += 3 * range.triangleCount;
+    } else {
+      counts.push_back(3 * range.triangleCount);
+      offsets.push_back(reinterpret_cast<const void*>(3 * getIndexSize() * range.triangleOffset));
+    }
+
+    end = range.triangleOffset + range.triangleCount;
+  }
+
+  if (counts.empty() || !isUploaded()) return;
+
   glBindVertexArray(vao);
-  glDrawElements(GL_TRIANGLES, indices.size() * 3, GL_UNSIGNED_INT, 0);
+  glMultiDrawElements(
+      GL_TRIANGLES, counts.data(), shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+      offsets.data(), counts.size()
+  );
   glBindVertexArray(0);
 }
 
-void Mesh::init() {
-  std::vector<GLuint> flatIndices;
-  for (const auto& tri : indices) {
-    flatIndices.push_back(tri.x);
-    flatIndices.push_back(tri.y);
-    flatIndices.push_back(tri.z);
+std::size_t Mesh::getVertexSize() const {
+  if (format == VertexFormat::FULL) return (withNormals ? 2 : 1) * sizeof(glm::vec3);
+
+  return withNormals ? sizeof(CompressedVertex) : 4 * sizeof(std::uint16_t);
+}
+
+void Mesh::writeVertices(
+    const glm::vec3* positions, const glm::vec3* vertexNormals, int count, unsigned char* out
+) const {
+  if (format == VertexFormat::FULL) {
+    auto* interleaved = reinterpret_cast<glm::vec3*>(out);
+    for (int i = 0; i < count; ++i) {
+      *interleaved++ = positions[i];
+
+      if (withNormals) *interleaved++ = vertexNormals[i];
+    }
+
+    return;
   }
 
-  bool hasNormals = normals.size() == vertices.size();
-  std::vector<glm::vec3> interleavedVertexData;
-  for (int i = 0; i < vertices.size(); ++i) {
-    interleavedVertexData.push_back(vertices[i]);
+  // positions quantized in the mesh bounds
+  const std::size_t stride = getVertexSize();
+  for (int i = 0; i < count; ++i) {
+    CompressedVertex vertex{};
 
-    if (hasNormals) interleavedVertexData.push_back(normals[i]);
+    glm::vec3 q = (positions[i] - positionOffset) / positionScale;
+    for (int c = 0; c < 3; ++c) {
+      vertex.pos[c] = static_cast<std::uint16_t>(std::round(std::clamp(q[c], 0.0f, 1.0f) * 65535));
+    }
+    if (withNormals) vertex.normal = packNormal(vertexNormals[i]);
+
+    std::memcpy(out + stride * i, &vertex, stride);
   }
+}
+
+void Mesh::writeIndices(const glm::uvec3* triangles, int count, unsigned char* out) const {
+  if (shortIndices) {
+    auto* shortOut = reinterpret_cast<std::uint16_t*>(out);
+    for (int i = 0; i < count; ++i) {
+      *shortOut++ = triangles[i].x;
+      *shortOut++ = triangles[i].y;
+      *shortOut++ = triangles[i].z;
+    }
+  } else {
+    // glm::uvec3 is tightly packed, so triangles can be copied as they are
+    std::memcpy(out, triangles, sizeof(glm::uvec3) * count);
+  }
+}
+
+void Mesh::init(bool deferUpload) {
+  vertexCount = vertices.size();
+  triangleCount = indices.size();
+  withNormals = normals.size() == vertices.size() && !normals.empty();
+  shortIndices = format == VertexFormat::COMPRESSED && vertexCount <= MAX_SHORT_INDEX_VERTICES;
+
+  if (format == VertexFormat::COMPRESSED && vertexCount > 0) {
+    glm::vec3 min{std::numeric_limits<float>::max()}, max{std::numeric_limits<float>::lowest()};
+    for (const auto& v : vertices) {
+      min = glm::min(min, v);
+      max = glm::max(max, v);
+    }
+
+    positionOffset = min;
+    positionScale = max - min;
+    for (int c = 0; c < 3; ++c) {
+      if (positionScale[c] <= 0.0f) positionScale[c] = 1.0f;  // flat along this axis
+    }
+  }
+
+  const std::size_t vertexBytes = getVertexSize() * vertexCount;
+  const std::size_t indexBytes = 3 * getIndexSize() * triangleCount;
 
   glGenVertexArrays(1, &vao);
   glGenBuffers(1, &vbo);
@@ -30,27 +147,170 @@ void Mesh::init() {
 
   glBindVertexArray(vao);
 
+  // the buffers are allocated first, and then filled in place by uploadStep
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(
-      GL_ARRAY_BUFFER, sizeof(glm::vec3) * interleavedVertexData.size(),
-      interleavedVertexData.data(), GL_STATIC_DRAW
-  );
+  glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
 
-  auto stride = hasNormals ? 2 * sizeof(glm::vec3) : sizeof(glm::vec3);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-  glEnableVertexAttribArray(0);
+  const std::size_t stride = getVertexSize();
+  if (format == VertexFormat::FULL) {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
 
-  if (hasNormals) {
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-    glEnableVertexAttribArray(1);
+    if (withNormals) {
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
+      glEnableVertexAttribArray(1);
+    }
+  } else {
+    // both attributes are normalized by the vertex fetch: positions to [0, 1], normals to [-1, 1]
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    if (withNormals) {
+      glVertexAttribPointer(
+          1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompressedVertex, normal)
+      );
+      glEnableVertexAttribArray(1);
+    }
   }
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-  glBufferData(
-      GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * flatIndices.size(), flatIndices.data(),
-      GL_STATIC_DRAW
-  );
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
 
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
+
+  if (!deferUpload) {
+    std::size_t budget = std::numeric_limits<std::size_t>::max();
+    uploadStep(budget);
+  }
+}
+
+bool Mesh::uploadStep(std::size_t& budget) {
+  // nothing draws from the buffers before the upload is done: no synchronization is needed
+  const GLbitfield access = GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+  const std::size_t vertexSize = getVertexSize();
+  int nVertices = std::min<std::size_t>(vertexCount - uploadedVertices, budget / vertexSize);
+  if (nVertices > 0) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    writeBuffer(
+        GL_ARRAY_BUFFER, vertexSize * uploadedVertices, vertexSize * nVertices, access,
+        [&](auto* out) {
+          writeVertices(
+              &vertices[uploadedVertices], withNormals ? &normals[uploadedVertices] : nullptr,
+              nVertices, out
+          );
+        }
+    );
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    uploadedVertices += nVertices;
+    budget -= vertexSize * nVertices;
+  }
+
+  const std::size_t triangleSize = 3 * getIndexSize();
+  int nTriangles = std::min<std::size_t>(triangleCount - uploadedTriangles, budget / triangleSize);
+  if (nTriangles > 0) {
+    glBindVertexArray(vao);
+    writeBuffer(
+        GL_ELEMENT_ARRAY_BUFFER, triangleSize * uploadedTriangles, triangleSize * nTriangles,
+        access, [&](auto* out) { writeIndices(&indices[uploadedTriangles], nTriangles, out); }
+    );
+    glBindVertexArray(0);
+
+    uploadedTriangles += nTriangles;
+    budget -= triangleSize * nTriangles;
+  }
+
+  return isUploaded();
+}
+
+void Mesh::deleteBuffers() {
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &ebo);
+  vao = vbo = ebo = 0;
+}
+
+void Mesh::releaseCpuData() {
+  if (!isUploaded()) return;
+
+  // swapping with empty vectors actually frees the memory (unlike clear)
+  std::vector<glm::vec3>().swap(vertices);
+  std::vector<glm::vec3>().swap(normals);
+  std::vector<glm::uvec3>().swap(indices);
+}
+
+bool Mesh::updateRange(const MeshData& data, const MeshRange& range) {
+  // quantization bounds are fixed at creation
+  if (format == VertexFormat::COMPRESSED) {
+    for (int i = range.vertexOffset; i < range.vertexOffset + range.vertexCount; ++i) {
+      glm::vec3 q = (data.vertices[i] - positionOffset) / positionScale;
+      for (int c = 0; c < 3; ++c) {
+        if (q[c] < 0.0f || q[c] > 1.0f) return false;
+      }
+    }
+  }
+
+  if (hasCpuData()) {
+    std::copy_n(
+        &data.vertices[range.vertexOffset], range.vertexCount, &vertices[range.vertexOffset]
+    );
+    if (withNormals) {
+      std::copy_n(
+          &data.normals[range.vertexOffset], range.vertexCount, &normals[range.vertexOffset]
+      );
+    }
+    std::copy_n(
+        &data.indices[range.triangleOffset], range.triangleCount, &indices[range.triangleOffset]
+    );
+  }
+
+  // the gpu ranges are written from `data`, so that they can be updated without cpu copies
+  const std::size_t vertexSize = getVertexSize();
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  writeBuffer(
+      GL_ARRAY_BUFFER, vertexSize * range.vertexOffset, vertexSize * range.vertexCount,
+      GL_MAP_INVALIDATE_RANGE_BIT,
+      [&](auto* out) {
+        writeVertices(
+            &data.vertices[range.vertexOffset],
+            withNormals ? &data.normals[range.vertexOffset] : nullptr, range.vertexCount, out
+        );
+      }
+  );
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // the element buffer binding is part of the vao state
+  const std::size_t triangleSize = 3 * getIndexSize();
+  glBindVertexArray(vao);
+  writeBuffer(
+      GL_ELEMENT_ARRAY_BUFFER, triangleSize * range.triangleOffset,
+      triangleSize * range.triangleCount, GL_MAP_INVALIDATE_RANGE_BIT,
+      [&](auto* out) {
+        writeIndices(&data.indices[range.triangleOffset], range.triangleCount, out);
+      }
+  );
+  glBindVertexArray(0);
+
+  return true;
+}
+
+MeshMemory Mesh::computeMemoryUsage(
+    std::size_t vertexCount, std::size_t triangleCount, bool withNormals, VertexFormat format
+) {
+  MeshMemory memory;
+
+  if (format == VertexFormat::FULL) {
+    memory.vertexBytes = vertexCount * (withNormals ? 2 : 1) * sizeof(glm::vec3);
+    memory.indexBytes = 3 * triangleCount * sizeof(std::uint32_t);
+  } else {
+    memory.vertexBytes =
+        vertexCount * (withNormals ? sizeof(CompressedVertex) : 4 * sizeof(std::uint16_t));
+    memory.indexBytes = 3 * triangleCount *
+                        (vertexCount <= MAX_SHORT_INDEX_VERTICES ? sizeof(std::uint16_t)
+                                                                 : sizeof(std::uint32_t));
+  }
+
+  return memory;
 }
@@ -0,0 +1,294 @@
+#include "geometry/MeshExport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "core/BufferedWriter.h"
+#include "core/Color.h"
+#include "geometry/Bounds.h"
+
+namespace {
+
+constexpr int MAX_SHORT_INDEX_VERTICES = 65535;  // 0xffff is the primitive restart value
+
+// gltf constants
+constexpr int GLTF_BYTE = 5120, GLTF_UNSIGNED_BYTE = 5121, GLTF_UNSIGNED_SHORT = 5123,
+              GLTF_UNSIGNED_INT = 5125, GLTF_FLOAT = 5126;
+constexpr int GLTF_ARRAY_BUFFER = 34962, GLTF_ELEMENT_ARRAY_BUFFER = 34963;
+constexpr int GLTF_TRIANGLES = 4;
+
+// strand channels actually written
+struct StrandChannels {
+  bool ids{false}, colors{false};
+};
+
+StrandChannels getStrandChannels(const MeshData& data, const MeshExportOptions& options) {
+  const bool available = !data.strandIds.empty();
+  if (available && data.strandIds.size() != data.vertices.size())
+    throw std::runtime_error("Mesh export: strand ids and vertices counts differ");
+
+  return {available && options.strandIds, available && !options.strandColors.empty()};
+}
+
+void writePLY(const MeshData& data, BufferedWriter& out, const MeshExportOptions& options) {
+  const StrandChannels channels = getStrandChannels(data, options);
+  const bool withNormals = data.normals.size() == data.vertices.size();
+
+  std::ostringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment interactive-invigoration tree mesh\n"
+         << "element vertex " << data.vertices.size() << "\n"
+         << "property float x\nproperty float y\nproperty float z\n";
+  if (withNormals) header << "property float nx\nproperty float ny\nproperty float nz\n";
+  if (channels.ids) header << "property int strand\n";
+  if (channels.colors) {
+    header << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+           << "property uchar alpha\n";
+  }
+  header << "element face " << data.indices.size() << "\n"
+         << "property list uchar uint vertex_indices\n"
+         << "end_header\n";
+
+  const std::string headerText = header.str();
+  out.write(headerText.data(), headerText.size());
+
+  for (int i = 0; i < data.vertices.size(); ++i) {
+    out.write(data.vertices[i]);
+    if (withNormals) out.write(data.normals[i]);
+    if (channels.ids) out.write(static_cast<std::int32_t>(data.strandIds[i]));
+    if (channels.colors) out.write(packColor(options.strandColors.at(data.strandIds[i])));
+  }
+
+  for (const auto& triangle : data.indices) {
+    out.write(static_cast<std::uint8_t>(3));
+    out.write(triangle);
+  }
+}
+
+void writeGLB(const MeshData& data, BufferedWriter& out, const MeshExportOptions& options) {
+  const StrandChannels channels = getStrandChannels(data, options);
+  const bool withNormals = data.normals.size() == data.vertices.size();
+  const bool quantize = options.quantize;
+  const std::size_t vertexCount = data.vertices.size();
+  const bool shortIndices = vertexCount <= MAX_SHORT_INDEX_VERTICES;
+
+  if (vertexCount == 0) throw std::runtime_error("Mesh export: empty mesh");
+
+  AABB bounds;
+  for (const auto& v : data.vertices) bounds.expand(v);
+  const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+
+  // quantized bounds: a flat axis is quantized to 0 only
+  glm::vec3 quantizedMax{0.0f};
+  for (int c = 0; c < 3; ++c) quantizedMax[c] = bounds.max[c] > bounds.min[c] ? 65535.0f : 0.0f;
+
+  // buffer views, in the order they are written in the binary chunk (4 byte aligned elements)
+  struct View {
+    std::size_t offset, length;
+    int stride, target;
+  };
+  std::vector<View> views;
+  std::size_t binLength = 0;
+
+  auto addView = [&](int elementSize, std::size_t count, int target) {
+    const int stride = target == GLTF_ARRAY_BUFFER ? elementSize : 0;
+    views.push_back({binLength, elementSize * count, stride, target});
+
+    binLength += (elementSize * count + 3) / 4 * 4;
+    return static_cast<int>(views.size()) - 1;
+  };
+
+  const int positionView = addView(quantize ? 8 : 12, vertexCount, GLTF_ARRAY_BUFFER);
+  const int normalView = withNormals ? addView(quantize ? 4 : 12, vertexCount, GLTF_ARRAY_BUFFER)
+                                     : -1;
+  const int strandView = channels.ids ? addView(4, vertexCount, GLTF_ARRAY_BUFFER) : -1;
+  const int colorView = channels.colors ? addView(4, vertexCount, GLTF_ARRAY_BUFFER) : -1;
+  const int indexView =
+      addView(shortIndices ? 2 : 4, 3 * data.indices.size(), GLTF_ELEMENT_ARRAY_BUFFER);
+
+  // json chunk
+  std::ostringstream json;
+  json.precision(std::numeric_limits<float>::max_digits10);
+
+  auto writeVec3 = [&](const glm::vec3& v) {
+    json << "[" << v.x << "," << v.y << "," << v.z << "]";
+  };
+
+  json << R"({"asset":{"version":"2.0","generator":"interactive-invigoration"},)";
+  if (quantize) {
+    json << R"("extensionsUsed":["KHR_mesh_quantization"],)"
+         << R"("extensionsRequired":["KHR_mesh_quantization"],)";
+  }
+
+  // quantized positions are in [0, 65535]: the node maps them back to the mesh bounds
+  json << R"("scene":0,"scenes":[{"nodes":[0]}],"nodes":[{"mesh":0)";
+  if (quantize) {
+    json << R"(,"translation":)";
+    writeVec3(bounds.min);
+    json << R"(,"scale":)";
+    writeVec3(extent / 65535.0f);
+  }
+  json << "}],";
+
+  int accessor = 0;
+  json << R"("meshes":[{"primitives":[{"attributes":{"POSITION":)" << accessor++;
+  if (withNormals) json << R"(,"NORMAL":)" << accessor++;
+  if (channels.ids) json << R"(,"_STRAND_ID":)" << accessor++;
+  if (channels.colors) json << R"(,"COLOR_0":)" << accessor++;
+  json << R"(},"indices":)" << accessor++ << R"(,"mode":)" << GLTF_TRIANGLES << "}]}],";
+
+  json << R"("buffers":[{"byteLength":)" << binLength << "}],";
+
+  json << R"("bufferViews":[)";
+  for (int v = 0; v < views.size(); ++v) {
+    json << (v > 0 ? "," : "") << R"({"buffer":0,"byteOffset":)" << views[v].offset
+         << R"(,"byteLength":)" << views[v].length;
+    if (views[v].stride > 0) json << R"(,"byteStride":)" << views[v].stride;
+    json << R"(,"target":)" << views[v].target << "}";
+  }
+  json << "],";
+
+  auto writeAccessor = [&](int view, int componentType, bool normalized, std::size_t count,
+                           const char* type) {
+    json << R"({"bufferView":)" << view << R"(,"componentType":)" << componentType
+         << R"(,"count":)" << count << R"(,"type":")" << type << R"(")";
+    if (normalized) json << R"(,"normalized":true)";
+  };
+
+  json << R"("accessors":[)";
+  writeAccessor(
+      positionView, quantize ? GLTF_UNSIGNED_SHORT : GLTF_FLOAT, false, vertexCount, "VEC3"
+  );
+  json << R"(,"min":)";
+  writeVec3(quantize ? glm::vec3(0.0f) : bounds.min);
+  json << R"(,"max":)";
+  writeVec3(quantize ? quantizedMax : bounds.max);
+  json << "}";
+
+  if (withNormals) {
+    json << ",";
+    writeAccessor(normalView, quantize ? GLTF_BYTE : GLTF_FLOAT, quantize, vertexCount, "VEC3");
+    json << "}";
+  }
+  if (channels.ids) {
+    // float: integer vertex attributes are not allowed (exact up to 2^24 strands)
+    json << ",";
+    writeAccessor(strandView, GLTF_FLOAT, false, vertexCount, "SCALAR");
+    json << "}";
+  }
+  if (channels.colors) {
+    json << ",";
+    writeAccessor(colorView, GLTF_UNSIGNED_BYTE, true, vertexCount, "VEC4");
+    json << "}";
+  }
+
+  json << ",";
+  writeAccessor(
+      indexView, shortIndices ? GLTF_UNSIGNED_SHORT : GLTF_UNSIGNED_INT, false,
+      3 * data.indices.size(), "SCALAR"
+  );
+  json << "}]}";
+
+  std::string jsonText = json.str();
+  jsonText.resize((jsonText.size() + 3) / 4 * 4, ' ');
+
+  // header, json chunk, then the binary chunk streamed view by view
+
+  const std::uint32_t totalLength = 12 + 8 + jsonText.size() + 8 + binLength;
+  out.write("glTF", 4);
+  out.write(std::uint32_t{2});
+  out.write(totalLength);
+
+  out.write(static_cast<std::uint32_t>(jsonText.size()));
+  out.write("JSON", 4);
+  out.write(jsonText.data(), jsonText.size());
+
+  out.write(static_cast<std::uint32_t>(binLength));
+  out.write("BIN\0", 4);
+
+  for (const auto& v : data.vertices) {
+    if (quantize) {
+      glm::vec3 q = (v - bounds.min) / extent;
+      for (int c = 0; c < 3; ++c) {
+        out.write(static_cast<std::uint16_t>(std::round(std::clamp(q[c], 0.0f, 1.0f) * 65535)));
+      }
+      out.write(std::uint16_t{0});
+    } else {
+      out.write(v);
+    }
+  }
+
+  if (withNormals) {
+    for (const auto& n : data.normals) {
+      if (quantize) {
+        for (int c = 0; c < 3; ++c) {
+          out.write(static_cast<std::int8_t>(std::round(std::clamp(n[c], -1.0f, 1.0f) * 127)));
+        }
+        out.write(std::int8_t{0});
+      } else {
+        out.write(n);
+      }
+    }
+  }
+
+  if (channels.ids) {
+    for (int id : data.strandIds) out.write(static_cast<float>(id));
+  }
+  if (channels.colors) {
+    for (int id : data.strandIds) out.write(packColor(options.strandColors.at(id)));
+  }
+
+  for (const auto& triangle : data.indices) {
+    if (shortIndices) {
+      for (int c = 0; c < 3; ++c) out.write(static_cast<std::uint16_t>(triangle[c]));
+    } else {
+      out.write(triangle);
+    }
+  }
+  out.pad(4, 0);
+}
+
+}  // namespace
+
+void exportPLY(const MeshData& data, const std::string& path, const MeshExportOptions& options) {
+  BufferedWriter out(path);
+  writePLY(data, out, options);
+  out.close();
+}
+
+void exportPLY(const MeshData& data, std::ostream& stream, const MeshExportOptions& options) {
+  BufferedWriter out(stream);
+  writePLY(data, out, options);
+  out.close();
+}
+
+void exportGLB(const MeshData& data, const std::string& path, const MeshExportOptions& options) {
+  BufferedWriter out(path);
+  writeGLB(data, out, options);
+  out.close();
+}
+
+void exportGLB(const MeshData& data, std::ostream& stream, const MeshExportOptions& options) {
+  BufferedWriter out(stream);
+  writeGLB(data, out, options);
+  out.close();
+}
+
+void exportMesh(const MeshData& data, const std::string& path, const MeshExportOptions& options) {
+  auto endsWith = [&path](const std::string& suffix) {
+    return path.size() >= suffix.size() &&
+           path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+
+  if (endsWith(".ply"))
+    exportPLY(data, path, options);
+  else if (endsWith(".glb"))
+    exportGLB(data, path, options);
+  else
+    throw std::runtime_error("Unknown mesh export format (expected .ply or .glb): " + path);
+}
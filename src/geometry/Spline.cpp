@@ -1,32 +1,129 @@
 #include "geometry/Spline.h"
 
-std::vector<glm::vec3> Spline::interpolate(const std::vector<glm::vec3>& points) {
-  int nPoints = points.size();
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// BASIS_TABLES[n - 1][k] = (t^3, t^2, t, 1) for the samples t = k / n of a segment sampled n times
+using BasisTable = std::array<glm::vec4, NUM_INTERPOLATED_POINTS>;
+const std::array<BasisTable, NUM_INTERPOLATED_POINTS> BASIS_TABLES = []() {
+  std::array<BasisTable, NUM_INTERPOLATED_POINTS> tables;
+  for (int n = 1; n <= NUM_INTERPOLATED_POINTS; ++n) {
+    for (int k = 0; k < n; ++k) {
+      float t = static_cast<float>(k) / n;
+      tables[n - 1][k] = {t * t * t, t * t, t, 1.0f};
+    }
+  }
+  return tables;
+}();
+
+// evaluate the `nSamples` samples of a segment in [0, 1)
+void evaluateSegment(const SplineSegment& segment, int nSamples, glm::vec3* out) {
+  const BasisTable& basisTable = BASIS_TABLES[nSamples - 1];
+
+#if defined(__SSE__)
+  const __m128 a = _mm_set_ps(0.0f, segment.a.z, segment.a.y, segment.a.x);
+  const __m128 b = _mm_set_ps(0.0f, segment.b.z, segment.b.y, segment.b.x);
+  const __m128 m1 = _mm_set_ps(0.0f, segment.m1.z, segment.m1.y, segment.m1.x);
+  const __m128 p1 = _mm_set_ps(0.0f, segment.p1.z, segment.p1.y, segment.p1.x);
+
+  // the first sample is the control point itself
+  out[0] = segment.p1;
+
+  for (int k = 1; k < nSamples; ++k) {
+    const glm::vec4& basis = basisTable[k];
+    __m128 p = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(basis.x)), _mm_mul_ps(b, _mm_set1_ps(basis.y))),
+        _mm_add_ps(_mm_mul_ps(m1, _mm_set1_ps(basis.z)), p1)
+    );
+
+    // 16 byte store: the 4th lane spills into the next sample, which is always written after
+    // (the last sample of a strand is its last control point, written separately)
+    _mm_storeu_ps(&out[k].x, p);
+  }
+#else
+  for (int k = 0; k < nSamples; ++k) {
+    const glm::vec4& basis = basisTable[k];
+    out[k] = segment.a * basis.x + segment.b * basis.y + segment.m1 * basis.z + segment.p1;
+  }
+#endif
+}
+
+}  // namespace
+
+void Spline::interpolate(
+    const glm::vec3* points, int nPoints, glm::vec3* out, const int* segmentSamples
+) {
   assert(nPoints > 1);
 
-  const float step = 1.0f / NUM_INTERPOLATED_POINTS;
-  std::vector<glm::vec3> interpolated;
   glm::vec3 start = 2.0f * points[0] - points[1];
   glm::vec3 end = 2.0f * points[nPoints - 1] - points[nPoints - 2];
 
   for (int i = 0; i < nPoints - 1; ++i) {
-    glm::vec3 p0 = i >= 1 ? points[i - 1] : start;
-    glm::vec3 p4 = i + 2 < nPoints ? points[i + 2] : end;
+    const glm::vec3& p0 = i >= 1 ? points[i - 1] : start;
+    const glm::vec3& p3 = i + 2 < nPoints ? points[i + 2] : end;
+    int nSamples = segmentSamples ? segmentSamples[i] : NUM_INTERPOLATED_POINTS;
 
     // interpolate in the interval [ points[i], points[i + 1] )
-    for (float t = 0.0f; t < 1.0f; t += step) {
-      interpolated.push_back(catmullRom(p0, points[i], points[i + 1], p4, t));
-    }
+    evaluateSegment(computeSegment(p0, points[i], points[i + 1], p3), nSamples, out);
+    out += nSamples;
   }
 
   // include the last point explicitly
-  interpolated.push_back(points[nPoints - 1]);
+  *out = points[nPoints - 1];
+}
+
+std::vector<glm::vec3> Spline::interpolate(const std::vector<glm::vec3>& points) {
+  std::vector<glm::vec3> interpolated(getNumInterpolatedPoints(points.size()));
+  interpolate(points.data(), points.size(), interpolated.data());
 
   return interpolated;
 }
 
-glm::vec3 Spline::catmullRom(
-    const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t
+void Spline::interpolateSegments(
+    const SegmentControlPoints* controlPoints, int count, int nSamples, glm::vec3* out
+) {
+  for (int i = 0; i < count; ++i) {
+    const auto& [p0, p1, p2, p3] = controlPoints[i];
+    const SplineSegment segment = computeSegment(p0, p1, p2, p3);
+
+    if (i + 1 < count) {
+      evaluateSegment(segment, nSamples, out + i * nSamples);
+      continue;
+    }
+
+    // the last one is evaluated with room for the store spilling past its last sample
+    std::array<glm::vec3, NUM_INTERPOLATED_POINTS + 1> samples;
+    evaluateSegment(segment, nSamples, samples.data());
+    std::copy_n(samples.begin(), nSamples, out + i * nSamples);
+  }
+}
+
+int Spline::computeSegmentSamples(
+    const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
+    float chordTolerance
+) {
+  SplineSegment segment = computeSegment(p0, p1, p2, p3);
+
+  // p''(t) = 6at + 2b is linear, so its norm is maximal at one of the segment ends. the distance
+  // between a curve and its chord of parameter length h is bounded by max|p''| h^2 / 8
+  float maxCurvature = std::max(
+      glm::length(2.0f * segment.b), glm::length(6.0f * segment.a + 2.0f * segment.b)
+  );
+  int nSamples = std::ceil(std::sqrt(maxCurvature / (8.0f * chordTolerance)));
+
+  return std::clamp(nSamples, 1, NUM_INTERPOLATED_POINTS);
+}
+
+SplineSegment Spline::computeSegment(
+    const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3
 ) {
   float t01 = pow(distance(p0, p1), SPLINE_ALPHA);
   float t12 = pow(distance(p1, p2), SPLINE_ALPHA);
@@ -40,7 +137,7 @@ glm::vec3 Spline::catmullRom(
   glm::vec3 a = 2.0f * (p1 - p2) + m1 + m2;
   glm::vec3 b = -3.0f * (p1 - p2) - m1 - m1 - m2;
 
-  return a * (t * t * t) + b * (t * t) + m1 * t + p1;
+  return {a, b, m1, p1};
 }
 
 void Spline::render() const {
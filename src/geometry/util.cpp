@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <vector>
 
 #include <CGAL/Delaunay_triangulation_2.h>
@@ -160,3 +161,66 @@ std::vector<int> util::computeBoundaryVertices(
 
   return boundaryLoop;
 }
+
+void util::stitchRings(
+    const std::vector<glm::vec3>& vertices, int offsetA, int sizeA, int offsetB, int sizeB,
+    std::vector<glm::uvec3>& triangles
+) {
+  auto a = [&](int i) { return offsetA + i % sizeA; };
+
+  // start ring B at the vertex closest to the first vertex of ring A
+  int startB = 0;
+  for (int j = 1; j < sizeB; ++j) {
+    if (glm::distance(vertices[offsetA], vertices[offsetB + j]) <
+        glm::distance(vertices[offsetA], vertices[offsetB + startB])) {
+      startB = j;
+    }
+  }
+  auto b = [&](int j) { return offsetB + (startB + j) % sizeB; };
+
+  // advance on the ring whose next vertex gives the shortest diagonal
+  int i = 0, j = 0;
+  while (i < sizeA || j < sizeB) {
+    bool advanceA = j == sizeB;
+    if (i < sizeA && j < sizeB) {
+      advanceA = glm::distance(vertices[a(i + 1)], vertices[b(j)]) <
+                 glm::distance(vertices[a(i)], vertices[b(j + 1)]);
+    }
+
+    if (advanceA) {
+      triangles.emplace_back(a(i), a(i + 1), b(j));
+      ++i;
+    } else {
+      triangles.emplace_back(a(i), b(j + 1), b(j));
+      ++j;
+    }
+  }
+}
+
+void util::splitClusters(
+    const std::vector<glm::vec3>& points, std::vector<int>& order, int first, int last,
+    int clusterCount, std::vector<std::pair<int, int>>& clusters
+) {
+  if (clusterCount <= 1) {
+    clusters.emplace_back(first, last);
+    return;
+  }
+
+  glm::vec2 lo{std::numeric_limits<float>::max()}, hi{-std::numeric_limits<float>::max()};
+  for (int i = first; i < last; ++i) {
+    lo = glm::min(lo, glm::vec2(points[order[i]]));
+    hi = glm::max(hi, glm::vec2(points[order[i]]));
+  }
+  const int axis = hi.x - lo.x >= hi.y - lo.y ? 0 : 1;
+
+  // both halves get at least as many points as clusters
+  const int leftClusters = clusterCount / 2;
+  const int middle = first + static_cast<long long>(last - first) * leftClusters / clusterCount;
+  std::nth_element(
+      order.begin() + first, order.begin() + middle, order.begin() + last,
+      [&](int a, int b) { return points[a][axis] < points[b][axis]; }
+  );
+
+  splitClusters(points, order, first, middle, leftClusters, clusters);
+  splitClusters(points, order, middle, last, clusterCount - leftClusters, clusters);
+}
@@ -1,22 +1,56 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "core/Camera.h"
+#include "core/FrameTimer.h"
 #include "core/PlantGraph.h"
+#include "core/PlantGraphIO.h"
 #include "core/Shader.h"
 #include "core/Tree.h"
+#include "core/TreeGenerator.h"
+#include "core/UniformBuffer.h"
+#include "geometry/MeshExport.h"
 
 constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+constexpr std::size_t UPLOAD_BUDGET_PER_FRAME = 4 << 20;  // bytes uploaded per frame at most
+constexpr double GENERATOR_POLL_INTERVAL = 0.01;            // seconds, while idle
+constexpr float MAX_MESH_SCREEN_ERROR = 1.0f;               // pixels, of the mesh level of detail
 constexpr unsigned int WINDOW_WIDTH = 1920, WINDOW_HEIGHT = WINDOW_WIDTH / ASPECT_RATIO;
 
 // control
 bool g_wireframeActive = false;
 bool g_showMesh = false;
 bool g_showStrands = true;
+bool g_printCullingStats = false;
+bool g_growRequested = false;
+bool g_moveRequested = false;
+std::mt19937 g_editRng{std::random_device{}()};  // random edits of the plant graph
+bool g_shaderTubes = true;  // expand the strand tubes in the vertex shader (else cpu cylinders)
+bool g_strandLOD = true;     // coarser strand tubes and mesh far from the camera
 bool g_rotatingCamera = false;
 bool g_panningCamera = false;
+bool g_redraw = true;  // something changed since the last frame
+VertexFormat g_meshFormat = VertexFormat::FULL;  // of the uploaded meshes (see --compressed)
+
+// frame timing
+enum Phase { PHASE_INPUT, PHASE_UPLOAD, PHASE_CULLING, PHASE_DRAW, PHASE_SWAP };
+enum Pass { PASS_MESH, PASS_STRANDS };
+const std::vector<std::string> PHASE_NAMES = {"input", "upload", "culling", "draw", "swap"};
+const std::vector<std::string> PASS_NAMES = {"mesh", "strands"};
 
 // camera controls
 Camera camera({0.0f, 2.0f, 3.0f}, {0.0f, 3.0f, -1.0f});
@@ -31,6 +65,7 @@ float lastTime = 0.0f;
 
 // callbacks
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+void windowRefreshCallback(GLFWwindow* window);
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
@@ -38,9 +73,115 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
 //
 void processInput(GLFWwindow* window);
+bool isCameraMoving(GLFWwindow* window);
 void clear(GLFWwindow* window);
 
-GLFWwindow* initWindow() {
+PlantGraph createDefaultGraph();
+PlantGraph loadGraph(const char* path);
+int exportTree(
+    PlantGraph& pg, const TreeGeneratorOptions& options, const char* path, bool quantize,
+    bool expandStrands
+);
+void printMeshMemory(const std::vector<std::unique_ptr<Mesh>>& meshes);
+
+// an edit of the plant graph, made on the viewer's graph and on the one of the tree shown
+struct GraphEdit {
+  bool add;    // a node added, else moved
+  int nodeId;  // parent of the node added, or node moved
+  glm::vec3 pos;
+
+  void apply(PlantGraph& graph) const {
+    if (add)
+      graph.addNode(pos, nodeId);
+    else
+      graph.setNodePosition(nodeId, pos);
+  }
+};
+GraphEdit growRandomBranch(const PlantGraph& pg);
+GraphEdit moveRandomBranch(const PlantGraph& pg);
+bool isSameGraph(const PlantGraph& a, const PlantGraph& b);
+
+// a generated tree with its gpu buffers
+struct Scene {
+  std::shared_ptr<GeneratedTree> generated;  // shared with the generator while it builds the mesh
+  std::vector<std::unique_ptr<Mesh>> meshes;  // levels of detail, full mesh first
+  std::vector<MeshLOD> meshLODs;              // their errors (the data is moved to the meshes)
+  MeshData meshData;  // cpu copy of the full mesh, kept from the first edit on
+  bool meshRequested{false};
+  bool cylindersInitialized{false};
+
+  void createMeshes(std::vector<MeshLOD>& lods) {
+    for (MeshLOD& lod : lods) {
+      meshes.push_back(std::make_unique<Mesh>(std::move(lod.data), g_meshFormat, true));
+    }
+    meshLODs = std::move(lods);
+  }
+
+  bool isMeshUploaded() const {
+    return std::all_of(meshes.begin(), meshes.end(), [](const auto& mesh) {
+      return mesh->isUploaded();
+    });
+  }
+
+  // the levels are uploaded in order, within `budget`. returns whether they all are
+  bool uploadMeshes(std::size_t& budget) {
+    for (auto& mesh : meshes) {
+      if (!mesh->uploadStep(budget)) return false;
+    }
+
+    // the meshes are never read back on the cpu
+    for (auto& mesh : meshes) mesh->releaseCpuData();
+    printMeshMemory(meshes);
+    return true;
+  }
+
+  void deleteBuffers() {
+    if (generated) generated->tree->deleteBuffers();
+    for (auto& mesh : meshes) mesh->deleteBuffers();
+  }
+
+  // the tree is updated in place (see Tree::update), and so are its buffers: the strand tubes are
+  // uploaded again, and the full mesh gets its changed ranges only, unless their sizes changed.
+  // the coarser levels of detail of the mesh are dropped
+  void edit(const GraphEdit& graphEdit) {
+    auto start = std::chrono::steady_clock::now();
+
+    graphEdit.apply(*generated->graph);
+    Tree& tree = *generated->tree;
+    const std::set<int> nodes = tree.update();
+
+    tree.deleteBuffers();
+    tree.initializeStrandTubes();
+    tree.buildBoundingHierarchy();
+    cylindersInitialized = false;
+
+    if (!meshes.empty()) {
+      for (int level = 1; level < meshes.size(); ++level) meshes[level]->deleteBuffers();
+      meshes.resize(1);
+      meshLODs.resize(1);
+
+      bool inPlace = !meshData.ranges.empty() && tree.updateMeshData(meshData, nodes);
+      for (auto it = nodes.begin(); inPlace && it != nodes.end(); ++it) {
+        inPlace = meshes[0]->updateRange(meshData, meshData.ranges[*it]);
+      }
+
+      if (!inPlace) {
+        if (meshData.ranges.size() != generated->graph->getNodeCount())
+          meshData = tree.generateMeshData();
+
+        meshes[0]->deleteBuffers();
+        meshes[0] = std::make_unique<Mesh>(MeshData{meshData}, g_meshFormat);
+        meshes[0]->releaseCpuData();
+      }
+    }
+
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Tree updated in " << elapsed.count() << " s (" << nodes.size()
+              << " nodes remeshed)\n";
+  }
+};
+
+GLFWwindow* initWindow(bool visible) {
   // initialize GLFW
   if (!glfwInit()) {
     std::cerr << "ERROR: Failed to init GLFW" << std::endl;
@@ -50,6 +191,7 @@ GLFWwindow* initWindow() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
   GLFWwindow* win =
       glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Interactive Invigoration", nullptr, nullptr);
@@ -62,6 +204,7 @@ GLFWwindow* initWindow() {
 
   glfwMakeContextCurrent(win);
   glfwSetFramebufferSizeCallback(win, framebufferSizeCallback);
+  glfwSetWindowRefreshCallback(win, windowRefreshCallback);
   glfwSetKeyCallback(win, keyCallback);
   glfwSetCursorPosCallback(win, mouseCallback);
   glfwSetMouseButtonCallback(win, mouseButtonCallback);
@@ -87,28 +230,144 @@ GLFWwindow* initWindow() {
 }
 
 int main(int argc, char** argv) {
-  GLFWwindow* window = initWindow();
+  // --frames N renders N frames of the tree in a hidden window and writes their time percentiles
+  int benchmarkFrames = 0;
+  const char* reportPath = nullptr;
+  const char* graphPath = nullptr;
+  const char* saveGraphPath = nullptr;
+  const char* exportPath = nullptr;
+  bool quantize = false;
+  bool expandStrands = false;
+  TreeGeneratorOptions generatorOptions;
+  bool vsync = true;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--frames" && i + 1 < argc) {
+      benchmarkFrames = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--report" && i + 1 < argc) {
+      reportPath = argv[++i];
+    } else if (arg == "--graph" && i + 1 < argc) {
+      graphPath = argv[++i];
+    } else if (arg == "--save-graph" && i + 1 < argc) {
+      saveGraphPath = argv[++i];
+    } else if (arg == "--seed" && i + 1 < argc) {
+      generatorOptions.seed = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--bundle" && i + 1 < argc) {
+      generatorOptions.maxNodeStrands = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--adaptive" && i + 1 < argc) {
+      generatorOptions.chordTolerance = std::max(0.0f, std::strtof(argv[++i], nullptr));
+    } else if (arg == "--cache" && i + 1 < argc) {
+      generatorOptions.cacheDir = argv[++i];
+    } else if (arg == "--export" && i + 1 < argc) {
+      exportPath = argv[++i];
+    } else if (arg == "--quantize") {
+      quantize = true;
+    } else if (arg == "--expand") {
+      expandStrands = true;
+    } else if (arg == "--compressed") {
+      g_meshFormat = VertexFormat::COMPRESSED;
+    } else if (arg == "--no-vsync") {
+      vsync = false;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--graph FILE] [--save-graph FILE] [--seed N]"
+                << " [--bundle N] [--adaptive TOL] [--cache DIR]"
+                << " [--export FILE.ply|FILE.glb [--quantize] [--expand]]"
+                << " [--frames N [--report FILE]] [--compressed] [--no-vsync]\n";
+      return EXIT_FAILURE;
+    }
+  }
 
-  PlantGraph pg({0.0f, 0.0f, 0.0f});  // root at origin
+  PlantGraph pg = graphPath ? loadGraph(graphPath) : createDefaultGraph();
 
-  int id1 = pg.addNode({0.0f, 2.0f, 0.0f}, 0);
-  int id2 = pg.addNode({-0.5f, 2.8f, 0.4f}, id1);
-  int id3 = pg.addNode({0.9f, 3.3f, -0.4f}, id1);
-  int id4 = pg.addNode({1.0f, 4.8f, 0.4f}, id3);
-  int id5 = pg.addNode({0.8f, 4.2f, -0.6f}, id3);
+  // conversion to the binary format only
+  if (saveGraphPath) {
+    try {
+      savePlantGraphBinary(pg, saveGraphPath);
+    } catch (const std::runtime_error& e) {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
 
-  Tree tree(pg);
+    std::cout << "Saved " << pg.getNodeCount() << " nodes to " << saveGraphPath << "\n";
+    return 0;
+  }
+
+  // mesh export only, without a window
+  if (exportPath) return exportTree(pg, generatorOptions, exportPath, quantize, expandStrands);
+
+  const bool benchmark = benchmarkFrames > 0;
+
+  // opened before the frames are rendered, so that a bad path doesn't waste the run
+  std::ofstream report;
+  if (benchmark && reportPath) {
+    report.open(reportPath);
+    if (!report.is_open()) {
+      std::cerr << "ERROR: Failed to open " << reportPath << " for writing" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  GLFWwindow* window = initWindow(!benchmark);
 
-  tree.computeStrandsPosition();
-  tree.computeCrossSections();
+  // the benchmark measures the frames themselves, not the display refresh
+  glfwSwapInterval(vsync && !benchmark ? 1 : 0);
 
-  auto mesh = tree.generateMesh();
+  // trees are generated in the background, the window stays responsive meanwhile
+  TreeGenerator generator(generatorOptions);
+  generator.setMeshWanted(g_showMesh);
+  generator.request(pg);
+  std::cout << "Generating tree...\n";
 
-  tree.initializeStrandBuffers();
+  Scene current, pending;
 
   Shader sh("shaders/basic.vert", "shaders/basic.frag");
+  Shader strandSh("shaders/strand.vert", "shaders/strand.frag");
+  Shader tubeSh("shaders/tube.vert", "shaders/strand.frag");
+
+  CameraUniformBuffer cameraUbo;
+  cameraUbo.initialize();
+
+  FrameTimer timer(PHASE_NAMES, PASS_NAMES);
+  timer.initialize();
+
+  const glm::vec3 lightDir = glm::normalize(glm::vec3(0.5f, 1.0f, 0.3f));
 
   while (!glfwWindowShouldClose(window)) {
+    // a finished tree is uploaded over the next frames, while the previous one is still drawn
+    std::unique_ptr<GeneratedTree> generated;
+    if (!pending.generated && generator.poll(generated)) {
+      pending.generated = std::move(generated);
+      pending.generated->tree->createStrandTubeBuffers();
+      if (pending.generated->hasMesh) pending.createMeshes(pending.generated->meshLODs);
+    }
+
+    // the mesh of a tree generated while it was hidden (dropped if the tree was replaced meanwhile)
+    std::shared_ptr<GeneratedTree> meshed;
+    if (generator.pollMesh(meshed) && meshed == current.generated) {
+      current.createMeshes(meshed->meshLODs);
+    }
+
+    const bool meshUploading = !current.meshes.empty() && !current.isMeshUploaded();
+
+    // nothing is drawn until the input, the camera or the geometry change. while a tree is being
+    // generated, the events are waited for with a timeout to poll the generator
+    if (!benchmark && !g_redraw && !pending.generated && !meshUploading &&
+        !isCameraMoving(window)) {
+      if (generator.isBusy())
+        glfwWaitEventsTimeout(GENERATOR_POLL_INTERVAL);
+      else
+        glfwWaitEvents();
+
+      // the time spent waiting is not a frame
+      lastTime = static_cast<float>(glfwGetTime());
+      continue;
+    }
+
+    g_redraw = false;
+    timer.beginFrame();
+    timer.beginPhase(PHASE_INPUT);
+
     // time calculation per frame
     float currentFrame = static_cast<float>(glfwGetTime());
     deltaTime = currentFrame - lastTime;
@@ -117,36 +376,287 @@ int main(int argc, char** argv) {
     // input processing
     processInput(window);
 
-    // rendering
-    glClearColor(0.20f, 0.20f, 0.20f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // trees generated while the mesh is hidden skip it
+    generator.setMeshWanted(g_showMesh);
+
+    // edits update the tree shown if it is the one of the graph and the generator doesn't use
+    // it, else a new tree is generated in the background
+    if (g_growRequested || g_moveRequested) {
+      const GraphEdit edit = g_growRequested ? growRandomBranch(pg) : moveRandomBranch(pg);
+      const bool inPlace = current.generated && !pending.generated && !generator.isBusy() &&
+                           !(current.meshRequested && current.meshes.empty()) &&
+                           isSameGraph(*current.generated->graph, pg);
+      edit.apply(pg);
+
+      if (inPlace)
+        current.edit(edit);
+      else if (generator.request(pg))
+        std::cout << "Regenerating tree...\n";
+      g_growRequested = g_moveRequested = false;
+    }
 
-    sh.use();
+    timer.beginPhase(PHASE_UPLOAD);
 
-    sh.setMat4("projection", camera.getProjectionMatrix());
-    sh.setMat4("view", camera.getViewMatrix());
-    sh.setMat4("model", glm::mat4(1.0f));
+    std::size_t budget = UPLOAD_BUDGET_PER_FRAME;
 
-    if (g_showMesh) {
-      sh.setVec3("lightDir", glm::normalize(glm::vec3(0.5f, 1.0f, 0.3f)));
-      sh.setVec3("viewPos", camera.getPosition());
-      mesh.render();
+    if (meshUploading) current.uploadMeshes(budget);
+
+    if (pending.generated) {
+      if (pending.generated->tree->uploadStrandTubes(budget) &&
+          (pending.meshes.empty() || pending.uploadMeshes(budget))) {
+        std::cout << "Tree generated in " << pending.generated->seconds << " s"
+                  << (pending.generated->cached ? " (cached strands)\n" : "\n");
+
+        current.deleteBuffers();
+        current = std::move(pending);
+        pending = Scene{};
+      }
     }
 
-    if (g_showStrands) {
-      tree.renderStrands(sh);
+    timer.beginPhase(PHASE_DRAW);
+
+    // rendering
+    glClearColor(0.20f, 0.20f, 0.20f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // camera block shared by all the programs
+    cameraUbo.update(
+        camera.getProjectionMatrix(), camera.getViewMatrix(), camera.getPosition(), lightDir
+    );
+
+    if (current.generated) {
+      Tree& tree = *current.generated->tree;
+
+      // trees generated while the mesh was hidden get it (and their cross sections) from the
+      // generator when it is first shown, and draw it once it is uploaded
+      if (g_showMesh && current.meshes.empty() && !current.meshRequested) {
+        current.meshRequested = generator.requestMesh(current.generated);
+      }
+
+      timer.beginPhase(PHASE_CULLING);
+
+      // only the branch segments in the view frustum are drawn, at a detail that depends on how
+      // many pixels their strands cover
+      int framebufferWidth, framebufferHeight;
+      glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+      float pixelsPerUnit =
+          framebufferHeight / (2.0f * std::tan(glm::radians(camera.getFov()) / 2.0f));
+
+      tree.cullBranches(
+          camera.getFrustum(), camera.getPosition(), g_strandLOD ? pixelsPerUnit : 0.0f
+      );
+
+      timer.beginPhase(PHASE_DRAW);
+
+      if (g_showMesh && !current.meshes.empty() && current.isMeshUploaded()) {
+        timer.beginPass(PASS_MESH);
+
+        // coarsest level whose error stays under a pixel at the closest visible branch
+        int level = 0;
+        if (g_strandLOD) {
+          level = selectLOD(
+              current.meshLODs, tree.getCullingStats().closestDistance, pixelsPerUnit,
+              MAX_MESH_SCREEN_ERROR
+          );
+        }
+        const Mesh& mesh = *current.meshes[level];
+
+        sh.use();
+        sh.setMat4("model", glm::mat4(1.0f));
+        sh.setVec3("positionOffset", mesh.getPositionOffset());
+        sh.setVec3("positionScale", mesh.getPositionScale());
+        mesh.render(tree.getVisibleNodes());
+
+        timer.endPass();
+      }
+
+      if (g_showStrands) timer.beginPass(PASS_STRANDS);
+
+      if (g_showStrands && g_shaderTubes) {
+        tubeSh.use();
+        tubeSh.setMat4("model", glm::mat4(1.0f));
+
+        tree.renderStrandTubes(tubeSh);
+      } else if (g_showStrands) {
+        // the cpu generated cylinders are only built if asked for
+        if (!current.cylindersInitialized) {
+          tree.initializeStrandBuffers();
+          current.cylindersInitialized = true;
+        }
+
+        strandSh.use();
+        strandSh.setMat4("model", glm::mat4(1.0f));
+
+        tree.renderStrands();
+      }
+
+      timer.endPass();
+
+      if (g_printCullingStats) {
+        const CullingStats& stats = tree.getCullingStats();
+        std::cout << "Visible branches: " << stats.visibleBranches << "/" << stats.totalBranches
+                  << ", strand segments: " << stats.visibleInstances << "/"
+                  << stats.totalInstances << ", boxes tested: " << stats.testedBoxes << "\n";
+        std::cout << "Branches per strand LOD:";
+        for (int count : stats.branchesPerLOD) std::cout << " " << count;
+        std::cout << "\n";
+        std::cout << "Closest visible branch: " << stats.closestDistance << "\n";
+
+        timer.printSummary(std::cout);
+        timer.clear();
+        g_printCullingStats = false;
+      }
     }
 
     // glfw processes
+    timer.beginPhase(PHASE_SWAP);
     glfwSwapBuffers(window);
+
+    timer.beginPhase(PHASE_INPUT);
     glfwPollEvents();
+
+    // the benchmark only counts the frames of a generated tree
+    if (benchmark && !current.generated) continue;
+    timer.endFrame();
+
+    if (benchmark && timer.getFrameCount() >= benchmarkFrames) break;
   }
 
+  if (benchmark) timer.writePercentiles(reportPath ? report : std::cout);
+
+  timer.deleteQueries();
+  current.deleteBuffers();
+  pending.deleteBuffers();
+
   clear(window);
 
   return 0;
 }
 
+PlantGraph createDefaultGraph() {
+  PlantGraph pg({0.0f, 0.0f, 0.0f});  // root at origin
+
+  int id1 = pg.addNode({0.0f, 2.0f, 0.0f}, 0);
+  int id2 = pg.addNode({-0.5f, 2.8f, 0.4f}, id1);
+  int id3 = pg.addNode({0.9f, 3.3f, -0.4f}, id1);
+  int id4 = pg.addNode({1.0f, 4.8f, 0.4f}, id3);
+  int id5 = pg.addNode({0.8f, 4.2f, -0.6f}, id3);
+
+  return pg;
+}
+
+PlantGraph loadGraph(const char* path) {
+  try {
+    auto start = std::chrono::steady_clock::now();
+    PlantGraph pg = loadPlantGraph(path);
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Loaded " << pg.getNodeCount() << " nodes from " << path << " in "
+              << elapsed.count() << " s\n";
+    return pg;
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+int exportTree(
+    PlantGraph& pg, const TreeGeneratorOptions& options, const char* path, bool quantize,
+    bool expandStrands
+) {
+  try {
+    auto start = std::chrono::steady_clock::now();
+
+    Tree tree(pg);
+    tree.setSeed(options.seed);
+    tree.setStrandBundling(options.maxNodeStrands);
+    tree.setAdaptiveSampling(options.chordTolerance);
+    // (cached strands don't know their bundles, and expanded ones get new cross sections)
+    tree.setEagerCrossSections(!expandStrands);
+    if (options.cacheDir.empty() || expandStrands)
+      tree.computeStrandsPosition();
+    else
+      tree.computeStrandsPosition(options.cacheDir);
+
+    // full detail: the mesh of every individual strand, the layouts still packed as bundles
+    if (expandStrands) tree.expandSuperStrands({0});
+
+    MeshData data = tree.generateMeshData(true);
+
+    MeshExportOptions exportOptions;
+    exportOptions.strandColors = tree.getStrandColors();
+    exportOptions.quantize = quantize;
+    exportMesh(data, path, exportOptions);
+
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Exported " << data.indices.size() << " triangles to " << path << " in "
+              << elapsed.count() << " s\n";
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
+
+void printMeshMemory(const std::vector<std::unique_ptr<Mesh>>& meshes) {
+  // gpu memory of the levels of detail in both vertex formats
+  for (VertexFormat format : {VertexFormat::FULL, VertexFormat::COMPRESSED}) {
+    MeshMemory total;
+    for (const auto& mesh : meshes) {
+      MeshMemory memory = Mesh::computeMemoryUsage(
+          mesh->getVertexCount(), mesh->getTriangleCount(), true, format
+      );
+      total.vertexBytes += memory.vertexBytes;
+      total.indexBytes += memory.indexBytes;
+    }
+
+    std::cout << (format == VertexFormat::FULL ? "Full" : "Compressed") << " mesh memory ("
+              << meshes.size() << " levels of detail): " << total.vertexBytes / 1024.0f
+              << " KB vertices + " << total.indexBytes / 1024.0f << " KB indices\n";
+  }
+}
+
+GraphEdit growRandomBranch(const PlantGraph& pg) {
+  std::uniform_int_distribution<int> node(0, pg.getNodeCount() - 1);
+  std::uniform_real_distribution<float> offset(-0.6f, 0.6f);
+
+  // new branch going upwards from a random node
+  int parentId = node(g_editRng);
+  glm::vec3 pos = pg.getNode(parentId).pos + glm::vec3{offset(g_editRng), 0.8f, offset(g_editRng)};
+  return {true, parentId, pos};
+}
+
+GraphEdit moveRandomBranch(const PlantGraph& pg) {
+  if (pg.getNodeCount() < 2) return growRandomBranch(pg);
+
+  std::uniform_int_distribution<int> node(1, pg.getNodeCount() - 1);
+  std::uniform_real_distribution<float> offset(-0.2f, 0.2f);
+
+  // a random node other than the root, moved a little
+  int nodeId = node(g_editRng);
+  glm::vec3 pos = pg.getNode(nodeId).pos +
+                  glm::vec3{offset(g_editRng), offset(g_editRng), offset(g_editRng)};
+  return {false, nodeId, pos};
+}
+
+bool isSameGraph(const PlantGraph& a, const PlantGraph& b) {
+  if (a.getNodeCount() != b.getNodeCount()) return false;
+
+  for (int id = 0; id < a.getNodeCount(); ++id) {
+    const Node &nodeA = a.getNode(id), &nodeB = b.getNode(id);
+    if (nodeA.parentId != nodeB.parentId || nodeA.pos != nodeB.pos) return false;
+  }
+  return true;
+}
+
+bool isCameraMoving(GLFWwindow* window) {
+  for (int key : {GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D}) {
+    if (glfwGetKey(window, key) == GLFW_PRESS) return true;
+  }
+  return false;
+}
+
 void processInput(GLFWwindow* window) {
   if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
     camera.move(Camera::Direction::FORWARD, deltaTime);  //
@@ -160,10 +670,15 @@ void processInput(GLFWwindow* window) {
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
   glViewport(0, 0, width, height);
+  g_redraw = true;
 }
 
+void windowRefreshCallback(GLFWwindow* window) { g_redraw = true; }
+
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
   if (action == GLFW_PRESS) {
+    g_redraw = true;
+
     switch (key) {
       case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, true); break;
       case GLFW_KEY_F:
@@ -177,6 +692,11 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
                   << "H - Show this help message\n"
                   << "M - Toggle mesh visualization\n"
                   << "T - Toggle strands visualization\n"
+                  << "C - Toggle shader/CPU generated strand tubes\n"
+                  << "I - Print frustum culling statistics and frame times\n"
+                  << "L - Toggle strand and mesh level of detail\n"
+                  << "E - Grow a random branch (the tree is updated in place)\n"
+                  << "R - Move a random branch (the tree is updated in place)\n"
                   << "F - Toggle wireframe mode\n"
                   << "WASD - Move camera position\n"
                   << "Middle Mouse Drag - Rotate camera\n"
@@ -192,12 +712,25 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         g_showStrands = !g_showStrands;
         std::cout << "Strand visualization: " << (g_showStrands ? "ON" : "OFF") << "\n";
         break;
+      case GLFW_KEY_C:
+        g_shaderTubes = !g_shaderTubes;
+        std::cout << "Strand tubes: " << (g_shaderTubes ? "SHADER" : "CPU") << "\n";
+        break;
+      case GLFW_KEY_L:
+        g_strandLOD = !g_strandLOD;
+        std::cout << "Level of detail: " << (g_strandLOD ? "ON" : "OFF") << "\n";
+        break;
+      case GLFW_KEY_I: g_printCullingStats = true; break;
+      case GLFW_KEY_E: g_growRequested = true; break;
+      case GLFW_KEY_R: g_moveRequested = true; break;
       default: break;
     }
   }
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+  g_redraw = true;
+
   if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
     g_panningCamera = true;
     glfwGetCursorPos(window, &g_panLastX, &g_panLastY);
@@ -225,6 +758,7 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
     float dy = static_cast<float>(g_lastY - ypos);
 
     camera.rotate(dx, dy);
+    g_redraw = true;
 
     g_lastX = xpos;
     g_lastY = ypos;
@@ -233,6 +767,7 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
     float dy = static_cast<float>(ypos - g_panLastY);
 
     camera.pan(dx, dy);
+    g_redraw = true;
 
     g_panLastX = xpos;
     g_panLastY = ypos;
@@ -241,6 +776,7 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
   camera.zoom(static_cast<float>(yoffset));
+  g_redraw = true;
 }
 
 void clear(GLFWwindow* window) {
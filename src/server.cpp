@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/GenerationProtocol.h"
+#include "core/Hash.h"
+#include "core/Parallel.h"
+#include "core/PlantGraph.h"
+#include "core/PlantGraphIO.h"
+#include "core/StrandDataset.h"
+#include "core/TaskGraph.h"
+#include "core/Tree.h"
+#include "geometry/MeshExport.h"
+
+// the accept loop checks for a stop signal at least this often
+constexpr int ACCEPT_POLL_MILLISECONDS = 200;
+constexpr std::size_t DEFAULT_CACHE_MB = 256;
+
+struct ServerOptions {
+  unsigned int threads{parallel::getNumThreads()};
+  std::size_t cacheBytes{DEFAULT_CACHE_MB << 20};  // recently generated trees
+  std::string layoutCacheDir{};                    // strand layout cache on disk (none if empty)
+};
+
+// a client connection. the requests of every channel are numbered: only the latest one of a
+// channel is still wanted
+class Connection {
+ private:
+  const int fd;
+  std::atomic<bool> open{true};
+
+  std::mutex writeMutex;
+
+  std::mutex channelMutex;
+  std::uint64_t lastSequence{0};
+  std::unordered_map<std::uint32_t, std::uint64_t> latestRequests;  // by channel
+
+ public:
+  explicit Connection(int _fd) : fd{_fd} {}
+  ~Connection() { close(fd); }
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  int getFd() const { return fd; }
+  bool isOpen() const { return open; }
+  void setClosed() { open = false; }
+
+  // number of a new request, which supersedes the previous ones of its channel
+  std::uint64_t addRequest(std::uint32_t channel) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    latestRequests[channel] = ++lastSequence;
+    return lastSequence;
+  }
+
+  bool isWanted(std::uint32_t channel, std::uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    return open && latestRequests[channel] == sequence;
+  }
+
+  // the responses of the workers are written one at a time. a failure closes the connection
+  void send(std::initializer_list<MessagePart> parts) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (!open) return;
+
+    try {
+      writeMessage(fd, parts);
+    } catch (const std::runtime_error&) {
+      setClosed();
+    }
+  }
+};
+
+struct Job {
+  std::shared_ptr<Connection> connection;
+  GenerationRequest request;
+  std::uint64_t sequence;
+  std::vector<char> graph;  // plant graph file contents
+};
+
+// encoded outputs of a generated tree
+struct GeneratedOutputs {
+  std::string mesh, strands;
+  float seconds{};
+  int nodes{};
+  std::size_t triangles{};
+
+  std::size_t getBytes() const { return mesh.size() + strands.size(); }
+};
+
+// least recently used outputs, up to a total size
+class OutputCache {
+ private:
+  using Entry = std::pair<std::uint64_t, std::shared_ptr<const GeneratedOutputs>>;
+
+  const std::size_t capacity;
+  std::size_t bytes{0};
+  std::list<Entry> entries;  // most recently used first
+  std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+  std::mutex mutex;
+
+ public:
+  explicit OutputCache(std::size_t _capacity) : capacity{_capacity} {}
+
+  std::shared_ptr<const GeneratedOutputs> get(std::uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) return nullptr;
+
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+
+  void put(std::uint64_t key, std::shared_ptr<const GeneratedOutputs> outputs) {
+    if (outputs->getBytes() > capacity) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index.count(key)) return;
+
+    bytes += outputs->getBytes();
+    entries.emplace_front(key, std::move(outputs));
+    index[key] = entries.begin();
+
+    while (bytes > capacity) {
+      bytes -= entries.back().second->getBytes();
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+  }
+};
+
+// requests waiting for a worker
+class JobQueue {
+ private:
+  std::deque<Job> jobs;
+  bool stopping{false};
+  std::mutex mutex;
+  std::condition_variable available;
+
+ public:
+  void push(Job job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(std::move(job));
+    }
+    available.notify_one();
+  }
+
+  // false once the queue is stopped
+  bool pop(Job& job) {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+    if (stopping) return false;
+
+    job = std::move(jobs.front());
+    jobs.pop_front();
+    return true;
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    available.notify_all();
+  }
+};
+
+std::atomic<bool> g_stopping{false};
+std::atomic<int> g_activeReaders{0};
+std::mutex g_logMutex;
+
+void handleStopSignal(int) { g_stopping = true; }
+
+void readRequests(std::shared_ptr<Connection> connection, JobQueue& queue);
+void runWorker(JobQueue& queue, OutputCache& cache, const ServerOptions& options);
+std::shared_ptr<const GeneratedOutputs> generate(const Job& job, const ServerOptions& options);
+void sendResponse(
+    const Job& job, ResponseStatus status, const GeneratedOutputs* outputs = nullptr,
+    bool cached = false, const std::string& error = {}
+);
+
+int main(int argc, char** argv) {
+  ServerOptions options;
+  const char* socketPath = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      options.threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--cache-mb" && i + 1 < argc) {
+      options.cacheBytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+    } else if (arg == "--layout-cache" && i + 1 < argc) {
+      options.layoutCacheDir = argv[++i];
+    } else if (arg.rfind("--", 0) != 0 && !socketPath) {
+      socketPath = argv[i];
+    } else {
+      socketPath = nullptr;
+      break;
+    }
+  }
+
+  if (!socketPath) {
+    std::cerr << "Usage: " << argv[0] << " SOCKET [--threads N] [--cache-mb MB]"
+              << " [--layout-cache DIR]\n";
+    return EXIT_FAILURE;
+  }
+
+  int listener;
+  try {
+    listener = listenUnixSocket(socketPath);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::signal(SIGPIPE, SIG_IGN);  // closed connections are reported by write
+  std::signal(SIGINT, handleStopSignal);
+  std::signal(SIGTERM, handleStopSignal);
+
+  JobQueue queue;
+  OutputCache cache(options.cacheBytes);
+
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < options.threads; ++t) {
+    workers.emplace_back(runWorker, std::ref(queue), std::ref(cache), std::cref(options));
+  }
+
+  std::cout << "Listening on " << socketPath << " with " << options.threads << " workers"
+            << std::endl;
+
+  // one reader thread per connection
+  std::vector<std::weak_ptr<Connection>> connections;
+
+  while (!g_stopping) {
+    pollfd pending{listener, POLLIN, 0};
+    if (poll(&pending, 1, ACCEPT_POLL_MILLISECONDS) <= 0) continue;
+
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) continue;
+
+    connections.erase(
+        std::remove_if(
+            connections.begin(), connections.end(),
+            [](const std::weak_ptr<Connection>& weak) { return weak.expired(); }
+        ),
+        connections.end()
+    );
+
+    auto connection = std::make_shared<Connection>(fd);
+    connections.push_back(connection);
+
+    g_activeReaders++;
+    std::thread(readRequests, connection, std::ref(queue)).detach();
+  }
+
+  // stop the workers (the queued requests are dropped), then wake the readers up
+  std::cout << "Stopping" << std::endl;
+  close(listener);
+  try {
+    removeUnixSocket(socketPath);
+  } catch (const std::runtime_error& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+  }
+
+  queue.stop();
+  for (auto& worker : workers) worker.join();
+
+  for (auto& weak : connections) {
+    if (auto connection = weak.lock()) shutdown(connection->getFd(), SHUT_RDWR);
+  }
+  while (g_activeReaders > 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  return 0;
+}
+
+void readRequests(std::shared_ptr<Connection> connection, JobQueue& queue) {
+  std::vector<char> message;
+
+  try {
+    while (!g_stopping && readMessage(connection->getFd(), message)) {
+      Job job;
+      job.connection = connection;
+
+      if (message.size() < sizeof(job.request)) throw std::runtime_error("truncated request");
+      std::memcpy(&job.request, message.data(), sizeof(job.request));
+      if (std::memcmp(job.request.magic, GENERATION_REQUEST_MAGIC, 4) != 0)
+        throw std::runtime_error("not a generation request");
+
+      job.sequence = connection->addRequest(job.request.channel);
+      job.graph.assign(message.begin() + sizeof(job.request), message.end());
+
+      queue.push(std::move(job));
+    }
+  } catch (const std::runtime_error& e) {
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    std::cerr << "ERROR: Connection dropped: " << e.what() << std::endl;
+  }
+
+  // the pending requests of the connection are not wanted anymore
+  connection->setClosed();
+  g_activeReaders--;
+}
+
+void runWorker(JobQueue& queue, OutputCache& cache, const ServerOptions& options) {
+  // the requests already keep every core busy
+  parallel::serialThread = options.threads > 1;
+
+  for (Job job; queue.pop(job);) {
+    const GenerationRequest& request = job.request;
+    if (!job.connection->isWanted(request.channel, job.sequence)) {
+      sendResponse(job, RESPONSE_CANCELLED);
+      continue;
+    }
+
+    // the same graph, parameters and outputs give the same tree
+    std::uint64_t key = hashBytes(job.graph.data(), job.graph.size());
+    key = hashValue(request.seed, key);
+    key = hashValue(request.maxNodeStrands, key);
+    key = hashValue(request.flags, key);
+
+    std::shared_ptr<const GeneratedOutputs> outputs = cache.get(key);
+    const bool cached = outputs != nullptr;
+
+    try {
+      if (!outputs) {
+        outputs = generate(job, options);
+        cache.put(key, outputs);
+      }
+    } catch (const TaskGraph::Cancelled&) {
+      sendResponse(job, RESPONSE_CANCELLED);
+      continue;
+    } catch (const std::exception& e) {
+      sendResponse(job, RESPONSE_FAILED, nullptr, false, e.what());
+      continue;
+    }
+
+    sendResponse(job, RESPONSE_OK, outputs.get(), cached);
+  }
+}
+
+std::shared_ptr<const GeneratedOutputs> generate(const Job& job, const ServerOptions& options) {
+  const GenerationRequest& request = job.request;
+
+  // superseded requests stop between the steps, and between the tasks of the tree
+  auto isCancelled = [&job]() {
+    return !job.connection->isWanted(job.request.channel, job.sequence);
+  };
+  auto checkWanted = [&isCancelled]() {
+    if (isCancelled()) throw TaskGraph::Cancelled{};
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  auto outputs = std::make_shared<GeneratedOutputs>();
+
+  PlantGraph pg = parsePlantGraph(job.graph.data(), job.graph.size(), "request");
+  outputs->nodes = pg.getNodeCount();
+  checkWanted();
+
+  Tree tree(pg);
+  tree.setSeed(request.seed);
+  tree.setStrandBundling(std::min<std::uint32_t>(request.maxNodeStrands, INT_MAX));
+  // (cached strands don't know their bundles, and expanded ones get new cross sections)
+  const bool expand = request.flags & REQUEST_EXPAND;
+  tree.setEagerCrossSections((request.flags & REQUEST_MESH) && !expand);
+  tree.setCancellation(isCancelled);
+  if (options.layoutCacheDir.empty() || expand)
+    tree.computeStrandsPosition();
+  else
+    tree.computeStrandsPosition(options.layoutCacheDir);
+  checkWanted();
+
+  if (expand) tree.expandSuperStrands({0});
+
+  if (request.flags & REQUEST_MESH) {
+    MeshData data = tree.generateMeshData(true);
+    outputs->triangles = data.indices.size();
+
+    MeshExportOptions exportOptions;
+    exportOptions.strandColors = tree.getStrandColors();
+    exportOptions.quantize = request.flags & REQUEST_QUANTIZE;
+
+    std::ostringstream mesh;
+    exportGLB(data, mesh, exportOptions);
+    outputs->mesh = mesh.str();
+  }
+
+  if (request.flags & REQUEST_STRANDS) {
+    std::ostringstream strands;
+    writeStrandDataset(tree.generateStrandData(), strands);
+    outputs->strands = strands.str();
+  }
+
+  std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+  outputs->seconds = elapsed.count();
+
+  return outputs;
+}
+
+void sendResponse(
+    const Job& job, ResponseStatus status, const GeneratedOutputs* outputs, bool cached,
+    const std::string& error
+) {
+  GenerationResponse response{};
+  std::memcpy(response.magic, GENERATION_RESPONSE_MAGIC, sizeof(GENERATION_RESPONSE_MAGIC));
+  response.id = job.request.id;
+  response.status = status;
+  response.cached = cached;
+
+  if (outputs) {
+    response.seconds = outputs->seconds;
+    response.meshBytes = outputs->mesh.size();
+    response.strandBytes = outputs->strands.size();
+
+    job.connection->send({
+        {&response, sizeof(response)},
+        {outputs->mesh.data(), outputs->mesh.size()},
+        {outputs->strands.data(), outputs->strands.size()}
+    });
+  } else {
+    job.connection->send({{&response, sizeof(response)}, {error.data(), error.size()}});
+  }
+
+  std::lock_guard<std::mutex> lock(g_logMutex);
+  std::cout << "Request " << job.request.id << " (channel " << job.request.channel << "): ";
+  if (status == RESPONSE_OK) {
+    std::cout << outputs->nodes << " nodes, " << outputs->triangles << " triangles"
+              << (cached ? " (cached)" : " in " + std::to_string(outputs->seconds) + " s");
+  } else if (status == RESPONSE_CANCELLED) {
+    std::cout << "cancelled";
+  } else {
+    std::cout << "failed: " << error;
+  }
+  std::cout << std::endl;
+}
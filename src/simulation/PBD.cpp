@@ -1,10 +1,16 @@
 #include "simulation/PBD.h"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/geometric.hpp>
 
+#include "core/Parallel.h"
 #include "simulation/PBDConstraint.h"
 
 std::vector<glm::vec3> PBD::execute(int iterations, glm::vec3 profileCenter, float profileRadius) {
@@ -22,6 +28,70 @@ std::vector<glm::vec3> PBD::execute(int iterations, glm::vec3 profileCenter, flo
   return x;
 }
 
+std::vector<glm::vec3> PBD::executeMultilevel(
+    int iterations, glm::vec3 profileCenter, float profileRadius,
+    const std::vector<std::vector<int>>& clusters
+) {
+  const int n = x.size();
+  const int clusterCount = clusters.size();
+
+  auto levelIterations = [&](int points) {
+    return std::max(
+        MULTILEVEL_MIN_ITERATIONS,
+        static_cast<int>(static_cast<long long>(iterations) * points / std::max(n, 1))
+    );
+  };
+
+  // 1. clusters as disks with the area of their points (at their area weighted centroid). this is
+  // where the points travel the most, and the disks are few: they get all the iterations
+  std::vector<glm::vec3> centers(clusterCount, glm::vec3{0.0f});
+  std::vector<float> clusterRadii(clusterCount);
+  for (int k = 0; k < clusterCount; ++k) {
+    float area = 0.0f;
+    for (int i : clusters[k]) {
+      const float r2 = getRadius(i) * getRadius(i);
+      centers[k] += r2 * x[i];
+      area += r2;
+    }
+
+    centers[k] /= area;
+    clusterRadii[k] = MULTILEVEL_CLUSTER_PACKING * std::sqrt(area);
+  }
+
+  PBD coarse(centers, attractors, kdamping, dt, particleRadius, profileCenter, profileRadius);
+  coarse.setRadii(clusterRadii);
+  const std::vector<glm::vec3> packedCenters =
+      coarse.execute(iterations, profileCenter, profileRadius);
+
+  // 2. points of every cluster moved with it, and packed around its center
+  std::vector<glm::vec3> points(n);
+  parallel::forRange(0, clusterCount, [&](int k) {
+    const std::vector<int>& cluster = clusters[k];
+    const glm::vec3 offset = packedCenters[k] - centers[k];
+
+    std::vector<glm::vec3> clusterPoints;
+    std::vector<float> clusterPointRadii;
+    for (int i : cluster) {
+      clusterPoints.push_back(x[i] + offset);
+      clusterPointRadii.push_back(getRadius(i));
+    }
+
+    PBD fine(
+        clusterPoints, {packedCenters[k]}, kdamping, dt, particleRadius, packedCenters[k],
+        clusterRadii[k]
+    );
+    if (!radii.empty()) fine.setRadii(clusterPointRadii);
+    clusterPoints =
+        fine.execute(levelIterations(cluster.size()), packedCenters[k], clusterRadii[k]);
+
+    for (int j = 0; j < cluster.size(); ++j) points[cluster[j]] = clusterPoints[j];
+  });
+
+  // 3. short global polish
+  x = points;
+  return execute(MULTILEVEL_POLISH_ITERATIONS, profileCenter, profileRadius);
+}
+
 void PBD::simulate() {
   for (int i = 0; i < x.size(); ++i) {
     v[i] += computeExternalForces(i);
@@ -42,14 +112,7 @@ void PBD::simulate() {
 
   for (int i = 0; i < SOLVER_INTERATIONS; ++i) {
     std::set<std::pair<int, int>> mcoll;
-    for (int i = 0; i < p.size() - 1; ++i) {
-      for (int j = i + 1; j < p.size(); ++j) {
-        glm::vec3 u = p[i] - p[j];
-        if (glm::length(u) < 2 * particleRadius) {
-          mcoll.insert(std::make_pair(i, j));
-        }
-      }
-    }
+    findCollisions(p, particleRadius, radii, mcoll);
 
     solve(mcoll);
   }
@@ -63,6 +126,83 @@ void PBD::simulate() {
   // velocityUpdate();
 }
 
+// (the grid cells are as wide as the largest diameter, so that only the points of neighbouring
+// cells are compared)
+void findCollisions(
+    const std::vector<glm::vec3>& p, float particleRadius, const std::vector<float>& radii,
+    std::set<std::pair<int, int>>& mcoll
+) {
+  const int n = p.size();
+
+  auto getRadius = [&](int idx) { return radii.empty() ? particleRadius : radii[idx]; };
+  auto test = [&](int i, int j) {
+    glm::vec3 u = p[i] - p[j];
+    if (glm::length(u) < getRadius(i) + getRadius(j)) {
+      mcoll.insert(std::make_pair(i, j));
+    }
+  };
+
+  glm::vec3 lo{std::numeric_limits<float>::max()}, hi{-std::numeric_limits<float>::max()};
+  for (const auto& q : p) {
+    lo = glm::min(lo, q);
+    hi = glm::max(hi, q);
+  }
+
+  float cellSize = particleRadius;
+  for (float r : radii) cellSize = std::max(cellSize, r);
+  cellSize *= 2.0f;
+
+  // cell coordinates are packed in 21 bits each (diverged points are compared directly)
+  constexpr float MAX_CELLS = 1 << 20;
+  const glm::vec3 cells = (hi - lo) / cellSize;
+  const bool useGrid = n >= COLLISION_GRID_POINTS && cells.x < MAX_CELLS && cells.y < MAX_CELLS &&
+                       cells.z < MAX_CELLS;
+
+  if (!useGrid) {
+    for (int i = 0; i + 1 < n; ++i) {
+      for (int j = i + 1; j < n; ++j) test(i, j);
+    }
+    return;
+  }
+
+  auto cellOf = [&](const glm::vec3& q) {
+    glm::vec3 c = (q - lo) / cellSize;
+    return std::array<std::uint64_t, 3>{
+        static_cast<std::uint64_t>(c.x), static_cast<std::uint64_t>(c.y),
+        static_cast<std::uint64_t>(c.z)
+    };
+  };
+  auto key = [](std::uint64_t x, std::uint64_t y, std::uint64_t z) {
+    return (x << 42) | (y << 21) | z;
+  };
+
+  std::unordered_map<std::uint64_t, std::vector<int>> grid;
+  for (int i = 0; i < n; ++i) {
+    auto c = cellOf(p[i]);
+    grid[key(c[0], c[1], c[2])].push_back(i);
+  }
+
+  for (int i = 0; i < n; ++i) {
+    auto c = cellOf(p[i]);
+
+    // the cells around (coordinates are offset by one so that they stay unsigned)
+    for (std::uint64_t x = c[0]; x <= c[0] + 2; ++x) {
+      for (std::uint64_t y = c[1]; y <= c[1] + 2; ++y) {
+        for (std::uint64_t z = c[2]; z <= c[2] + 2; ++z) {
+          if (x == 0 || y == 0 || z == 0) continue;
+
+          auto cell = grid.find(key(x - 1, y - 1, z - 1));
+          if (cell == grid.end()) continue;
+
+          for (int j : cell->second) {
+            if (j > i) test(i, j);
+          }
+        }
+      }
+    }
+  }
+}
+
 glm::vec3 PBD::computeExternalForces(int idx) {
   glm::vec3 force{0.0f};
 
@@ -86,6 +226,7 @@ void PBD::solve(const std::set<std::pair<int, int>>& mcoll) {
   // collision constraints
   for (auto& [i, j] : mcoll) {
     collisionConstraint.setPoints({p[i], p[j]});
+    if (!radii.empty()) collisionConstraint.setRadius(0.5f * (radii[i] + radii[j]));
 
     if (!collisionConstraint.isSatisfied()) {
       auto correction = collisionConstraint.computeCorrection();
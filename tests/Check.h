@@ -0,0 +1,29 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <cstdlib>
+#include <iostream>
+
+// assertions of the test executables (kept in release builds): a failed check prints the
+// condition and its location, and exits with a failure status
+#define CHECK(condition)                                                                   \
+  do {                                                                                     \
+    if (!(condition)) {                                                                    \
+      std::cerr << "FAILED: " << __FILE__ << ":" << __LINE__ << ": " #condition "\n";      \
+      std::exit(EXIT_FAILURE);                                                             \
+    }                                                                                      \
+  } while (0)
+
+// `statement` must throw an exception of type `type`
+#define CHECK_THROWS(statement, type)  \
+  do {                                 \
+    bool thrown = false;               \
+    try {                              \
+      statement;                       \
+    } catch (const type&) {            \
+      thrown = true;                   \
+    }                                  \
+    CHECK(thrown && #statement);       \
+  } while (0)
+
+#endif
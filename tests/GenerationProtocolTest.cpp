@@ -0,0 +1,88 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Check.h"
+#include "core/GenerationProtocol.h"
+
+namespace {
+
+const std::string SOCKET_PATH = "GenerationProtocolTest.sock";
+
+bool isSocket(const std::string& path) {
+  struct stat status;
+  return lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode);
+}
+
+// messages written in several parts are read back whole, in order, until the peer closes
+void checkMessages() {
+  const int listener = listenUnixSocket(SOCKET_PATH);
+  CHECK(isSocket(SOCKET_PATH));
+
+  const int client = connectUnixSocket(SOCKET_PATH);
+  const int server = accept(listener, nullptr, nullptr);
+  CHECK(server >= 0);
+
+  GenerationRequest request{};
+  std::memcpy(request.magic, GENERATION_REQUEST_MAGIC, sizeof(request.magic));
+  request.id = 7;
+  request.flags = REQUEST_MESH | REQUEST_STRANDS;
+  const std::string graph = "0 -1 0 0 0\n1 0 0 1 0\n";
+
+  writeMessage(client, {{&request, sizeof(request)}, {graph.data(), graph.size()}});
+  writeMessage(client, {});
+
+  std::vector<char> payload;
+  CHECK(readMessage(server, payload));
+  CHECK(payload.size() == sizeof(request) + graph.size());
+
+  GenerationRequest received;
+  std::memcpy(&received, payload.data(), sizeof(received));
+  CHECK(std::memcmp(received.magic, GENERATION_REQUEST_MAGIC, sizeof(received.magic)) == 0);
+  CHECK(received.id == 7 && received.flags == (REQUEST_MESH | REQUEST_STRANDS));
+  CHECK(std::string(payload.begin() + sizeof(request), payload.end()) == graph);
+
+  CHECK(readMessage(server, payload) && payload.empty());
+
+  // a closed connection ends the messages, unless it is closed in the middle of one
+  const std::uint32_t truncatedSize = 16;
+  CHECK(write(client, &truncatedSize, sizeof(truncatedSize)) == sizeof(truncatedSize));
+  close(client);
+  CHECK_THROWS(readMessage(server, payload), std::runtime_error);
+
+  close(server);
+  close(listener);
+
+  // the stale socket of a stopped server is replaced
+  close(listenUnixSocket(SOCKET_PATH));
+  removeUnixSocket(SOCKET_PATH);
+  CHECK(!isSocket(SOCKET_PATH));
+  removeUnixSocket(SOCKET_PATH);  // (nothing to remove)
+}
+
+// a path that is not a socket is never deleted
+void checkNotSocket() {
+  std::ofstream(SOCKET_PATH) << "not a socket";
+
+  CHECK_THROWS(listenUnixSocket(SOCKET_PATH), std::runtime_error);
+  CHECK_THROWS(removeUnixSocket(SOCKET_PATH), std::runtime_error);
+  CHECK(std::ifstream(SOCKET_PATH).good());
+
+  unlink(SOCKET_PATH.c_str());
+}
+
+}  // namespace
+
+int main() {
+  checkMessages();
+  checkNotSocket();
+
+  return 0;
+}
@@ -0,0 +1,253 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "geometry/MeshExport.h"
+
+namespace {
+
+// random mesh: `strandCount` strands with their colors, and triangles over all the vertices
+MeshData createTestMesh(int vertexCount, int triangleCount, int strandCount, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> coordinate(-2.0f, 5.0f), direction(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> vertex(0, vertexCount - 1), strand(0, strandCount - 1);
+
+  MeshData data;
+  for (int i = 0; i < vertexCount; ++i) {
+    data.vertices.emplace_back(coordinate(rng), coordinate(rng), coordinate(rng));
+    data.normals.push_back(
+        glm::normalize(glm::vec3(direction(rng), direction(rng), direction(rng)) + 1e-3f)
+    );
+    data.strandIds.push_back(strand(rng));
+  }
+  for (int i = 0; i < triangleCount; ++i) data.indices.emplace_back(vertex(rng), vertex(rng), i);
+  data.indices.back().z = vertexCount - 1;
+
+  return data;
+}
+
+std::vector<glm::vec4> createStrandColors(int strandCount) {
+  std::vector<glm::vec4> colors;
+  for (int i = 0; i < strandCount; ++i) {
+    colors.emplace_back(static_cast<float>(i) / strandCount, 0.5f, 1.0f, 1.0f);
+  }
+
+  return colors;
+}
+
+template <typename T>
+T read(const std::string& bytes, std::size_t offset) {
+  CHECK(offset + sizeof(T) <= bytes.size());
+
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+std::uint8_t toByte(float channel) { return static_cast<std::uint8_t>(std::round(channel * 255)); }
+
+void checkColor(const std::string& bytes, std::size_t offset, const glm::vec4& color) {
+  for (int c = 0; c < 4; ++c) CHECK(read<std::uint8_t>(bytes, offset + c) == toByte(color[c]));
+}
+
+// the vertices, normals, strand channels and triangles of a ply file are the exported ones
+void checkPLY(const MeshData& data, const MeshExportOptions& options) {
+  std::ostringstream out;
+  exportPLY(data, out, options);
+  const std::string bytes = out.str();
+
+  const std::size_t headerEnd = bytes.find("end_header\n");
+  CHECK(headerEnd != std::string::npos);
+  const std::string header = bytes.substr(0, headerEnd);
+
+  const std::string vertexElement = "element vertex " + std::to_string(data.vertices.size());
+  const std::string faceElement = "element face " + std::to_string(data.indices.size());
+  CHECK(header.find("format binary_little_endian 1.0") != std::string::npos);
+  CHECK(header.find(vertexElement) != std::string::npos);
+  CHECK(header.find(faceElement) != std::string::npos);
+
+  const bool ids = header.find("property int strand") != std::string::npos;
+  const bool colors = header.find("property uchar red") != std::string::npos;
+  CHECK(ids == options.strandIds);
+  CHECK(colors == !options.strandColors.empty());
+
+  std::size_t offset = headerEnd + std::strlen("end_header\n");
+  for (int i = 0; i < data.vertices.size(); ++i) {
+    CHECK(read<glm::vec3>(bytes, offset) == data.vertices[i]);
+    CHECK(read<glm::vec3>(bytes, offset + 12) == data.normals[i]);
+    offset += 24;
+
+    if (ids) {
+      CHECK(read<std::int32_t>(bytes, offset) == data.strandIds[i]);
+      offset += 4;
+    }
+    if (colors) {
+      checkColor(bytes, offset, options.strandColors[data.strandIds[i]]);
+      offset += 4;
+    }
+  }
+
+  for (const auto& triangle : data.indices) {
+    CHECK(read<std::uint8_t>(bytes, offset) == 3);
+    CHECK(read<glm::uvec3>(bytes, offset + 1) == triangle);
+    offset += 13;
+  }
+  CHECK(offset == bytes.size());
+}
+
+// buffer view (offset and length in the binary chunk) and component type of every accessor, read
+// from the json chunk of a glb file
+struct GLBAccessor {
+  std::size_t offset, length;
+  int componentType;
+  std::size_t count;
+};
+
+std::vector<GLBAccessor> parseAccessors(const std::string& json) {
+  std::vector<std::pair<std::size_t, std::size_t>> views;
+  const std::regex viewPattern(R"re(\{"buffer":0,"byteOffset":(\d+),"byteLength":(\d+))re");
+  for (std::sregex_iterator it(json.begin(), json.end(), viewPattern), end; it != end; ++it) {
+    views.emplace_back(std::stoull((*it)[1]), std::stoull((*it)[2]));
+  }
+
+  std::vector<GLBAccessor> accessors;
+  const std::regex accessorPattern(
+      R"re(\{"bufferView":(\d+),"componentType":(\d+),"count":(\d+))re"
+  );
+  for (std::sregex_iterator it(json.begin(), json.end(), accessorPattern), end; it != end; ++it) {
+    const auto& view = views.at(std::stoi((*it)[1]));
+    accessors.push_back({view.first, view.second, std::stoi((*it)[2]), std::stoull((*it)[3])});
+  }
+
+  return accessors;
+}
+
+glm::vec3 parseVec3(const std::string& json, const std::string& key) {
+  std::smatch match;
+  const std::regex pattern("\"" + key + R"re(":\[([^,]+),([^,]+),([^\]]+)\])re");
+  CHECK(std::regex_search(json, match, pattern));
+
+  return {std::stof(match[1]), std::stof(match[2]), std::stof(match[3])};
+}
+
+// the chunks of a glb file are consistent, and its accessors read back the exported mesh (up to
+// the quantization step)
+void checkGLB(const MeshData& data, const MeshExportOptions& options) {
+  std::ostringstream out;
+  exportGLB(data, out, options);
+  const std::string bytes = out.str();
+
+  CHECK(bytes.compare(0, 4, "glTF") == 0);
+  CHECK(read<std::uint32_t>(bytes, 4) == 2);
+  CHECK(read<std::uint32_t>(bytes, 8) == bytes.size());
+
+  const std::uint32_t jsonLength = read<std::uint32_t>(bytes, 12);
+  CHECK(bytes.compare(16, 4, "JSON") == 0 && jsonLength % 4 == 0);
+  const std::string json = bytes.substr(20, jsonLength);
+
+  const std::size_t binStart = 20 + jsonLength + 8;
+  CHECK(bytes.compare(binStart - 4, 4, std::string("BIN\0", 4)) == 0);
+  CHECK(read<std::uint32_t>(bytes, binStart - 8) == bytes.size() - binStart);
+  const std::string bin = bytes.substr(binStart);
+
+  // position, normal, strand id, color and index accessors, in this order
+  const std::vector<GLBAccessor> accessors = parseAccessors(json);
+  const bool ids = options.strandIds, colors = !options.strandColors.empty();
+  CHECK(accessors.size() == 3 + ids + colors);
+  for (const GLBAccessor& accessor : accessors) {
+    CHECK(accessor.offset % 4 == 0 && accessor.offset + accessor.length <= bin.size());
+  }
+
+  const GLBAccessor& positions = accessors[0];
+  const GLBAccessor& normals = accessors[1];
+  CHECK(positions.count == data.vertices.size() && normals.count == data.vertices.size());
+
+  glm::vec3 translation{0.0f}, scale{1.0f};
+  if (options.quantize) {
+    translation = parseVec3(json, "translation");
+    scale = parseVec3(json, "scale");
+  }
+
+  for (int i = 0; i < data.vertices.size(); ++i) {
+    if (options.quantize) {
+      glm::vec3 position, normal;
+      for (int c = 0; c < 3; ++c) {
+        position[c] = read<std::uint16_t>(bin, positions.offset + 8 * i + 2 * c);
+        normal[c] = read<std::int8_t>(bin, normals.offset + 4 * i + c) / 127.0f;
+      }
+
+      const glm::vec3 dequantized = translation + scale * position;
+      for (int c = 0; c < 3; ++c) {
+        CHECK(std::abs(dequantized[c] - data.vertices[i][c]) <= 0.5f * scale[c] + 1e-5f);
+      }
+      CHECK(glm::length(normal - data.normals[i]) < 0.02f);
+    } else {
+      CHECK(read<glm::vec3>(bin, positions.offset + 12 * i) == data.vertices[i]);
+      CHECK(read<glm::vec3>(bin, normals.offset + 12 * i) == data.normals[i]);
+    }
+
+    if (ids) CHECK(read<float>(bin, accessors[2].offset + 4 * i) == data.strandIds[i]);
+    if (colors) {
+      checkColor(bin, accessors[2 + ids].offset + 4 * i, options.strandColors[data.strandIds[i]]);
+    }
+  }
+
+  // 16-bit indices when they fit
+  const GLBAccessor& indices = accessors.back();
+  const bool shortIndices = data.vertices.size() <= 65535;
+  CHECK(indices.count == 3 * data.indices.size());
+  CHECK(indices.componentType == (shortIndices ? 5123 : 5125));
+
+  for (int t = 0; t < data.indices.size(); ++t) {
+    for (int c = 0; c < 3; ++c) {
+      const std::size_t offset = indices.offset + (3 * t + c) * (shortIndices ? 2 : 4);
+      const std::uint32_t index = shortIndices ? read<std::uint16_t>(bin, offset)
+                                               : read<std::uint32_t>(bin, offset);
+      CHECK(index == data.indices[t][c]);
+    }
+  }
+}
+
+void checkExports() {
+  const int strandCount = 40;
+  const std::vector<glm::vec4> strandColors = createStrandColors(strandCount);
+
+  for (int vertexCount : {1000, 70000}) {  // (16 and 32-bit indices)
+    const MeshData data = createTestMesh(vertexCount, 2000, strandCount, vertexCount);
+
+    for (bool withChannels : {false, true}) {
+      MeshExportOptions options;
+      options.strandIds = withChannels;
+      if (withChannels) options.strandColors = strandColors;
+
+      checkPLY(data, options);
+      checkGLB(data, options);
+
+      options.quantize = true;
+      checkGLB(data, options);
+    }
+  }
+
+  // meshes that can't be exported
+  MeshData mismatched = createTestMesh(10, 5, 2, 1);
+  mismatched.strandIds.pop_back();
+  std::ostringstream out;
+  CHECK_THROWS(exportPLY(mismatched, out), std::runtime_error);
+  CHECK_THROWS(exportGLB(MeshData{}, out), std::runtime_error);
+  CHECK_THROWS(exportMesh(mismatched, "mesh.obj"), std::runtime_error);
+}
+
+}  // namespace
+
+int main() {
+  checkExports();
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "geometry/util.h"
+#include "simulation/PBD.h"
+
+namespace {
+
+std::set<std::pair<int, int>> findCollisionsDirectly(
+    const std::vector<glm::vec3>& points, float radius, const std::vector<float>& radii
+) {
+  auto getRadius = [&](int i) { return radii.empty() ? radius : radii[i]; };
+
+  std::set<std::pair<int, int>> collisions;
+  for (int i = 0; i < points.size(); ++i) {
+    for (int j = i + 1; j < points.size(); ++j) {
+      if (glm::length(points[i] - points[j]) < getRadius(i) + getRadius(j))
+        collisions.insert({i, j});
+    }
+  }
+
+  return collisions;
+}
+
+// the grid finds the pairs of the o(n^2) scan: on both sides of the grid threshold, with one or
+// several radii, for flat layouts and for points far from the others
+void checkCollisions() {
+  std::mt19937 rng(3);
+  const float radius = 0.05f;
+
+  for (int n : {COLLISION_GRID_POINTS - 1, COLLISION_GRID_POINTS, 200, 1000}) {
+    for (bool varied : {false, true}) {
+      for (bool flat : {false, true}) {
+        // dense enough for every point to collide with a few others
+        const float size = 0.02f * std::cbrt(static_cast<float>(n));
+        std::uniform_real_distribution<float> coordinate(0.0f, size);
+        std::uniform_real_distribution<float> radiusScale(0.2f, 3.0f);
+
+        std::vector<glm::vec3> points;
+        std::vector<float> radii;
+        for (int i = 0; i < n; ++i) {
+          points.emplace_back(coordinate(rng), flat ? 0.0f : coordinate(rng), coordinate(rng));
+          if (varied) radii.push_back(radius * radiusScale(rng));
+        }
+
+        std::set<std::pair<int, int>> collisions;
+        findCollisions(points, radius, radii, collisions);
+        CHECK(!collisions.empty());
+        CHECK(collisions == findCollisionsDirectly(points, radius, radii));
+
+        // a diverged point: too many cells for the grid
+        points.back() = glm::vec3(1e9f);
+        collisions.clear();
+        findCollisions(points, radius, radii, collisions);
+        CHECK(collisions == findCollisionsDirectly(points, radius, radii));
+      }
+    }
+  }
+}
+
+// overlap left between the points: sum over the colliding pairs of their penetration, relative
+// to the sum of their radii
+float computeOverlap(const std::vector<glm::vec3>& points, const std::vector<float>& radii) {
+  float overlap = 0.0f;
+  for (const auto& [i, j] : findCollisionsDirectly(points, 0.0f, radii)) {
+    overlap += 1.0f - glm::length(points[i] - points[j]) / (radii[i] + radii[j]);
+  }
+
+  return overlap;
+}
+
+// farthest a point gets out of the profile (centered at the origin), relative to its radius
+float computeEscape(const std::vector<glm::vec3>& points, float profileRadius) {
+  float escape = 0.0f;
+  for (const glm::vec3& point : points) {
+    escape = std::max(escape, glm::length(point) / profileRadius - 1.0f);
+  }
+
+  return escape;
+}
+
+// a node above MULTILEVEL_PBD_POINTS, clustered as Tree::applyPBD does: the multilevel packing
+// leaves about as much overlap as the direct one, and brings the points into the profile as well
+void checkMultilevel() {
+  constexpr int n = MULTILEVEL_PBD_POINTS + MULTILEVEL_CLUSTER_POINTS;
+  constexpr float radius = 0.0075f;
+  constexpr int iterations = 100;  // (a tree gives such a node more, the test is kept short)
+
+  // merged layout: overlapping strands (a few super-strands among them), partly out of a profile
+  // about as tight as their packing
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::vector<glm::vec3> points;
+  std::vector<float> radii;
+  float area = 0.0f;
+  for (int i = 0; i < n; ++i) {
+    const float r = 0.35f * std::sqrt(unit(rng));
+    const float angle = 6.2831853f * unit(rng);
+    points.emplace_back(r * std::cos(angle), r * std::sin(angle), 0.0f);
+    radii.push_back(i % 50 == 0 ? 3.0f * radius : radius);
+    area += radii.back() * radii.back();
+  }
+
+  const float profileRadius = 1.3f * std::sqrt(area);
+  CHECK(computeEscape(points, profileRadius) > 0.1f);
+
+  auto createPBD = [&]() {
+    PBD pbd({}, {glm::vec3{0.0f}}, 0.02f, 0.002f, radius, glm::vec3{0.0f}, profileRadius);
+    pbd.setPoints(points);
+    pbd.setRadii(radii);
+    return pbd;
+  };
+
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<std::pair<int, int>> ranges;
+  const int clusterCount = (n + MULTILEVEL_CLUSTER_POINTS - 1) / MULTILEVEL_CLUSTER_POINTS;
+  util::splitClusters(points, order, 0, n, clusterCount, ranges);
+
+  std::vector<std::vector<int>> clusters;
+  for (const auto& [first, last] : ranges) {
+    clusters.emplace_back(order.begin() + first, order.begin() + last);
+  }
+  CHECK(clusters.size() == clusterCount);
+
+  const std::vector<glm::vec3> direct =
+      createPBD().execute(iterations, glm::vec3{0.0f}, profileRadius);
+  const std::vector<glm::vec3> multilevel =
+      createPBD().executeMultilevel(iterations, glm::vec3{0.0f}, profileRadius, clusters);
+  CHECK(multilevel.size() == n);
+
+  CHECK(computeOverlap(multilevel, radii) <= 1.25f * computeOverlap(direct, radii));
+  CHECK(computeEscape(direct, profileRadius) <= 0.01f);
+  CHECK(computeEscape(multilevel, profileRadius) <= 0.01f);
+}
+
+}  // namespace
+
+int main() {
+  checkCollisions();
+  checkMultilevel();
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "TestTrees.h"
+#include "core/PlantGraph.h"
+#include "core/PlantGraphIO.h"
+
+namespace {
+
+const std::string BINARY_PATH = "PlantGraphTest.pgb";
+
+PlantGraph parse(const std::string& text) {
+  return parsePlantGraph(text.data(), text.size(), "test");
+}
+
+// the error of a text graph, empty if it parses
+std::string getParseError(const std::string& text) {
+  try {
+    parse(text);
+  } catch (const std::runtime_error& e) {
+    return e.what();
+  }
+
+  return {};
+}
+
+std::vector<int> getChildren(const PlantGraph& pg, int id) {
+  const auto children = pg.getChildren(id);
+  return {children.begin(), children.end()};
+}
+
+void checkSameGraph(const PlantGraph& a, const PlantGraph& b) {
+  CHECK(a.getNodeCount() == b.getNodeCount());
+  for (int id = 0; id < a.getNodeCount(); ++id) {
+    CHECK(a.getNode(id).parentId == b.getNode(id).parentId);
+    CHECK(a.getNode(id).pos == b.getNode(id).pos);
+    CHECK(a.getNode(id).radius == b.getNode(id).radius);
+    CHECK(getChildren(a, id) == getChildren(b, id));
+  }
+}
+
+// nodes in any order and with any ids are renumbered breadth first, children in file order
+void checkText() {
+  const PlantGraph pg = parse(
+      "# comment\n"
+      "7 3 1 2 3 0.5\n"
+      "\n"
+      "3 -1 0 0 0  # root\n"
+      "  5 3 -1 2.5e1 0\t0.25\r\n"
+      "9 5 0 1 0"
+  );
+
+  CHECK(pg.getNodeCount() == 4);
+  CHECK(pg.getNode(0).isRoot());
+  CHECK(getChildren(pg, 0) == std::vector<int>({1, 2}));
+  CHECK(getChildren(pg, 2) == std::vector<int>({3}));
+  CHECK(pg.getNode(1).pos == glm::vec3(1.0f, 2.0f, 3.0f) && pg.getNode(1).radius == 0.5f);
+  CHECK(pg.getNode(2).pos == glm::vec3(-1.0f, 25.0f, 0.0f) && pg.getNode(2).radius == 0.25f);
+  CHECK(pg.getNode(3).parentId == 2 && pg.getNode(3).radius == 0.0f);
+  CHECK(pg.getChildCount() == 3);
+
+  // errors, with their line
+  CHECK(getParseError("0 -1 0 0 0\n1 0 1 2\n") == "test:2: expected id parent x y z");
+  CHECK(getParseError("0 -1 0 0 0\n1 0 1 2 3 r\n") == "test:2: invalid radius");
+  const std::string trailing = "unexpected text after the radius";
+  CHECK(getParseError("0 -1 0 0 0\n\n1 0 1 2 3 0.5 7\n") == "test:3: " + trailing);
+  CHECK(getParseError("0 -1 0 0 0\n1 0 1 2 3 0.5x\n") == "test:2: " + trailing);
+  CHECK(getParseError("0 -1 0 0 0\n1 2 0 0 0\n").find("unknown parent") != std::string::npos);
+  CHECK(getParseError("0 -1 0 0 0\n1 -1 0 0 0\n").find("more than one root") != std::string::npos);
+}
+
+void checkBinary() {
+  PlantGraph pg = createTestGraph(4, 3, 2);
+  pg.nodes[3].radius = 0.125f;
+
+  savePlantGraphBinary(pg, BINARY_PATH);
+  const PlantGraph loaded = loadPlantGraph(BINARY_PATH);
+  checkSameGraph(pg, loaded);
+}
+
+// the compressed children of nodes added one by one are the ones of the same graph built at once
+void checkChildren() {
+  const PlantGraph pg = createTestGraph(4, 3, 9);
+
+  std::vector<Node> nodes = pg.nodes;
+  const PlantGraph bulk(std::move(nodes));
+  checkSameGraph(pg, bulk);
+
+  int childCount = 0;
+  for (int id = 0; id < pg.getNodeCount(); ++id) {
+    for (int child : pg.getChildren(id)) CHECK(pg.getNode(child).parentId == id);
+    childCount += pg.getChildren(id).size();
+  }
+  CHECK(childCount == pg.getNodeCount() - 1 && childCount == pg.getChildCount());
+}
+
+void checkDirtyNodes() {
+  PlantGraph pg = createTestGraph(2, 2, 4);
+  CHECK(pg.getDirtyNodes().size() == pg.getNodeCount());
+  pg.clearDirtyNodes();
+  CHECK(!pg.hasDirtyNodes() && pg.getDirtyNodes().empty());
+
+  const int added = pg.addNode({0.0f, 5.0f, 0.0f}, 2);
+  pg.setNodePosition(1, {0.0f, 1.0f, 0.0f});
+  pg.setNodePosition(added, {0.0f, 6.0f, 0.0f});
+  CHECK(pg.getDirtyNodes() == std::vector<int>({1, added}));
+  CHECK(pg.isDirty(1) && pg.isDirty(added) && !pg.isDirty(2));
+
+  pg.clearDirtyNodes();
+  CHECK(!pg.hasDirtyNodes() && !pg.isDirty(1));
+
+  // a graph built at once is all dirty
+  std::vector<Node> nodes = pg.nodes;
+  PlantGraph bulk(std::move(nodes));
+  CHECK(bulk.isDirty(added) && bulk.getDirtyNodes().size() == bulk.getNodeCount());
+  bulk.setNodePosition(1, {0.0f, 2.0f, 0.0f});
+  bulk.clearDirtyNodes();
+  CHECK(!bulk.hasDirtyNodes() && !bulk.isDirty(1));
+}
+
+}  // namespace
+
+int main() {
+  checkText();
+  checkBinary();
+  checkChildren();
+  checkDirtyNodes();
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "geometry/Spline.h"
+
+namespace {
+
+// random polylines of 2 to 12 points, concatenated
+void createSplines(
+    int count, std::mt19937& rng, std::vector<glm::vec3>& points, std::vector<int>& offsets
+) {
+  std::uniform_int_distribution<int> size(2, 12);
+  std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+  offsets = {0};
+  for (int i = 0; i < count; ++i) {
+    glm::vec3 p{0.0f};
+    for (int k = size(rng); k > 0; --k) {
+      p += glm::vec3(step(rng), 1.0f + step(rng), step(rng));
+      points.push_back(p);
+    }
+    offsets.push_back(points.size());
+  }
+}
+
+// control points of every segment of the splines, with mirrored ones at their ends
+std::vector<SegmentControlPoints> getControlPoints(
+    const std::vector<glm::vec3>& points, const std::vector<int>& offsets
+) {
+  std::vector<SegmentControlPoints> controlPoints;
+  for (int i = 0; i + 1 < offsets.size(); ++i) {
+    const glm::vec3* spline = &points[offsets[i]];
+    const int nPoints = offsets[i + 1] - offsets[i];
+
+    for (int k = 0; k + 1 < nPoints; ++k) {
+      controlPoints.push_back({
+          k > 0 ? spline[k - 1] : 2.0f * spline[0] - spline[1],
+          spline[k],
+          spline[k + 1],
+          k + 2 < nPoints ? spline[k + 2] : 2.0f * spline[k + 1] - spline[k],
+      });
+    }
+  }
+
+  return controlPoints;
+}
+
+// batched segments are the segments of the whole splines interpolated one at a time (with fixed
+// or adaptive sample counts), and the splines go through their points
+void checkSegments() {
+  std::mt19937 rng(1);
+  std::vector<glm::vec3> points;
+  std::vector<int> offsets;
+  createSplines(300, rng, points, offsets);
+
+  const std::vector<SegmentControlPoints> controlPoints = getControlPoints(points, offsets);
+  const int nSegments = controlPoints.size();
+
+  // every sample count, for all the segments at once
+  std::vector<std::vector<glm::vec3>> batches(NUM_INTERPOLATED_POINTS + 1);
+  for (int nSamples = 1; nSamples <= NUM_INTERPOLATED_POINTS; ++nSamples) {
+    batches[nSamples].resize(nSegments * nSamples);
+    Spline::interpolateSegments(
+        controlPoints.data(), nSegments, nSamples, batches[nSamples].data()
+    );
+  }
+
+  std::uniform_int_distribution<int> samples(1, NUM_INTERPOLATED_POINTS);
+  for (int i = 0, segment = 0; i + 1 < offsets.size(); ++i) {
+    const std::vector<glm::vec3> spline(&points[offsets[i]], &points[offsets[i + 1] - 1] + 1);
+    const int nPoints = spline.size();
+
+    for (bool adaptive : {false, true}) {
+      std::vector<int> segmentSamples(nPoints - 1, NUM_INTERPOLATED_POINTS);
+      if (adaptive) {
+        for (int& n : segmentSamples) n = samples(rng);
+      }
+
+      int expectedSize = 1;
+      for (int n : segmentSamples) expectedSize += n;
+
+      std::vector<glm::vec3> single(expectedSize);
+      Spline::interpolate(spline.data(), nPoints, single.data(), segmentSamples.data());
+      if (!adaptive) CHECK(single == Spline::interpolate(spline));
+      CHECK(single.back() == spline.back());
+
+      // through the points, segment by segment
+      for (int k = 0, s = 0; k + 1 < nPoints; s += segmentSamples[k], ++k) {
+        const int nSamples = segmentSamples[k];
+        const glm::vec3* batched = &batches[nSamples][(segment + k) * nSamples];
+
+        CHECK(glm::length(single[s] - spline[k]) < 1e-5f);
+        for (int j = 0; j < nSamples; ++j) CHECK(batched[j] == single[s + j]);
+      }
+    }
+
+    segment += nPoints - 1;
+  }
+}
+
+// the sample counts of a segment grow as the tolerance gets smaller, up to the full count
+void checkSegmentSamples() {
+  const glm::vec3 p0{-1.0f, -1.0f, 0.0f}, p1{0.0f}, p2{0.0f, 1.0f, 0.0f}, p3{2.0f, 0.0f, 0.0f};
+
+  int previous = 1;
+  for (float tolerance : {10.0f, 1e-1f, 1e-2f, 1e-3f, 1e-6f}) {
+    const int samples = Spline::computeSegmentSamples(p0, p1, p2, p3, tolerance);
+    CHECK(samples >= previous && samples <= NUM_INTERPOLATED_POINTS);
+    if (tolerance >= 10.0f) CHECK(samples == 1);
+    previous = samples;
+  }
+  CHECK(previous == NUM_INTERPOLATED_POINTS);
+}
+
+}  // namespace
+
+int main() {
+  checkSegments();
+  checkSegmentSamples();
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "TestTrees.h"
+#include "core/StrandDataset.h"
+#include "core/Tree.h"
+
+namespace {
+
+const std::string DATASET_PATH = "StrandDatasetTest.sds";
+
+void writeFile(const std::string& path, const std::string& contents) {
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+  CHECK(file);
+}
+
+// the particles (positions, layouts and weights) of a tree loaded from a dataset are the ones it
+// was written with, interpolated ones included
+void checkSameParticles(const Tree& expected, const Tree& loaded, bool weighted) {
+  const auto& expectedStrands = expected.getStrands();
+  const auto& loadedStrands = loaded.getStrands();
+  CHECK(loadedStrands.size() == expectedStrands.size());
+
+  for (int s = 0; s < expectedStrands.size(); ++s) {
+    const auto& expectedParticles = expectedStrands[s].getParticles();
+    const auto& loadedParticles = loadedStrands[s].getParticles();
+
+    CHECK(loadedParticles.size() == expectedParticles.size());
+    for (int i = 0; i < expectedParticles.size(); ++i) {
+      CHECK(loadedParticles[i]->pos == expectedParticles[i]->pos);
+      CHECK(loadedParticles[i]->localPos == expectedParticles[i]->localPos);
+      CHECK(loadedParticles[i]->nodeId == expectedParticles[i]->nodeId);
+      CHECK(loadedParticles[i]->interpolated == expectedParticles[i]->interpolated);
+      CHECK(loadedParticles[i]->weight == (weighted ? expectedParticles[i]->weight : 1));
+    }
+  }
+}
+
+// super-strands keep their weights through a dataset, adaptively sampled segments their samples
+// (the loading tree samples them at the default), and version 1 datasets (without the weights
+// column) are read with unit weights
+void checkRoundTrip() {
+  PlantGraph pg = createTestGraph(4, 3, 5);
+  Tree tree(pg);
+  tree.setStrandBundling(20);
+  tree.setAdaptiveSampling(0.05f);
+  tree.computeStrandsPosition();
+
+  bool bundled = false;
+  for (const Strand& strand : tree.getStrands()) {
+    for (const auto& particle : strand.getParticles()) bundled |= particle->weight > 1;
+  }
+  CHECK(bundled);
+
+  std::ostringstream out;
+  writeStrandDataset(tree.generateStrandData(), out);
+  writeFile(DATASET_PATH, out.str());
+
+  {
+    StrandDataset dataset(DATASET_PATH);
+    CHECK(dataset.getHeader().version == STRAND_DATASET_VERSION);
+    CHECK(dataset.getTreeCount() == 1);
+
+    PlantGraph loadedGraph = dataset.getTree(0).createGraph();
+    Tree loaded(loadedGraph);
+    loaded.loadStrands(dataset.getTree(0));
+    checkSameParticles(tree, loaded, true);
+
+    // the cross sections are built from the stored samples
+    const MeshData loadedMesh = loaded.generateMeshData();
+    const MeshData mesh = tree.generateMeshData();
+    CHECK(loadedMesh.vertices.size() == mesh.vertices.size());
+    CHECK(loadedMesh.indices.size() == mesh.indices.size());
+  }
+
+  // the same dataset in version 1: without the weights column, which precedes the names
+  std::string contents = out.str();
+  StrandDatasetHeader header;
+  std::memcpy(&header, contents.data(), sizeof(header));
+
+  const std::size_t weightsBytes = header.nodeParticleCount * sizeof(std::int32_t);
+  contents.erase(contents.size() - header.namesLength - weightsBytes, weightsBytes);
+  header.version = 1;
+  std::memcpy(&contents[0], &header, sizeof(header));
+  writeFile(DATASET_PATH, contents);
+
+  {
+    StrandDataset dataset(DATASET_PATH);
+    PlantGraph loadedGraph = dataset.getTree(0).createGraph();
+    Tree loaded(loadedGraph);
+    loaded.loadStrands(dataset.getTree(0));
+    checkSameParticles(tree, loaded, false);
+  }
+
+  // newer versions are rejected
+  header.version = STRAND_DATASET_VERSION + 1;
+  std::memcpy(&contents[0], &header, sizeof(header));
+  writeFile(DATASET_PATH, contents);
+  CHECK_THROWS(StrandDataset{DATASET_PATH}, std::runtime_error);
+}
+
+}  // namespace
+
+int main() {
+  checkRoundTrip();
+
+  return 0;
+}
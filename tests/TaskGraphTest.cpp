@@ -0,0 +1,125 @@
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "Check.h"
+#include "core/Parallel.h"
+#include "core/TaskGraph.h"
+
+namespace {
+
+// binary tree of tasks: every task depends on its two children (the ones after it)
+void checkDependencies(bool serial) {
+  constexpr int TASK_COUNT = 2000;
+
+  std::vector<std::atomic<int>> done(TASK_COUNT);
+  std::atomic<int> early{0};  // tasks started before their dependencies were done
+
+  TaskGraph graph;
+  for (int i = 0; i < TASK_COUNT; ++i) {
+    graph.add([&, i]() {
+      for (int child : {2 * i + 1, 2 * i + 2}) {
+        if (child < TASK_COUNT && !done[child]) early++;
+      }
+      done[i]++;
+    });
+  }
+
+  for (int i = 0; i < TASK_COUNT; ++i) {
+    for (int child : {2 * i + 1, 2 * i + 2}) {
+      if (child < TASK_COUNT) graph.depend(i, child);
+    }
+  }
+  CHECK(graph.getTaskCount() == TASK_COUNT);
+
+  parallel::serialThread = serial;
+
+  // twice: a graph can be run again
+  for (int run = 1; run <= 2; ++run) {
+    graph.run();
+
+    for (const auto& count : done) CHECK(count == run);
+    CHECK(early == 0);
+  }
+
+  parallel::serialThread = false;
+}
+
+void checkSerialOrder() {
+  // ready tasks in id order, then the tasks they make ready
+  std::vector<int> order;
+  TaskGraph graph;
+  for (int i = 0; i < 4; ++i) graph.add([&, i]() { order.push_back(i); });
+  graph.depend(0, 3);
+  graph.depend(1, 0);
+
+  parallel::serialThread = true;
+  graph.run();
+  parallel::serialThread = false;
+
+  CHECK((order == std::vector<int>{2, 3, 0, 1}));
+}
+
+void checkException() {
+  std::atomic<int> ran{0};
+  TaskGraph graph;
+  const int failing = graph.add([]() { throw std::runtime_error("task failed"); });
+  for (int i = 0; i < 100; ++i) graph.depend(graph.add([&]() { ran++; }), failing);
+
+  CHECK_THROWS(graph.run(), std::runtime_error);
+  CHECK(ran == 0);  // the successors of a failed task never start
+}
+
+// a chain of tasks cancelled halfway: the tasks after the cancellation never start
+void checkCancellation(bool serial) {
+  constexpr int TASK_COUNT = 100;
+  constexpr int CANCELLED_AFTER = 10;
+
+  std::atomic<int> ran{0};
+  TaskGraph graph;
+  for (int i = 0; i < TASK_COUNT; ++i) {
+    const int task = graph.add([&]() { ran++; });
+    if (i > 0) graph.depend(task, task - 1);
+  }
+
+  parallel::serialThread = serial;
+  CHECK_THROWS(graph.run([&]() { return ran == CANCELLED_AFTER; }), TaskGraph::Cancelled);
+  parallel::serialThread = false;
+  CHECK(ran == CANCELLED_AFTER);
+
+  // a predicate that never cancels runs everything
+  ran = 0;
+  graph.run([]() { return false; });
+  CHECK(ran == TASK_COUNT);
+}
+
+void checkCycle() {
+  std::atomic<int> ran{0};
+  TaskGraph graph;
+  const int a = graph.add([&]() { ran++; });
+  const int b = graph.add([&]() { ran++; });
+  const int c = graph.add([&]() { ran++; });
+  graph.depend(b, a);
+  graph.depend(c, b);
+  graph.depend(a, c);
+
+  CHECK_THROWS(graph.run(), std::runtime_error);
+  CHECK(ran == 0);
+}
+
+}  // namespace
+
+int main() {
+  checkDependencies(false);
+  checkDependencies(true);
+  checkSerialOrder();
+  checkException();
+  checkCancellation(false);
+  checkCancellation(true);
+  checkCycle();
+
+  // an empty graph does nothing
+  TaskGraph().run();
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef __TEST_TREES_H__
+#define __TEST_TREES_H__
+
+#include <random>
+
+#include "core/PlantGraph.h"
+
+// random tree of `depth` levels above the trunk: every node gets 1 to `maxChildren` children
+// going upwards (the same seed gives the same graph)
+inline PlantGraph createTestGraph(int depth, int maxChildren, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> childCount(1, maxChildren);
+  std::uniform_real_distribution<float> offset(-0.6f, 0.6f), height(0.6f, 1.0f);
+
+  PlantGraph pg({0.0f, 0.0f, 0.0f});
+  pg.addNode({0.0f, 1.5f, 0.0f}, 0);
+
+  std::vector<int> level{1};
+  for (int d = 0; d < depth; ++d) {
+    std::vector<int> next;
+    for (int parentId : level) {
+      const int count = childCount(rng);
+      for (int c = 0; c < count; ++c) {
+        glm::vec3 pos = pg.getNode(parentId).pos + glm::vec3{offset(rng), height(rng), offset(rng)};
+        next.push_back(pg.addNode(pos, parentId));
+      }
+    }
+    level = std::move(next);
+  }
+
+  return pg;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "TestTrees.h"
+#include "core/Tree.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string CACHE_DIR = "TreeCacheTest.cache";
+
+int countEntries() {
+  int count = 0;
+  for (const auto& entry : fs::directory_iterator(CACHE_DIR)) count += entry.is_regular_file();
+  return count;
+}
+
+// the strands of a tree loaded from the cache are the ones it was computed with, particle by
+// particle, and so is its mesh
+void checkSameTree(Tree& expected, Tree& loaded) {
+  const auto& expectedStrands = expected.getStrands();
+  const auto& loadedStrands = loaded.getStrands();
+  CHECK(loadedStrands.size() == expectedStrands.size());
+
+  for (int s = 0; s < expectedStrands.size(); ++s) {
+    const auto& expectedParticles = expectedStrands[s].getParticles();
+    const auto& loadedParticles = loadedStrands[s].getParticles();
+    CHECK(loadedParticles.size() == expectedParticles.size());
+
+    for (int i = 0; i < expectedParticles.size(); ++i) {
+      CHECK(loadedParticles[i]->pos == expectedParticles[i]->pos);
+      CHECK(loadedParticles[i]->localPos == expectedParticles[i]->localPos);
+      CHECK(loadedParticles[i]->nodeId == expectedParticles[i]->nodeId);
+      CHECK(loadedParticles[i]->weight == expectedParticles[i]->weight);
+      CHECK(loadedParticles[i]->interpolated == expectedParticles[i]->interpolated);
+    }
+  }
+
+  const MeshData expectedMesh = expected.generateMeshData();
+  const MeshData mesh = loaded.generateMeshData();
+  CHECK(!mesh.indices.empty());
+  CHECK(mesh.vertices == expectedMesh.vertices);
+  CHECK(mesh.indices == expectedMesh.indices);
+}
+
+// a tree of its own copy of a graph, computed through the cache
+struct CachedTree {
+  PlantGraph graph;
+  Tree tree;
+  bool loaded;
+
+  CachedTree(const PlantGraph& _graph, int maxNodeStrands, unsigned int seed)
+      : graph{_graph}, tree{graph} {
+    tree.setSeed(seed);
+    tree.setStrandBundling(maxNodeStrands);
+    loaded = tree.computeStrandsPosition(CACHE_DIR);
+  }
+};
+
+void checkRoundTrip(int maxNodeStrands) {
+  fs::remove_all(CACHE_DIR);
+  const PlantGraph graph = createTestGraph(3, 3, 8);
+
+  CachedTree computed(graph, maxNodeStrands, 0);
+  CHECK(!computed.loaded && countEntries() == 1);
+
+  CachedTree loaded(graph, maxNodeStrands, 0);
+  CHECK(loaded.loaded);
+  checkSameTree(computed.tree, loaded.tree);
+
+  // another seed, bundling or graph is another entry
+  CHECK(!CachedTree(graph, maxNodeStrands, 1).loaded);
+  CHECK(!CachedTree(graph, maxNodeStrands + 10, 0).loaded);
+
+  PlantGraph moved = graph;
+  moved.setNodePosition(3, moved.getNode(3).pos + glm::vec3(0.0f, 0.1f, 0.0f));
+  CHECK(!CachedTree(moved, maxNodeStrands, 0).loaded);
+  CHECK(countEntries() == 4);
+}
+
+// corrupted entries are computed again and replaced
+void checkCorruption() {
+  fs::remove_all(CACHE_DIR);
+  const PlantGraph graph = createTestGraph(2, 3, 4);
+
+  CachedTree computed(graph, 0, 0);
+  const fs::path path = fs::directory_iterator(CACHE_DIR)->path();
+  const auto size = fs::file_size(path);
+
+  // a flipped byte in the particles
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(size / 2);
+    const char byte = file.get();
+    file.seekp(size / 2);
+    file.put(static_cast<char>(~byte));
+  }
+
+  CHECK(!CachedTree(graph, 0, 0).loaded);
+  CHECK(fs::file_size(path) == size);
+
+  CachedTree replaced(graph, 0, 0);
+  CHECK(replaced.loaded);
+  checkSameTree(computed.tree, replaced.tree);
+
+  // a truncated file
+  fs::resize_file(path, size - 8);
+  CHECK(!CachedTree(graph, 0, 0).loaded);
+
+  CachedTree loaded(graph, 0, 0);
+  CHECK(loaded.loaded);
+  checkSameTree(computed.tree, loaded.tree);
+
+  CHECK(countEntries() == 1);
+  fs::remove_all(CACHE_DIR);
+}
+
+// an entry that can't be written leaves no temporary file behind
+void checkFailedWrite() {
+  fs::remove_all(CACHE_DIR);
+  const PlantGraph graph = createTestGraph(2, 3, 4);
+
+  CachedTree computed(graph, 0, 0);
+  const fs::path path = fs::directory_iterator(CACHE_DIR)->path();
+
+  // (a directory in the way of the entry: it is neither loaded nor replaced)
+  fs::remove(path);
+  fs::create_directories(path / "occupied");
+
+  CHECK(!CachedTree(graph, 0, 0).loaded);
+  CHECK(fs::is_directory(path));
+  CHECK(countEntries() == 0);
+  fs::remove_all(CACHE_DIR);
+}
+
+}  // namespace
+
+int main() {
+  checkRoundTrip(0);
+  checkRoundTrip(20);  // super-strands
+  checkCorruption();
+  checkFailedWrite();
+
+  return 0;
+}
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "TestTrees.h"
+#include "core/Parallel.h"
+#include "core/Tree.h"
+#include "geometry/Spline.h"
+
+namespace {
+
+// the strands interpolated segment by segment in the task graph are the catmull-rom splines
+// through their node particles, as interpolated one strand at a time
+void checkInterpolatedStrands(int maxNodeStrands) {
+  PlantGraph pg = createTestGraph(4, 2, 7);
+  Tree tree(pg);
+  tree.setStrandBundling(maxNodeStrands);
+  tree.computeStrandsPosition();
+
+  int interpolatedStrands = 0;
+  for (const Strand& strand : tree.getStrands()) {
+    const auto& particles = strand.getParticles();
+
+    std::vector<glm::vec3> points;
+    for (const auto& particle : particles) {
+      if (!particle->interpolated) points.push_back(particle->pos);
+    }
+    CHECK(!particles.front()->interpolated && !particles.back()->interpolated);
+    if (points.size() < 2) continue;
+
+    const std::vector<glm::vec3> expected = Spline::interpolate(points);
+    CHECK(particles.size() == expected.size());
+    for (int i = 0; i < particles.size(); ++i) CHECK(particles[i]->pos == expected[i]);
+
+    // interpolated particles belong to the segment ending at the next node particle
+    for (int i = particles.size() - 2; i >= 0; --i) {
+      if (particles[i]->interpolated) CHECK(particles[i]->nodeId == particles[i + 1]->nodeId);
+    }
+    ++interpolatedStrands;
+  }
+  CHECK(interpolatedStrands > 0);
+}
+
+MeshData generateMesh(const PlantGraph& graph, bool eagerCrossSections, bool serial) {
+  PlantGraph pg = graph;
+  Tree tree(pg);
+  tree.setStrandBundling(30);
+  tree.setEagerCrossSections(eagerCrossSections);
+
+  parallel::serialThread = serial;
+  tree.computeStrandsPosition();
+  MeshData data = tree.generateMeshData(true);
+  parallel::serialThread = false;
+
+  return data;
+}
+
+// cross sections computed in the strand task graph or when the mesh is generated, and tasks run
+// in any order, give the same mesh
+void checkSameMesh() {
+  const PlantGraph pg = createTestGraph(4, 3, 11);
+
+  const MeshData expected = generateMesh(pg, false, true);
+  CHECK(!expected.indices.empty());
+
+  for (bool eager : {false, true}) {
+    const MeshData data = generateMesh(pg, eager, false);
+    CHECK(data.vertices == expected.vertices);
+    CHECK(data.normals == expected.normals);
+    CHECK(data.indices == expected.indices);
+    CHECK(data.strandIds == expected.strandIds);
+  }
+}
+
+// expanded subtrees have the strands (by the nodes they go through) of an unbundled tree, each
+// standing for itself, and the strands are interpolated through their new particles
+void checkExpandedStrands() {
+  const PlantGraph graph = createTestGraph(4, 3, 3);
+
+  PlantGraph unbundledGraph = graph;
+  Tree unbundled(unbundledGraph);
+  unbundled.computeStrandsPosition();
+
+  PlantGraph pg = graph;
+  Tree tree(pg);
+  tree.setStrandBundling(20);
+  tree.computeStrandsPosition();
+
+  // the subtree of the first branching node
+  int rootId = 1;
+  while (pg.getChildren(rootId).size() == 1) rootId = pg.getChildren(rootId)[0];
+  std::set<int> subtree;
+  pg.traverseDFS(rootId, [&](const Node& n) { subtree.insert(n.id); });
+
+  auto subtreeNodes = [&](const Strand& strand) {
+    std::vector<int> nodes;
+    for (const auto& particle : strand.getParticles()) {
+      if (!particle->interpolated && subtree.count(particle->nodeId)) {
+        nodes.push_back(particle->nodeId);
+      }
+    }
+    return nodes;
+  };
+
+  int bundled = 0;
+  for (const Strand& strand : tree.getStrands()) {
+    bundled += subtreeNodes(strand) != subtreeNodes(unbundled.getStrands()[strand.id]);
+  }
+  CHECK(bundled > 0);
+
+  tree.expandSuperStrands({rootId});
+
+  CHECK(tree.getStrands().size() == unbundled.getStrands().size());
+  for (const Strand& strand : tree.getStrands()) {
+    CHECK(subtreeNodes(strand) == subtreeNodes(unbundled.getStrands()[strand.id]));
+
+    std::vector<glm::vec3> points;
+    for (const auto& particle : strand.getParticles()) {
+      if (!particle->interpolated) points.push_back(particle->pos);
+      if (!particle->interpolated && subtree.count(particle->nodeId)) CHECK(particle->weight == 1);
+    }
+    if (points.size() < 2) continue;
+
+    const std::vector<glm::vec3> expected = Spline::interpolate(points);
+    CHECK(strand.getParticles().size() == expected.size());
+    for (int i = 0; i < expected.size(); ++i) CHECK(strand.getParticles()[i]->pos == expected[i]);
+  }
+
+  CHECK(!tree.generateMeshData().indices.empty());
+}
+
+// the levels of detail are the full mesh then coarser and coarser ones, and the renderer picks
+// them by distance
+void checkMeshLODs() {
+  PlantGraph pg = createTestGraph(4, 3, 13);
+  Tree tree(pg);
+  tree.computeStrandsPosition();
+
+  const std::vector<MeshLOD> lods = tree.generateMeshLODs();
+  CHECK(lods.size() == NUM_MESH_LOD_LEVELS + 1);
+  CHECK(lods[0].data.indices == tree.generateMeshData().indices && lods[0].geometricError == 0.0f);
+
+  for (int i = 1; i < lods.size(); ++i) {
+    CHECK(lods[i].data.indices.size() < lods[i - 1].data.indices.size());
+    CHECK(lods[i].geometricError >= lods[i - 1].geometricError);
+    CHECK(lods[i].data.ranges.size() == pg.getNodeCount());
+  }
+
+  const float pixelsPerUnit = 1000.0f, error = lods.back().geometricError;
+  CHECK(error > 0.0f);
+  CHECK(selectLOD(lods, 1e-3f, pixelsPerUnit, 1.0f) == 0);
+  CHECK(selectLOD(lods, 2.0f * error * pixelsPerUnit, pixelsPerUnit, 1.0f) == lods.size() - 1);
+}
+
+// where a mesh vertex is along its strand: the branch segment (by child node) and the sample in
+// it (0 for the node particles)
+using SamplePositions = std::map<std::tuple<int, float, float, float>, std::pair<int, int>>;
+
+SamplePositions getSamplePositions(const Tree& tree) {
+  SamplePositions positions;
+  for (const Strand& strand : tree.getStrands()) {
+    int segment = -1, sample = 0;
+    for (const auto& particle : strand.getParticles()) {
+      if (!particle->interpolated) segment = particle->nodeId, sample = 0;
+      const glm::vec3& p = particle->pos;
+      positions[{strand.id, p.x, p.y, p.z}] = {segment, sample++};
+    }
+  }
+
+  return positions;
+}
+
+// samples of every branch segment (by child node), and its bands: the triangles joining two
+// consecutive cross sections (by the first sample)
+void getSegmentBands(
+    const Tree& tree, const MeshData& data, std::map<int, int>& samples,
+    std::set<std::pair<int, int>>& bands
+) {
+  const SamplePositions positions = getSamplePositions(tree);
+  for (const auto& [key, position] : positions) {
+    samples[position.first] = std::max(samples[position.first], position.second + 1);
+  }
+
+  for (const glm::uvec3& triangle : data.indices) {
+    std::pair<int, int> vertices[3];
+    for (int c = 0; c < 3; ++c) {
+      const glm::vec3& p = data.vertices[triangle[c]];
+      vertices[c] = positions.at({data.strandIds[triangle[c]], p.x, p.y, p.z});
+    }
+
+    const int segment = vertices[0].first;
+    int first = vertices[0].second, last = first;
+    for (const auto& [vertexSegment, sample] : vertices) {
+      CHECK(vertexSegment == segment);
+      first = std::min(first, sample), last = std::max(last, sample);
+    }
+    if (last == first + 1) bands.emplace(segment, first);
+  }
+}
+
+// adaptive sampling thins out the straight branch segments, and every branch segment keeps its
+// tube: at least two cross sections, and bands joining all of them
+void checkAdaptiveMesh() {
+  const PlantGraph graph = createTestGraph(3, 3, 17);
+
+  PlantGraph fullGraph = graph;
+  Tree full(fullGraph);
+  full.computeStrandsPosition();
+  const MeshData fullData = full.generateMeshData(true);
+
+  PlantGraph pg = graph;
+  Tree tree(pg);
+  tree.setAdaptiveSampling(0.1f);
+  tree.computeStrandsPosition();
+  const MeshData data = tree.generateMeshData(true);
+
+  std::map<int, int> fullSamples, samples;
+  std::set<std::pair<int, int>> fullBands, bands;
+  getSegmentBands(full, fullData, fullSamples, fullBands);
+  getSegmentBands(tree, data, samples, bands);
+
+  CHECK(data.vertices.size() < fullData.vertices.size());
+  CHECK(samples.size() == fullSamples.size());
+
+  int thinned = 0;
+  for (const auto& [segment, nSamples] : samples) {
+    if (pg.getNode(segment).isRoot()) continue;
+
+    CHECK(fullSamples.at(segment) == NUM_INTERPOLATED_POINTS);
+    CHECK(nSamples >= MIN_ADAPTIVE_SEGMENT_SAMPLES && nSamples <= NUM_INTERPOLATED_POINTS);
+    thinned += nSamples < NUM_INTERPOLATED_POINTS;
+
+    // (the cross sections are the samples 1 to nSamples - 1)
+    for (int first = 1; first + 1 < nSamples; ++first) CHECK(bands.count({segment, first}));
+    for (int first = 1; first + 1 < NUM_INTERPOLATED_POINTS; ++first) {
+      CHECK(fullBands.count({segment, first}));
+    }
+  }
+  CHECK(thinned > 0);
+}
+
+}  // namespace
+
+int main() {
+  checkInterpolatedStrands(0);
+  checkInterpolatedStrands(30);  // super-strands end in the middle of the tree
+  checkSameMesh();
+  checkExpandedStrands();
+  checkMeshLODs();
+  checkAdaptiveMesh();
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <cmath>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "TestTrees.h"
+#include "core/Tree.h"
+
+namespace {
+
+// strands of two trees of the same graph are matched by their leaf, and their order in it
+std::map<std::pair<int, int>, const Strand*> getLeafStrands(const Tree& tree) {
+  std::map<std::pair<int, int>, const Strand*> leafStrands;
+  std::map<int, int> leafCounts;
+  for (const Strand& strand : tree.getStrands()) {
+    const int leaf = strand.getParticles().front()->nodeId;
+    leafStrands[{leaf, leafCounts[leaf]++}] = &strand;
+  }
+
+  return leafStrands;
+}
+
+std::vector<const StrandParticle*> getNodeParticles(const Strand& strand) {
+  std::vector<const StrandParticle*> particles;
+  for (const auto& particle : strand.getParticles()) {
+    if (!particle->interpolated) particles.push_back(particle.get());
+  }
+
+  return particles;
+}
+
+// packed layout of a node: its center, its spread (in strand radii) and how many pairs of strands
+// overlap by more than half their radii
+struct LayoutStats {
+  glm::vec3 centroid{0.0f};
+  float spread{0.0f};
+  int overlaps{0};
+};
+
+LayoutStats computeLayoutStats(const std::vector<const StrandParticle*>& particles) {
+  LayoutStats stats;
+  for (const StrandParticle* particle : particles) stats.centroid += particle->localPos;
+  stats.centroid /= static_cast<float>(particles.size());
+
+  for (int i = 0; i < particles.size(); ++i) {
+    const glm::vec3 offset = particles[i]->localPos - stats.centroid;
+    stats.spread += glm::dot(offset, offset);
+
+    for (int j = i + 1; j < particles.size(); ++j) {
+      const float distance = glm::length(particles[i]->localPos - particles[j]->localPos);
+      if (distance < 0.5f * (particles[i]->getRadius() + particles[j]->getRadius()))
+        ++stats.overlaps;
+    }
+  }
+  stats.spread = std::sqrt(stats.spread / particles.size()) / STRAND_RADIUS;
+
+  return stats;
+}
+
+// an updated tree has the strands of a tree computed from scratch, with the same layouts in the
+// nodes that were not packed again, and as tight ones in the nodes that were (their pbd starts
+// from the previous packing). its updated mesh is the mesh generated from scratch
+void checkUpdate(bool addBranch, int maxNodeStrands) {
+  PlantGraph pg = createTestGraph(3, 3, 21);
+  Tree tree(pg);
+  tree.setStrandBundling(maxNodeStrands);
+  tree.computeStrandsPosition();
+  MeshData updatedMesh = tree.generateMeshData();
+
+  const int branching = pg.getChildren(1)[0];
+  const int moved = pg.getChildren(branching)[0];
+  pg.setNodePosition(moved, pg.getNode(moved).pos + glm::vec3{0.2f, 0.1f, -0.1f});
+  if (addBranch) pg.addNode(pg.getNode(branching).pos + glm::vec3{-0.5f, 0.6f, 0.3f}, branching);
+
+  tree.updateMeshData(updatedMesh, tree.update());
+
+  PlantGraph fullGraph = pg;
+  Tree full(fullGraph);
+  full.setStrandBundling(maxNodeStrands);
+  full.computeStrandsPosition();
+
+  // layouts packed again: the moved node and its ancestors
+  std::set<int> packed;
+  for (int id = moved; id != -1; id = pg.getNode(id).parentId) packed.insert(id);
+
+  const auto strands = getLeafStrands(tree), fullStrands = getLeafStrands(full);
+  CHECK(strands.size() == fullStrands.size());
+
+  std::map<int, std::vector<const StrandParticle*>> nodeParticles, fullNodeParticles;
+  for (const auto& [key, strand] : strands) {
+    auto fullStrand = fullStrands.find(key);
+    CHECK(fullStrand != fullStrands.end());
+
+    const auto particles = getNodeParticles(*strand);
+    const auto fullParticles = getNodeParticles(*fullStrand->second);
+    CHECK(particles.size() == fullParticles.size());
+
+    for (int i = 0; i < particles.size(); ++i) {
+      const int nodeId = particles[i]->nodeId;
+      CHECK(nodeId == fullParticles[i]->nodeId);
+      CHECK(particles[i]->weight == fullParticles[i]->weight);
+
+      // (new strands change the pbd iterations of every node)
+      if (!addBranch && !packed.count(nodeId)) {
+        CHECK(particles[i]->localPos == fullParticles[i]->localPos);
+        CHECK(particles[i]->pos == fullParticles[i]->pos);
+      }
+
+      nodeParticles[nodeId].push_back(particles[i]);
+      fullNodeParticles[nodeId].push_back(fullParticles[i]);
+    }
+  }
+
+  for (const auto& [nodeId, particles] : nodeParticles) {
+    const LayoutStats stats = computeLayoutStats(particles);
+    const LayoutStats fullStats = computeLayoutStats(fullNodeParticles.at(nodeId));
+
+    CHECK(glm::length(stats.centroid - fullStats.centroid) < 2.0f * STRAND_RADIUS);
+    CHECK(std::abs(stats.spread - fullStats.spread) <= 0.1f * fullStats.spread + 0.5f);
+    CHECK(stats.overlaps <= fullStats.overlaps + particles.size() / 10);
+  }
+
+  const MeshData mesh = tree.generateMeshData();
+  CHECK(!mesh.indices.empty());
+  CHECK(updatedMesh.vertices == mesh.vertices);
+  CHECK(updatedMesh.normals == mesh.normals);
+  CHECK(updatedMesh.indices == mesh.indices);
+}
+
+}  // namespace
+
+int main() {
+  for (bool addBranch : {false, true}) {
+    checkUpdate(addBranch, 0);
+    checkUpdate(addBranch, 30);  // super-strands
+  }
+
+  return 0;
+}